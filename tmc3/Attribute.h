@@ -36,6 +36,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "hls.h"
 #include "PayloadBuffer.h"
@@ -47,6 +48,34 @@ namespace pcc {
 //============================================================================
 
 class AttributeContexts;
+class AttributeLodCache;
+class ThreadPool;
+
+//============================================================================
+// An attribute brick of a slice, decoded with others in a single pass.
+
+struct AttributeBrickDecoding {
+  const AttributeDescription* desc;
+  const AttributeParameterSet* aps;
+  const AttributeBrickHeader* abh;
+
+  // The attribute data following the brick header
+  const char* payload;
+  size_t payloadLen;
+
+  AttributeContexts* ctxtMem;
+};
+
+//----------------------------------------------------------------------------
+// An attribute brick of a slice, encoded with others in a single pass.
+
+struct AttributeBrickEncoding {
+  const AttributeDescription* desc;
+  const AttributeParameterSet* aps;
+  AttributeBrickHeader* abh;
+  AttributeContexts* ctxtMem;
+  PayloadBuffer* payload;
+};
 
 //============================================================================
 
@@ -66,6 +95,17 @@ public:
     AttributeContexts& ctxtMem,
     PCCPointSet3& pointCloud) = 0;
 
+  // Decode several attributes of pointCloud in a single traversal of their
+  // shared levels of detail.  The result is identical to decoding each
+  // attribute in turn with decode().  Returns false, having decoded
+  // nothing, if the attributes cannot be decoded together.
+  virtual bool decodeFused(
+    const SequenceParameterSet& sps,
+    const std::vector<AttributeBrickDecoding>& attrs,
+    int geom_num_points_minus1,
+    int minGeomNodeSizeLog2,
+    PCCPointSet3& pointCloud) = 0;
+
   // Indicates if the attribute decoder can decode the given aps
   virtual bool isReusable(
     const AttributeParameterSet& aps,
@@ -74,7 +114,11 @@ public:
 
 //----------------------------------------------------------------------------
 
-std::unique_ptr<AttributeDecoderIntf> makeAttributeDecoder();
+// Construct an attribute decoder.  If threadPool is not null, its workers
+// may be used to generate levels of detail.  If lodCache is not null,
+// levels of detail are reused from, and stored in, the cache.
+std::unique_ptr<AttributeDecoderIntf> makeAttributeDecoder(
+  ThreadPool* threadPool = nullptr, AttributeLodCache* lodCache = nullptr);
 
 //============================================================================
 
@@ -91,6 +135,15 @@ public:
     PCCPointSet3& pointCloud,
     PayloadBuffer* payload) = 0;
 
+  // Encode several attributes of pointCloud in a single traversal of their
+  // shared levels of detail, writing each to its own payload.  The
+  // payloads are identical to those produced by encode().  Returns false,
+  // having encoded nothing, if the attributes cannot be encoded together.
+  virtual bool encodeFused(
+    const SequenceParameterSet& sps,
+    const std::vector<AttributeBrickEncoding>& attrs,
+    PCCPointSet3& pointCloud) = 0;
+
   // Indicates if the attribute decoder can decode the given aps
   virtual bool isReusable(
     const AttributeParameterSet& aps,
@@ -99,7 +152,11 @@ public:
 
 //----------------------------------------------------------------------------
 
-std::unique_ptr<AttributeEncoderIntf> makeAttributeEncoder();
+// Construct an attribute encoder.  If threadPool is not null, its workers
+// may be used to generate levels of detail.  If lodCache is not null,
+// levels of detail are reused from, and stored in, the cache.
+std::unique_ptr<AttributeEncoderIntf> makeAttributeEncoder(
+  ThreadPool* threadPool = nullptr, AttributeLodCache* lodCache = nullptr);
 
 //============================================================================
 
@@ -37,6 +37,8 @@
 
 #include "PCCTMC3Common.h"
 
+#include <algorithm>
+
 namespace pcc {
 
 //============================================================================
@@ -48,21 +50,48 @@ AttributeLods::generate(
   const AttributeBrickHeader& abh,
   int geom_num_points_minus1,
   int minGeomNodeSizeLog2,
-  const PCCPointSet3& cloud)
+  const PCCPointSet3& cloud,
+  ThreadPool* threadPool,
+  AttributeLodCache* cache)
 {
+  if (minGeomNodeSizeLog2 > 0)
+    assert(aps.scalable_lifting_enabled_flag);
+
+  // NB: LoDs generated with scalable lifting are never reused
+  if (aps.scalable_lifting_enabled_flag)
+    cache = nullptr;
+
+  uint64_t geomHash = 0;
+  std::shared_ptr<const AttributeLods> cached;
+  if (cache) {
+    geomHash = AttributeLodCache::geometryHash(cloud);
+    cached = cache->find(geomHash, aps, abh, cloud);
+  }
+
+  // NB: the coders modify the predictors, so the cached LoDs are copied
+  if (cached)
+    *this = *cached;
+
   _aps = aps;
   _abh = abh;
 
-  if (minGeomNodeSizeLog2 > 0)
-    assert(aps.scalable_lifting_enabled_flag);
+  if (cached)
+    return;
 
+  // NB: the full predictors are only required while building the LoDs
+  std::vector<PCCPredictor> lodPredictors;
   buildPredictorsFast(
-    aps, abh, cloud, minGeomNodeSizeLog2, geom_num_points_minus1, predictors,
-    numPointsInLod, indexes);
+    aps, abh, cloud, minGeomNodeSizeLog2, geom_num_points_minus1,
+    lodPredictors, numPointsInLod, indexes, threadPool);
 
-  assert(predictors.size() == cloud.getPointCount());
-  for (auto& predictor : predictors)
+  assert(lodPredictors.size() == cloud.getPointCount());
+  for (auto& predictor : lodPredictors)
     predictor.computeWeights();
+
+  compactPredictors(lodPredictors, predictors);
+
+  if (cache)
+    cache->insert(geomHash, cloud, *this);
 }
 
 //----------------------------------------------------------------------------
@@ -124,6 +153,119 @@ AttributeLods::isReusable(
   return true;
 }
 
+//============================================================================
+// AttributeLodCache methods
+
+uint64_t
+AttributeLodCache::geometryHash(const PCCPointSet3& cloud)
+{
+  // FNV-1a over each position component
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < cloud.getPointCount(); i++) {
+    const auto& pos = cloud[i];
+    for (int k = 0; k < 3; k++)
+      hash = (hash ^ uint32_t(pos[k])) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+//----------------------------------------------------------------------------
+
+std::shared_ptr<const AttributeLods>
+AttributeLodCache::find(
+  uint64_t geomHash,
+  const AttributeParameterSet& aps,
+  const AttributeBrickHeader& abh,
+  const PCCPointSet3& cloud)
+{
+  const size_t numPoints = cloud.getPointCount();
+
+  std::vector<std::shared_ptr<const Entry>> candidates;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& entry : _entries) {
+      if (entry->geomHash == geomHash && entry->positions.size() == numPoints)
+        candidates.push_back(entry);
+    }
+  }
+
+  for (const auto& entry : candidates) {
+    if (!entry->lods.isReusable(aps, abh))
+      continue;
+
+    // NB: the positions are compared to eliminate any hash collision
+    bool match = true;
+    for (size_t i = 0; match && i < numPoints; i++)
+      match = entry->positions[i] == cloud[i];
+    if (!match)
+      continue;
+
+    // The entry may have been evicted since it was found
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = std::find(_entries.begin(), _entries.end(), entry);
+    if (it != _entries.end())
+      _entries.splice(_entries.begin(), _entries, it);
+
+    return std::shared_ptr<const AttributeLods>(entry, &entry->lods);
+  }
+
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------
+
+void
+AttributeLodCache::insert(
+  uint64_t geomHash, const PCCPointSet3& cloud, const AttributeLods& lods)
+{
+  if (_maxEntries <= 0)
+    return;
+
+  auto entry = std::make_shared<Entry>();
+  entry->geomHash = geomHash;
+  entry->positions.resize(cloud.getPointCount());
+  for (size_t i = 0; i < entry->positions.size(); i++)
+    entry->positions[i] = cloud[i];
+  entry->lods = lods;
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _entries.push_front(std::move(entry));
+  while (_entries.size() > size_t(_maxEntries))
+    _entries.pop_back();
+}
+
+//============================================================================
+
+bool
+fusedCodingSupported(const AttributeParameterSet& aps)
+{
+  // NB: spherical coordinates require a per-attribute point set
+  if (aps.spherical_coord_flag)
+    return false;
+
+  return aps.attr_encoding == AttributeEncoding::kPredictingTransform
+    || aps.attr_encoding == AttributeEncoding::kLiftingTransform;
+}
+
+//============================================================================
+
+void
+computeLiftingWeights(
+  const AttributeLods& lods,
+  const AttributeParameterSet& aps,
+  size_t numPoints,
+  int minGeomNodeSizeLog2,
+  std::vector<uint64_t>& weights)
+{
+  if (!aps.scalable_lifting_enabled_flag) {
+    PCCComputeQuantizationWeights(lods.predictors, weights);
+  } else {
+    computeQuantizationWeightsScalable(
+      lods.predictors, lods.numPointsInLod, numPoints, minGeomNodeSizeLog2,
+      weights);
+  }
+}
+
 //============================================================================
 
 }  // namespace pcc
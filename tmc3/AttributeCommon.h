@@ -36,6 +36,9 @@
 #pragma once
 
 #include <stdint.h>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "entropy.h"
@@ -69,6 +72,10 @@ AttributeContexts::reset()
 
 //============================================================================
 
+class AttributeLodCache;
+
+//============================================================================
+
 struct AttributeLods {
   // Indicates if the generated LoDs are compatible with the provided aps
   bool isReusable(
@@ -81,9 +88,11 @@ struct AttributeLods {
     const AttributeBrickHeader& abh,
     int geom_num_points_minus1,
     int minGeomNodeSizeLog2,
-    const PCCPointSet3& cloud);
+    const PCCPointSet3& cloud,
+    ThreadPool* threadPool = nullptr,
+    AttributeLodCache* cache = nullptr);
 
-  std::vector<PCCPredictor> predictors;
+  PredictorStore predictors;
   std::vector<uint32_t> numPointsInLod;
   std::vector<uint32_t> indexes;
 
@@ -97,6 +106,68 @@ private:
   AttributeBrickHeader _abh;
 };
 
+//============================================================================
+// A store of recently generated LoDs, permitting their reuse by subsequent
+// slices (or frames) with identical geometry.  The cache may be shared by
+// concurrent encoders or decoders.
+
+class AttributeLodCache {
+public:
+  explicit AttributeLodCache(int maxEntries) : _maxEntries(maxEntries) {}
+
+  int maxEntries() const { return _maxEntries; }
+
+  // A hash of the point positions of cloud
+  static uint64_t geometryHash(const PCCPointSet3& cloud);
+
+  // Finds a cached entry generated from the same point positions with
+  // compatible parameters.  Returns null if there is no such entry.
+  // NB: the cached LoDs are shared and must be copied before use.
+  std::shared_ptr<const AttributeLods> find(
+    uint64_t geomHash,
+    const AttributeParameterSet& aps,
+    const AttributeBrickHeader& abh,
+    const PCCPointSet3& cloud);
+
+  // Stores a copy of lods, generated from cloud, evicting the least recently
+  // used entry if the cache is full.
+  void insert(
+    uint64_t geomHash, const PCCPointSet3& cloud, const AttributeLods& lods);
+
+private:
+  // An entry is immutable once cached, and is compared and copied by the
+  // users of the cache without holding _mutex.
+  struct Entry {
+    uint64_t geomHash;
+    std::vector<point_t> positions;
+    AttributeLods lods;
+  };
+
+  int _maxEntries;
+
+  // Cached entries, most recently used first
+  std::list<std::shared_ptr<const Entry>> _entries;
+
+  std::mutex _mutex;
+};
+
+//============================================================================
+// Indicates if an attribute coded using aps may be coded together with the
+// other attributes of a slice in a single traversal of shared LoDs.
+
+bool fusedCodingSupported(const AttributeParameterSet& aps);
+
+//============================================================================
+// Derives the quantisation weights of the lifting transform from lods,
+// generated using aps for a slice of numPoints points.
+
+void computeLiftingWeights(
+  const AttributeLods& lods,
+  const AttributeParameterSet& aps,
+  size_t numPoints,
+  int minGeomNodeSizeLog2,
+  std::vector<uint64_t>& weights);
+
 //============================================================================
 
 }  // namespace pcc
@@ -219,9 +219,10 @@ AttributeDecoderIntf::~AttributeDecoderIntf() = default;
 // AttributeDecoder factory
 
 std::unique_ptr<AttributeDecoderIntf>
-makeAttributeDecoder()
+makeAttributeDecoder(ThreadPool* threadPool, AttributeLodCache* lodCache)
 {
-  return std::unique_ptr<AttributeDecoder>(new AttributeDecoder());
+  return std::unique_ptr<AttributeDecoder>(
+    new AttributeDecoder(threadPool, lodCache));
 }
 
 //============================================================================
@@ -248,7 +249,8 @@ AttributeDecoder::decode(
   // generate LoDs if necessary
   if (attr_aps.lodParametersPresent() && _lods.empty())
     _lods.generate(
-      attr_aps, abh, geom_num_points_minus1, minGeomNodeSizeLog2, pointCloud);
+      attr_aps, abh, geom_num_points_minus1, minGeomNodeSizeLog2, pointCloud,
+      _threadPool, _lodCache);
 
   if (attr_desc.attr_num_dimensions_minus1 == 0) {
     switch (attr_aps.attr_encoding) {
@@ -310,18 +312,21 @@ AttributeDecoder::computeReflectancePredictionWeights(
   const AttributeParameterSet& aps,
   const PCCPointSet3& pointCloud,
   const std::vector<uint32_t>& indexes,
-  PCCPredictor& predictor,
+  const uint32_t predictorIndex,
+  PredictorStore& predictors,
   PCCResidualsDecoder& decoder)
 {
-  predictor.predMode = 0;
+  const int neighborCount = predictors.neighborCount(predictorIndex);
+  int8_t& predMode = predictors.predMode[predictorIndex];
+  predMode = 0;
   int64_t maxDiff = 0;
 
-  if (predictor.neighborCount > 1 && aps.max_num_direct_predictors) {
+  if (neighborCount > 1 && aps.max_num_direct_predictors) {
     int64_t minValue = 0;
     int64_t maxValue = 0;
-    for (int i = 0; i < predictor.neighborCount; ++i) {
+    for (int i = 0; i < neighborCount; ++i) {
       const attr_t reflectanceNeighbor = pointCloud.getReflectance(
-        indexes[predictor.neighbors[i].predictorIndex]);
+        indexes[predictors.neighborIndex(predictorIndex, i)]);
       if (i == 0 || reflectanceNeighbor < minValue) {
         minValue = reflectanceNeighbor;
       }
@@ -333,10 +338,86 @@ AttributeDecoder::computeReflectancePredictionWeights(
   }
 
   if (maxDiff >= aps.adaptive_prediction_threshold) {
-    predictor.predMode = decoder.decodePredMode(aps.max_num_direct_predictors);
+    predMode = decoder.decodePredMode(aps.max_num_direct_predictors);
   }
 }
 
+//----------------------------------------------------------------------------
+// Decoding of an attribute coded using the predicting transform, one point
+// at a time, in predictor order.
+
+class AttributeDecoder::PredDecoder {
+public:
+  virtual ~PredDecoder() = default;
+  virtual void decodePoint(size_t predictorIndex) = 0;
+};
+
+//----------------------------------------------------------------------------
+
+class AttributeDecoder::ReflectancePredDecoder
+  : public AttributeDecoder::PredDecoder {
+public:
+  ReflectancePredDecoder(
+    AttributeLods& lods,
+    const AttributeDescription& desc,
+    const AttributeParameterSet& aps,
+    const QpSet& qpSet,
+    PCCResidualsDecoder& decoder,
+    PCCPointSet3& pointCloud)
+    : _lods(lods)
+    , _aps(aps)
+    , _qpSet(qpSet)
+    , _decoder(decoder)
+    , _pointCloud(pointCloud)
+    , _maxReflectance((1ll << desc.bitdepth) - 1)
+    , _quantLayer(0)
+  {
+    _zeroCnt = decoder.decodeRunLength();
+  }
+
+  void decodePoint(size_t predictorIndex) override;
+
+private:
+  AttributeLods& _lods;
+  const AttributeParameterSet& _aps;
+  const QpSet& _qpSet;
+  PCCResidualsDecoder& _decoder;
+  PCCPointSet3& _pointCloud;
+  const int64_t _maxReflectance;
+  int _zeroCnt;
+  int _quantLayer;
+};
+
+//----------------------------------------------------------------------------
+
+void
+AttributeDecoder::ReflectancePredDecoder::decodePoint(size_t predictorIndex)
+{
+  if (predictorIndex == _lods.numPointsInLod[_quantLayer]) {
+    _quantLayer = std::min(int(_qpSet.layers.size()) - 1, _quantLayer + 1);
+  }
+  const uint32_t pointIndex = _lods.indexes[predictorIndex];
+  auto quant = _qpSet.quantizers(_pointCloud[pointIndex], _quantLayer);
+  computeReflectancePredictionWeights(
+    _aps, _pointCloud, _lods.indexes, predictorIndex, _lods.predictors,
+    _decoder);
+  attr_t& reflectance = _pointCloud.getReflectance(pointIndex);
+  int32_t attValue0 = 0;
+  if (_zeroCnt > 0) {
+    _zeroCnt--;
+  } else {
+    attValue0 = _decoder.decode();
+    _zeroCnt = _decoder.decodeRunLength();
+  }
+  const int64_t quantPredAttValue = _lods.predictors.predictReflectance(
+    predictorIndex, _pointCloud, _lods.indexes);
+  const int64_t delta =
+    divExp2RoundHalfUp(quant[0].scale(attValue0), kFixedPointAttributeShift);
+  const int64_t reconstructedQuantAttValue = quantPredAttValue + delta;
+  reflectance =
+    attr_t(PCCClip(reconstructedQuantAttValue, int64_t(0), _maxReflectance));
+}
+
 //----------------------------------------------------------------------------
 
 void
@@ -347,37 +428,12 @@ AttributeDecoder::decodeReflectancesPred(
   PCCResidualsDecoder& decoder,
   PCCPointSet3& pointCloud)
 {
+  ReflectancePredDecoder coder(_lods, desc, aps, qpSet, decoder, pointCloud);
+
   const size_t pointCount = pointCloud.getPointCount();
-  const int64_t maxReflectance = (1ll << desc.bitdepth) - 1;
-  int zero_cnt = decoder.decodeRunLength();
-  int quantLayer = 0;
   for (size_t predictorIndex = 0; predictorIndex < pointCount;
-       ++predictorIndex) {
-    if (predictorIndex == _lods.numPointsInLod[quantLayer]) {
-      quantLayer = std::min(int(qpSet.layers.size()) - 1, quantLayer + 1);
-    }
-    const uint32_t pointIndex = _lods.indexes[predictorIndex];
-    auto quant = qpSet.quantizers(pointCloud[pointIndex], quantLayer);
-    auto& predictor = _lods.predictors[predictorIndex];
-
-    computeReflectancePredictionWeights(
-      aps, pointCloud, _lods.indexes, predictor, decoder);
-    attr_t& reflectance = pointCloud.getReflectance(pointIndex);
-    int32_t attValue0 = 0;
-    if (zero_cnt > 0) {
-      zero_cnt--;
-    } else {
-      attValue0 = decoder.decode();
-      zero_cnt = decoder.decodeRunLength();
-    }
-    const int64_t quantPredAttValue =
-      predictor.predictReflectance(pointCloud, _lods.indexes);
-    const int64_t delta =
-      divExp2RoundHalfUp(quant[0].scale(attValue0), kFixedPointAttributeShift);
-    const int64_t reconstructedQuantAttValue = quantPredAttValue + delta;
-    reflectance =
-      attr_t(PCCClip(reconstructedQuantAttValue, int64_t(0), maxReflectance));
-  }
+       ++predictorIndex)
+    coder.decodePoint(predictorIndex);
 }
 
 //----------------------------------------------------------------------------
@@ -387,17 +443,20 @@ AttributeDecoder::computeColorPredictionWeights(
   const AttributeParameterSet& aps,
   const PCCPointSet3& pointCloud,
   const std::vector<uint32_t>& indexes,
-  PCCPredictor& predictor,
+  const uint32_t predictorIndex,
+  PredictorStore& predictors,
   PCCResidualsDecoder& decoder)
 {
+  const int neighborCount = predictors.neighborCount(predictorIndex);
+  int8_t& predMode = predictors.predMode[predictorIndex];
   int64_t maxDiff = 0;
 
-  if (predictor.neighborCount > 1 && aps.max_num_direct_predictors) {
+  if (neighborCount > 1 && aps.max_num_direct_predictors) {
     int64_t minValue[3] = {0, 0, 0};
     int64_t maxValue[3] = {0, 0, 0};
-    for (int i = 0; i < predictor.neighborCount; ++i) {
-      const Vec3<attr_t> colorNeighbor =
-        pointCloud.getColor(indexes[predictor.neighbors[i].predictorIndex]);
+    for (int i = 0; i < neighborCount; ++i) {
+      const Vec3<attr_t> colorNeighbor = pointCloud.getColor(
+        indexes[predictors.neighborIndex(predictorIndex, i)]);
       for (size_t k = 0; k < 3; ++k) {
         if (i == 0 || colorNeighbor[k] < minValue[k]) {
           minValue[k] = colorNeighbor[k];
@@ -413,7 +472,83 @@ AttributeDecoder::computeColorPredictionWeights(
   }
 
   if (maxDiff >= aps.adaptive_prediction_threshold) {
-    predictor.predMode = decoder.decodePredMode(aps.max_num_direct_predictors);
+    predMode = decoder.decodePredMode(aps.max_num_direct_predictors);
+  }
+}
+
+//----------------------------------------------------------------------------
+
+class AttributeDecoder::ColorPredDecoder
+  : public AttributeDecoder::PredDecoder {
+public:
+  ColorPredDecoder(
+    AttributeLods& lods,
+    const AttributeDescription& desc,
+    const AttributeParameterSet& aps,
+    const QpSet& qpSet,
+    PCCResidualsDecoder& decoder,
+    PCCPointSet3& pointCloud)
+    : _lods(lods)
+    , _aps(aps)
+    , _qpSet(qpSet)
+    , _decoder(decoder)
+    , _pointCloud(pointCloud)
+    , _clipMax{(1 << desc.bitdepth) - 1, (1 << desc.bitdepthSecondary) - 1,
+               (1 << desc.bitdepthSecondary) - 1}
+    , _quantLayer(0)
+  {
+    _zeroCnt = decoder.decodeRunLength();
+  }
+
+  void decodePoint(size_t predictorIndex) override;
+
+private:
+  AttributeLods& _lods;
+  const AttributeParameterSet& _aps;
+  const QpSet& _qpSet;
+  PCCResidualsDecoder& _decoder;
+  PCCPointSet3& _pointCloud;
+  const Vec3<int64_t> _clipMax;
+  int _zeroCnt;
+  int _quantLayer;
+};
+
+//----------------------------------------------------------------------------
+
+void
+AttributeDecoder::ColorPredDecoder::decodePoint(size_t predictorIndex)
+{
+  if (predictorIndex == _lods.numPointsInLod[_quantLayer]) {
+    _quantLayer = std::min(int(_qpSet.layers.size()) - 1, _quantLayer + 1);
+  }
+  const uint32_t pointIndex = _lods.indexes[predictorIndex];
+  auto quant = _qpSet.quantizers(_pointCloud[pointIndex], _quantLayer);
+  computeColorPredictionWeights(
+    _aps, _pointCloud, _lods.indexes, predictorIndex, _lods.predictors,
+    _decoder);
+
+  int32_t values[3];
+  if (_zeroCnt > 0) {
+    values[0] = values[1] = values[2] = 0;
+    _zeroCnt--;
+  } else {
+    _decoder.decode(values);
+    _zeroCnt = _decoder.decodeRunLength();
+  }
+  Vec3<attr_t>& color = _pointCloud.getColor(pointIndex);
+  const Vec3<attr_t> predictedColor =
+    _lods.predictors.predictColor(predictorIndex, _pointCloud, _lods.indexes);
+
+  int64_t residual0 = 0;
+  for (int k = 0; k < 3; ++k) {
+    const auto& q = quant[std::min(k, 1)];
+    const int64_t residual =
+      divExp2RoundHalfUp(q.scale(values[k]), kFixedPointAttributeShift);
+    const int64_t recon = predictedColor[k] + residual + residual0;
+    color[k] = attr_t(PCCClip(recon, int64_t(0), _clipMax[k]));
+
+    if (!k && _aps.inter_component_prediction_enabled_flag)
+      residual0 = residual;
   }
 }
 
@@ -427,49 +562,98 @@ AttributeDecoder::decodeColorsPred(
   PCCResidualsDecoder& decoder,
   PCCPointSet3& pointCloud)
 {
+  ColorPredDecoder coder(_lods, desc, aps, qpSet, decoder, pointCloud);
+
   const size_t pointCount = pointCloud.getPointCount();
+  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+       ++predictorIndex)
+    coder.decodePoint(predictorIndex);
+}
 
-  Vec3<int64_t> clipMax{(1 << desc.bitdepth) - 1,
-                        (1 << desc.bitdepthSecondary) - 1,
-                        (1 << desc.bitdepthSecondary) - 1};
+//----------------------------------------------------------------------------
 
-  int32_t values[3];
-  int zero_cnt = decoder.decodeRunLength();
-  int quantLayer = 0;
-  for (size_t predictorIndex = 0; predictorIndex < pointCount;
-       ++predictorIndex) {
-    if (predictorIndex == _lods.numPointsInLod[quantLayer]) {
-      quantLayer = std::min(int(qpSet.layers.size()) - 1, quantLayer + 1);
-    }
-    const uint32_t pointIndex = _lods.indexes[predictorIndex];
-    auto quant = qpSet.quantizers(pointCloud[pointIndex], quantLayer);
-    auto& predictor = _lods.predictors[predictorIndex];
+bool
+AttributeDecoder::decodeFused(
+  const SequenceParameterSet& sps,
+  const std::vector<AttributeBrickDecoding>& attrs,
+  int geom_num_points_minus1,
+  int minGeomNodeSizeLog2,
+  PCCPointSet3& pointCloud)
+{
+  // NB: the attributes must all be coded using the same transform
+  const auto encoding = attrs[0].aps->attr_encoding;
+  for (const auto& attr : attrs)
+    if (
+      !fusedCodingSupported(*attr.aps)
+      || attr.aps->attr_encoding != encoding)
+      return false;
+
+  // generate LoDs if necessary, and check that they are shared by all
+  if (_lods.empty())
+    _lods.generate(
+      *attrs[0].aps, *attrs[0].abh, geom_num_points_minus1,
+      minGeomNodeSizeLog2, pointCloud, _threadPool, _lodCache);
+
+  for (const auto& attr : attrs)
+    if (!_lods.isReusable(*attr.aps, *attr.abh))
+      return false;
+
+  const size_t numAttrs = attrs.size();
+  std::vector<QpSet> qpSets(numAttrs);
+  std::vector<std::unique_ptr<PCCResidualsDecoder>> decoders(numAttrs);
+  for (size_t i = 0; i < numAttrs; i++) {
+    const auto& attr = attrs[i];
+    qpSets[i] = deriveQpSet(*attr.desc, *attr.aps, *attr.abh);
+
+    decoders[i].reset(new PCCResidualsDecoder(*attr.abh, *attr.ctxtMem));
+    decoders[i]->start(sps, attr.payload, attr.payloadLen);
+  }
 
-    computeColorPredictionWeights(
-      aps, pointCloud, _lods.indexes, predictor, decoder);
-    if (zero_cnt > 0) {
-      values[0] = values[1] = values[2] = 0;
-      zero_cnt--;
-    } else {
-      decoder.decode(values);
-      zero_cnt = decoder.decodeRunLength();
-    }
-    Vec3<attr_t>& color = pointCloud.getColor(pointIndex);
-    const Vec3<attr_t> predictedColor =
-      predictor.predictColor(pointCloud, _lods.indexes);
-
-    int64_t residual0 = 0;
-    for (int k = 0; k < 3; ++k) {
-      const auto& q = quant[std::min(k, 1)];
-      const int64_t residual =
-        divExp2RoundHalfUp(q.scale(values[k]), kFixedPointAttributeShift);
-      const int64_t recon = predictedColor[k] + residual + residual0;
-      color[k] = attr_t(PCCClip(recon, int64_t(0), clipMax[k]));
-
-      if (!k && aps.inter_component_prediction_enabled_flag)
-        residual0 = residual;
-    }
+  if (encoding == AttributeEncoding::kLiftingTransform)
+    decodeLiftFused(
+      attrs, qpSets, decoders, geom_num_points_minus1, minGeomNodeSizeLog2,
+      pointCloud);
+  else
+    decodePredFused(attrs, qpSets, decoders, pointCloud);
+
+  for (size_t i = 0; i < numAttrs; i++) {
+    decoders[i]->stop();
+
+    // save the context state for re-use by a future slice if required
+    *attrs[i].ctxtMem = decoders[i]->getCtx();
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+void
+AttributeDecoder::decodePredFused(
+  const std::vector<AttributeBrickDecoding>& attrs,
+  const std::vector<QpSet>& qpSets,
+  const std::vector<std::unique_ptr<PCCResidualsDecoder>>& decoders,
+  PCCPointSet3& pointCloud)
+{
+  const size_t numAttrs = attrs.size();
+  std::vector<std::unique_ptr<PredDecoder>> coders(numAttrs);
+  for (size_t i = 0; i < numAttrs; i++) {
+    const auto& attr = attrs[i];
+    if (attr.desc->attr_num_dimensions_minus1 == 0)
+      coders[i].reset(new ReflectancePredDecoder(
+        _lods, *attr.desc, *attr.aps, qpSets[i], *decoders[i], pointCloud));
+    else
+      coders[i].reset(new ColorPredDecoder(
+        _lods, *attr.desc, *attr.aps, qpSets[i], *decoders[i], pointCloud));
   }
+
+  // NB: each point is decoded in attribute order, as if the attributes
+  //     were decoded in turn, since they share the prediction modes.
+  const size_t pointCount = pointCloud.getPointCount();
+  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+       ++predictorIndex)
+    for (auto& coder : coders)
+      coder->decodePoint(predictorIndex);
 }
 
 //----------------------------------------------------------------------------
@@ -604,109 +788,241 @@ AttributeDecoder::decodeColorsRaht(
 
 //----------------------------------------------------------------------------
 
+// Decoding of an attribute coded using the lifting transform.  The
+// coefficients are decoded one point at a time, in predictor order, then
+// inverse transformed one level of detail at a time.
+
+class AttributeDecoder::LiftDecoder {
+public:
+  virtual ~LiftDecoder() = default;
+  virtual void decodePoint(size_t predictorIndex) = 0;
+  virtual void reconstructLod(size_t lodIndex) = 0;
+  virtual void finish() = 0;
+};
+
+//----------------------------------------------------------------------------
+
+class AttributeDecoder::ReflectanceLiftDecoder
+  : public AttributeDecoder::LiftDecoder {
+public:
+  ReflectanceLiftDecoder(
+    const AttributeLods& lods,
+    const AttributeDescription& desc,
+    const QpSet& qpSet,
+    const std::vector<uint64_t>& weights,
+    PCCResidualsDecoder& decoder,
+    PCCPointSet3& pointCloud)
+    : _lods(lods)
+    , _qpSet(qpSet)
+    , _weights(weights)
+    , _decoder(decoder)
+    , _pointCloud(pointCloud)
+    , _maxReflectance((1ll << desc.bitdepth) - 1)
+    , _reflectances(pointCloud.getPointCount())
+    , _quantLayer(0)
+  {
+    _zeroCnt = decoder.decodeRunLength();
+  }
+
+  void decodePoint(size_t predictorIndex) override;
+  void reconstructLod(size_t lodIndex) override;
+  void finish() override;
+
+private:
+  const AttributeLods& _lods;
+  const QpSet& _qpSet;
+  const std::vector<uint64_t>& _weights;
+  PCCResidualsDecoder& _decoder;
+  PCCPointSet3& _pointCloud;
+  const int64_t _maxReflectance;
+  std::vector<int64_t> _reflectances;
+  int _zeroCnt;
+  int _quantLayer;
+};
+
+//----------------------------------------------------------------------------
+
 void
-AttributeDecoder::decodeColorsLift(
-  const AttributeDescription& desc,
-  const AttributeParameterSet& aps,
-  const QpSet& qpSet,
-  int geom_num_points_minus1,
-  int minGeomNodeSizeLog2,
-  PCCResidualsDecoder& decoder,
-  PCCPointSet3& pointCloud)
+AttributeDecoder::ReflectanceLiftDecoder::decodePoint(size_t predictorIndex)
 {
-  const size_t pointCount = pointCloud.getPointCount();
-  std::vector<uint64_t> weights;
+  if (predictorIndex == _lods.numPointsInLod[_quantLayer]) {
+    _quantLayer = std::min(int(_qpSet.layers.size()) - 1, _quantLayer + 1);
+  }
+  const uint32_t pointIndex = _lods.indexes[predictorIndex];
+  auto quant = _qpSet.quantizers(_pointCloud[pointIndex], _quantLayer);
 
-  if (!aps.scalable_lifting_enabled_flag) {
-    PCCComputeQuantizationWeights(_lods.predictors, weights);
+  int64_t detail = 0;
+  if (_zeroCnt > 0) {
+    _zeroCnt--;
   } else {
-    computeQuantizationWeightsScalable(
-      _lods.predictors, _lods.numPointsInLod, geom_num_points_minus1 + 1,
-      minGeomNodeSizeLog2, weights);
+    detail = _decoder.decode();
+    _zeroCnt = _decoder.decodeRunLength();
   }
+  const int64_t iQuantWeight = irsqrt(_weights[predictorIndex]);
+  auto& reflectance = _reflectances[predictorIndex];
+  const int64_t delta = detail;
+  const int64_t reconstructedDelta = quant[0].scale(delta);
+  reflectance = divExp2RoundHalfInf(reconstructedDelta * iQuantWeight, 40);
+}
 
-  const size_t lodCount = _lods.numPointsInLod.size();
-  std::vector<Vec3<int64_t>> colors;
-  colors.resize(pointCount);
+//----------------------------------------------------------------------------
 
-  // decompress
-  // Per level-of-detail coefficients {-1,0,1} for last component prediction
-  int lod = 0;
-  int8_t lastCompPredCoeff = 0;
-  std::vector<int8_t> lastCompPredCoeffs;
-  if (aps.last_component_prediction_enabled_flag) {
-    lastCompPredCoeffs = decoder.decodeLastCompPredCoeffs(lodCount);
-    lastCompPredCoeff = lastCompPredCoeffs[0];
-  }
+void
+AttributeDecoder::ReflectanceLiftDecoder::reconstructLod(size_t lodIndex)
+{
+  const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
+  const size_t endIndex = _lods.numPointsInLod[lodIndex];
+  PCCLiftUpdate(
+    _lods.predictors, _weights, startIndex, endIndex, false, _reflectances);
+  PCCLiftPredict(
+    _lods.predictors, startIndex, endIndex, false, _reflectances);
+}
 
-  int zero_cnt = decoder.decodeRunLength();
-  int quantLayer = 0;
-  for (size_t predictorIndex = 0; predictorIndex < pointCount;
-       ++predictorIndex) {
-    if (predictorIndex == _lods.numPointsInLod[quantLayer]) {
-      quantLayer = std::min(int(qpSet.layers.size()) - 1, quantLayer + 1);
-    }
+//----------------------------------------------------------------------------
 
-    if (predictorIndex == _lods.numPointsInLod[lod]) {
-      lod++;
-      if (aps.last_component_prediction_enabled_flag)
-        lastCompPredCoeff = lastCompPredCoeffs[lod];
-    }
+void
+AttributeDecoder::ReflectanceLiftDecoder::finish()
+{
+  const size_t pointCount = _reflectances.size();
+  for (size_t f = 0; f < pointCount; ++f) {
+    const auto refl =
+      divExp2RoundHalfInf(_reflectances[f], kFixedPointAttributeShift);
+    _pointCloud.setReflectance(
+      _lods.indexes[f], attr_t(PCCClip(refl, int64_t(0), _maxReflectance)));
+  }
+}
 
-    const uint32_t pointIndex = _lods.indexes[predictorIndex];
-    auto quant = qpSet.quantizers(pointCloud[pointIndex], quantLayer);
+//----------------------------------------------------------------------------
 
-    int32_t values[3];
-    if (zero_cnt > 0) {
-      values[0] = values[1] = values[2] = 0;
-      zero_cnt--;
-    } else {
-      decoder.decode(values);
-      zero_cnt = decoder.decodeRunLength();
+class AttributeDecoder::ColorLiftDecoder
+  : public AttributeDecoder::LiftDecoder {
+public:
+  ColorLiftDecoder(
+    const AttributeLods& lods,
+    const AttributeDescription& desc,
+    const AttributeParameterSet& aps,
+    const QpSet& qpSet,
+    const std::vector<uint64_t>& weights,
+    PCCResidualsDecoder& decoder,
+    PCCPointSet3& pointCloud)
+    : _lods(lods)
+    , _aps(aps)
+    , _qpSet(qpSet)
+    , _weights(weights)
+    , _decoder(decoder)
+    , _pointCloud(pointCloud)
+    , _clipMax{(1 << desc.bitdepth) - 1, (1 << desc.bitdepthSecondary) - 1,
+               (1 << desc.bitdepthSecondary) - 1}
+    , _colors(pointCloud.getPointCount())
+    , _lastCompPredCoeff(0)
+    , _quantLayer(0)
+    , _lod(0)
+  {
+    // Per level-of-detail coefficients {-1,0,1} for last component
+    // prediction
+    if (aps.last_component_prediction_enabled_flag) {
+      _lastCompPredCoeffs =
+        decoder.decodeLastCompPredCoeffs(lods.numPointsInLod.size());
+      _lastCompPredCoeff = _lastCompPredCoeffs[0];
     }
 
-    const int64_t iQuantWeight = irsqrt(weights[predictorIndex]);
-    auto& color = colors[predictorIndex];
+    _zeroCnt = decoder.decodeRunLength();
+  }
+
+  void decodePoint(size_t predictorIndex) override;
+  void reconstructLod(size_t lodIndex) override;
+  void finish() override;
+
+private:
+  const AttributeLods& _lods;
+  const AttributeParameterSet& _aps;
+  const QpSet& _qpSet;
+  const std::vector<uint64_t>& _weights;
+  PCCResidualsDecoder& _decoder;
+  PCCPointSet3& _pointCloud;
+  const Vec3<int64_t> _clipMax;
+  std::vector<Vec3<int64_t>> _colors;
+  std::vector<int8_t> _lastCompPredCoeffs;
+  int8_t _lastCompPredCoeff;
+  int _zeroCnt;
+  int _quantLayer;
+  int _lod;
+};
 
-    int64_t scaled = quant[0].scale(values[0]);
-    color[0] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
+//----------------------------------------------------------------------------
 
-    scaled = quant[1].scale(values[1]);
-    color[1] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
+void
+AttributeDecoder::ColorLiftDecoder::decodePoint(size_t predictorIndex)
+{
+  if (predictorIndex == _lods.numPointsInLod[_quantLayer]) {
+    _quantLayer = std::min(int(_qpSet.layers.size()) - 1, _quantLayer + 1);
+  }
 
-    scaled *= lastCompPredCoeff;
-    scaled += quant[1].scale(values[2]);
-    color[2] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
+  if (predictorIndex == _lods.numPointsInLod[_lod]) {
+    _lod++;
+    if (_aps.last_component_prediction_enabled_flag)
+      _lastCompPredCoeff = _lastCompPredCoeffs[_lod];
   }
 
-  // reconstruct
-  for (size_t lodIndex = 1; lodIndex < lodCount; ++lodIndex) {
-    const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
-    const size_t endIndex = _lods.numPointsInLod[lodIndex];
-    PCCLiftUpdate(
-      _lods.predictors, weights, startIndex, endIndex, false, colors);
-    PCCLiftPredict(_lods.predictors, startIndex, endIndex, false, colors);
+  const uint32_t pointIndex = _lods.indexes[predictorIndex];
+  auto quant = _qpSet.quantizers(_pointCloud[pointIndex], _quantLayer);
+
+  int32_t values[3];
+  if (_zeroCnt > 0) {
+    values[0] = values[1] = values[2] = 0;
+    _zeroCnt--;
+  } else {
+    _decoder.decode(values);
+    _zeroCnt = _decoder.decodeRunLength();
   }
 
-  Vec3<int64_t> clipMax{(1 << desc.bitdepth) - 1,
-                        (1 << desc.bitdepthSecondary) - 1,
-                        (1 << desc.bitdepthSecondary) - 1};
+  const int64_t iQuantWeight = irsqrt(_weights[predictorIndex]);
+  auto& color = _colors[predictorIndex];
+
+  int64_t scaled = quant[0].scale(values[0]);
+  color[0] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
+
+  scaled = quant[1].scale(values[1]);
+  color[1] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
+
+  scaled *= _lastCompPredCoeff;
+  scaled += quant[1].scale(values[2]);
+  color[2] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
+}
+
+//----------------------------------------------------------------------------
+
+void
+AttributeDecoder::ColorLiftDecoder::reconstructLod(size_t lodIndex)
+{
+  const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
+  const size_t endIndex = _lods.numPointsInLod[lodIndex];
+  PCCLiftUpdate(
+    _lods.predictors, _weights, startIndex, endIndex, false, _colors);
+  PCCLiftPredict(_lods.predictors, startIndex, endIndex, false, _colors);
+}
+
+//----------------------------------------------------------------------------
 
+void
+AttributeDecoder::ColorLiftDecoder::finish()
+{
+  const size_t pointCount = _colors.size();
   for (size_t f = 0; f < pointCount; ++f) {
     const auto color0 =
-      divExp2RoundHalfInf(colors[f], kFixedPointAttributeShift);
+      divExp2RoundHalfInf(_colors[f], kFixedPointAttributeShift);
     Vec3<attr_t> color;
     for (size_t d = 0; d < 3; ++d) {
-      color[d] = attr_t(PCCClip(color0[d], int64_t(0), clipMax[d]));
+      color[d] = attr_t(PCCClip(color0[d], int64_t(0), _clipMax[d]));
     }
-    pointCloud.setColor(_lods.indexes[f], color);
+    _pointCloud.setColor(_lods.indexes[f], color);
   }
 }
 
 //----------------------------------------------------------------------------
 
 void
-AttributeDecoder::decodeReflectancesLift(
+AttributeDecoder::decodeColorsLift(
   const AttributeDescription& desc,
   const AttributeParameterSet& aps,
   const QpSet& qpSet,
@@ -715,62 +1031,105 @@ AttributeDecoder::decodeReflectancesLift(
   PCCResidualsDecoder& decoder,
   PCCPointSet3& pointCloud)
 {
-  const size_t pointCount = pointCloud.getPointCount();
   std::vector<uint64_t> weights;
+  computeLiftingWeights(
+    _lods, aps, geom_num_points_minus1 + 1, minGeomNodeSizeLog2, weights);
 
-  if (!aps.scalable_lifting_enabled_flag) {
-    PCCComputeQuantizationWeights(_lods.predictors, weights);
-  } else {
-    computeQuantizationWeightsScalable(
-      _lods.predictors, _lods.numPointsInLod, geom_num_points_minus1 + 1,
-      minGeomNodeSizeLog2, weights);
-  }
+  ColorLiftDecoder coder(
+    _lods, desc, aps, qpSet, weights, decoder, pointCloud);
 
+  // decompress
+  const size_t pointCount = pointCloud.getPointCount();
+  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+       ++predictorIndex)
+    coder.decodePoint(predictorIndex);
+
+  // reconstruct
   const size_t lodCount = _lods.numPointsInLod.size();
-  std::vector<int64_t> reflectances;
-  reflectances.resize(pointCount);
+  for (size_t lodIndex = 1; lodIndex < lodCount; ++lodIndex)
+    coder.reconstructLod(lodIndex);
+
+  coder.finish();
+}
+
+//----------------------------------------------------------------------------
+
+void
+AttributeDecoder::decodeReflectancesLift(
+  const AttributeDescription& desc,
+  const AttributeParameterSet& aps,
+  const QpSet& qpSet,
+  int geom_num_points_minus1,
+  int minGeomNodeSizeLog2,
+  PCCResidualsDecoder& decoder,
+  PCCPointSet3& pointCloud)
+{
+  std::vector<uint64_t> weights;
+  computeLiftingWeights(
+    _lods, aps, geom_num_points_minus1 + 1, minGeomNodeSizeLog2, weights);
+
+  ReflectanceLiftDecoder coder(
+    _lods, desc, qpSet, weights, decoder, pointCloud);
 
   // decompress
-  int zero_cnt = decoder.decodeRunLength();
-  int quantLayer = 0;
+  const size_t pointCount = pointCloud.getPointCount();
   for (size_t predictorIndex = 0; predictorIndex < pointCount;
-       ++predictorIndex) {
-    if (predictorIndex == _lods.numPointsInLod[quantLayer]) {
-      quantLayer = std::min(int(qpSet.layers.size()) - 1, quantLayer + 1);
-    }
-    const uint32_t pointIndex = _lods.indexes[predictorIndex];
-    auto quant = qpSet.quantizers(pointCloud[pointIndex], quantLayer);
+       ++predictorIndex)
+    coder.decodePoint(predictorIndex);
 
-    int64_t detail = 0;
-    if (zero_cnt > 0) {
-      zero_cnt--;
-    } else {
-      detail = decoder.decode();
-      zero_cnt = decoder.decodeRunLength();
-    }
-    const int64_t iQuantWeight = irsqrt(weights[predictorIndex]);
-    auto& reflectance = reflectances[predictorIndex];
-    const int64_t delta = detail;
-    const int64_t reconstructedDelta = quant[0].scale(delta);
-    reflectance = divExp2RoundHalfInf(reconstructedDelta * iQuantWeight, 40);
+  // reconstruct
+  const size_t lodCount = _lods.numPointsInLod.size();
+  for (size_t lodIndex = 1; lodIndex < lodCount; ++lodIndex)
+    coder.reconstructLod(lodIndex);
+
+  coder.finish();
+}
+
+//----------------------------------------------------------------------------
+
+void
+AttributeDecoder::decodeLiftFused(
+  const std::vector<AttributeBrickDecoding>& attrs,
+  const std::vector<QpSet>& qpSets,
+  const std::vector<std::unique_ptr<PCCResidualsDecoder>>& decoders,
+  int geom_num_points_minus1,
+  int minGeomNodeSizeLog2,
+  PCCPointSet3& pointCloud)
+{
+  // NB: the quantisation weights depend only upon the shared LoDs
+  std::vector<uint64_t> weights;
+  computeLiftingWeights(
+    _lods, *attrs[0].aps, geom_num_points_minus1 + 1, minGeomNodeSizeLog2,
+    weights);
+
+  const size_t numAttrs = attrs.size();
+  std::vector<std::unique_ptr<LiftDecoder>> coders(numAttrs);
+  for (size_t i = 0; i < numAttrs; i++) {
+    const auto& attr = attrs[i];
+    if (attr.desc->attr_num_dimensions_minus1 == 0)
+      coders[i].reset(new ReflectanceLiftDecoder(
+        _lods, *attr.desc, qpSets[i], weights, *decoders[i], pointCloud));
+    else
+      coders[i].reset(new ColorLiftDecoder(
+        _lods, *attr.desc, *attr.aps, qpSets[i], weights, *decoders[i],
+        pointCloud));
   }
 
+  // decompress
+  const size_t pointCount = pointCloud.getPointCount();
+  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+       ++predictorIndex)
+    for (auto& coder : coders)
+      coder->decodePoint(predictorIndex);
+
   // reconstruct
-  for (size_t lodIndex = 1; lodIndex < lodCount; ++lodIndex) {
-    const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
-    const size_t endIndex = _lods.numPointsInLod[lodIndex];
-    PCCLiftUpdate(
-      _lods.predictors, weights, startIndex, endIndex, false, reflectances);
-    PCCLiftPredict(
-      _lods.predictors, startIndex, endIndex, false, reflectances);
-  }
-  const int64_t maxReflectance = (1 << desc.bitdepth) - 1;
-  for (size_t f = 0; f < pointCount; ++f) {
-    const auto refl =
-      divExp2RoundHalfInf(reflectances[f], kFixedPointAttributeShift);
-    pointCloud.setReflectance(
-      _lods.indexes[f], attr_t(PCCClip(refl, int64_t(0), maxReflectance)));
-  }
+  const size_t lodCount = _lods.numPointsInLod.size();
+  for (size_t lodIndex = 1; lodIndex < lodCount; ++lodIndex)
+    for (auto& coder : coders)
+      coder->reconstructLod(lodIndex);
+
+  for (auto& coder : coders)
+    coder->finish();
 }
 
 //============================================================================
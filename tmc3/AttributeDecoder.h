@@ -54,6 +54,11 @@ class PCCResidualsDecoder;
 
 class AttributeDecoder : public AttributeDecoderIntf {
 public:
+  explicit AttributeDecoder(
+    ThreadPool* threadPool = nullptr, AttributeLodCache* lodCache = nullptr)
+    : _threadPool(threadPool), _lodCache(lodCache)
+  {}
+
   void decode(
     const SequenceParameterSet& sps,
     const AttributeDescription& desc,
@@ -66,6 +71,13 @@ public:
     AttributeContexts& ctxtMem,
     PCCPointSet3& pointCloud) override;
 
+  bool decodeFused(
+    const SequenceParameterSet& sps,
+    const std::vector<AttributeBrickDecoding>& attrs,
+    int geom_num_points_minus1,
+    int minGeomNodeSizeLog2,
+    PCCPointSet3& pointCloud) override;
+
   bool isReusable(
     const AttributeParameterSet& aps,
     const AttributeBrickHeader& abh) const override;
@@ -123,18 +135,50 @@ protected:
     const AttributeParameterSet& aps,
     const PCCPointSet3& pointCloud,
     const std::vector<uint32_t>& indexes,
-    PCCPredictor& predictor,
+    const uint32_t predictorIndex,
+    PredictorStore& predictors,
     PCCResidualsDecoder& decoder);
 
   static void computeReflectancePredictionWeights(
     const AttributeParameterSet& aps,
     const PCCPointSet3& pointCloud,
     const std::vector<uint32_t>& indexes,
-    PCCPredictor& predictor,
+    const uint32_t predictorIndex,
+    PredictorStore& predictors,
     PCCResidualsDecoder& decoder);
 
 private:
+  void decodePredFused(
+    const std::vector<AttributeBrickDecoding>& attrs,
+    const std::vector<QpSet>& qpSets,
+    const std::vector<std::unique_ptr<PCCResidualsDecoder>>& decoders,
+    PCCPointSet3& pointCloud);
+
+  void decodeLiftFused(
+    const std::vector<AttributeBrickDecoding>& attrs,
+    const std::vector<QpSet>& qpSets,
+    const std::vector<std::unique_ptr<PCCResidualsDecoder>>& decoders,
+    int geom_num_points_minus1,
+    int minGeomNodeSizeLog2,
+    PCCPointSet3& pointCloud);
+
+  // Per-point decoders of the predicting transform
+  class PredDecoder;
+  class ReflectancePredDecoder;
+  class ColorPredDecoder;
+
+  // Decoders of the lifting transform
+  class LiftDecoder;
+  class ReflectanceLiftDecoder;
+  class ColorLiftDecoder;
+
   AttributeLods _lods;
+
+  // Optional workers used to generate the LoDs
+  ThreadPool* _threadPool;
+
+  // Optional store of LoDs shared with other attribute coders
+  AttributeLodCache* _lodCache;
 };
 
 //============================================================================
@@ -56,6 +56,11 @@ struct PCCResidualsEntropyEstimator;
 
 class AttributeEncoder : public AttributeEncoderIntf {
 public:
+  explicit AttributeEncoder(
+    ThreadPool* threadPool = nullptr, AttributeLodCache* lodCache = nullptr)
+    : _threadPool(threadPool), _lodCache(lodCache)
+  {}
+
   void encode(
     const SequenceParameterSet& sps,
     const AttributeDescription& desc,
@@ -65,6 +70,11 @@ public:
     PCCPointSet3& pointCloud,
     PayloadBuffer* payload) override;
 
+  bool encodeFused(
+    const SequenceParameterSet& sps,
+    const std::vector<AttributeBrickEncoding>& attrs,
+    PCCPointSet3& pointCloud) override;
+
   bool isReusable(
     const AttributeParameterSet& aps,
     const AttributeBrickHeader& abh) const override;
@@ -120,12 +130,14 @@ protected:
     const Vec3<attr_t> predictedColor,
     const Quantizers& quant);
 
-  static void computeColorPredictionWeights(
+  // Selects the prediction mode of a predictor, returning true if the mode
+  // is to be signalled.
+  static bool computeColorPredictionWeights(
     const AttributeParameterSet& aps,
     const PCCPointSet3& pointCloud,
     const std::vector<uint32_t>& indexesLOD,
     const uint32_t predictorIndex,
-    PCCPredictor& predictor,
+    PredictorStore& predictors,
     PCCResidualsEncoder& encoder,
     PCCResidualsEntropyEstimator& context,
     const Quantizers& quant);
@@ -135,22 +147,51 @@ protected:
     const uint64_t predictedReflectance,
     const Quantizer& quant);
 
-  static void computeReflectancePredictionWeights(
+  static bool computeReflectancePredictionWeights(
     const AttributeParameterSet& aps,
     const PCCPointSet3& pointCloud,
     const std::vector<uint32_t>& indexesLOD,
     const uint32_t predictorIndex,
-    PCCPredictor& predictor,
+    PredictorStore& predictors,
     PCCResidualsEncoder& encoder,
     PCCResidualsEntropyEstimator& context,
     const Quantizer& quant);
 
 private:
-  std::vector<int8_t> computeLastComponentPredictionCoeff(
+  static std::vector<int8_t> computeLastComponentPredictionCoeff(
+    const std::vector<uint32_t>& numPointsInLod,
     const std::vector<Vec3<int64_t>>& coeffs);
 
 private:
+  void encodePredFused(
+    const std::vector<AttributeBrickEncoding>& attrs,
+    const std::vector<QpSet>& qpSets,
+    const std::vector<std::unique_ptr<PCCResidualsEncoder>>& encoders,
+    PCCPointSet3& pointCloud);
+
+  void encodeLiftFused(
+    const std::vector<AttributeBrickEncoding>& attrs,
+    const std::vector<QpSet>& qpSets,
+    const std::vector<std::unique_ptr<PCCResidualsEncoder>>& encoders,
+    PCCPointSet3& pointCloud);
+
+  // Per-point encoders of the predicting transform
+  class PredEncoder;
+  class ReflectancePredEncoder;
+  class ColorPredEncoder;
+
+  // Encoders of the lifting transform
+  class LiftEncoder;
+  class ReflectanceLiftEncoder;
+  class ColorLiftEncoder;
+
   AttributeLods _lods;
+
+  // Optional workers used to generate the LoDs
+  ThreadPool* _threadPool;
+
+  // Optional store of LoDs shared with other attribute coders
+  AttributeLodCache* _lodCache;
 };
 
 //============================================================================
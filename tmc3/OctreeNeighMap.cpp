@@ -50,31 +50,10 @@ updateGeometryOccupancyAtlas(
   MortonMap3D* occupancyAtlas,
   Vec3<int32_t>* atlasOrigin)
 {
-  const uint32_t mask = (1 << occupancyAtlas->cubeSizeLog2()) - 1;
-  const int shift = occupancyAtlas->cubeSizeLog2();
-  const int shiftX = (atlasShift & 4 ? 1 : 0);
-  const int shiftY = (atlasShift & 2 ? 1 : 0);
-  const int shiftZ = (atlasShift & 1 ? 1 : 0);
-
-  const auto currentOrigin = currentPosition >> shift;
-
-  // only refresh the atlas if the current position lies outside the
-  // the current atlas.
-  if (*atlasOrigin == currentOrigin) {
-    return;
-  }
-
-  *atlasOrigin = currentOrigin;
-  occupancyAtlas->clearUpdates();
-
-  for (auto it = fifo.begin(); it != fifoCurrLvlEnd; ++it) {
-    if (currentOrigin != it->pos >> shift)
-      break;
-    const uint32_t x = (it->pos[0] & mask) >> shiftX;
-    const uint32_t y = (it->pos[1] & mask) >> shiftY;
-    const uint32_t z = (it->pos[2] & mask) >> shiftZ;
-    occupancyAtlas->setByte(x, y, z, it->siblingOccupancy);
-  }
+  using NodeIt = ringbuf<PCCOctree3Node>::const_iterator;
+  updateGeometryOccupancyAtlas(
+    currentPosition, atlasShift, fifo.begin(), NodeIt(fifoCurrLvlEnd),
+    occupancyAtlas, atlasOrigin);
 }
 
 //----------------------------------------------------------------------------
@@ -212,6 +212,17 @@ GeometryNeighPattern makeGeometryNeighPattern(
   const int atlasShift,
   const MortonMap3D& occupancyAtlas);
 
+// populate (if necessary) the occupancy atlas with occupancy information
+// from the nodes in the range [@first, @last).
+template<typename NodeIt>
+void updateGeometryOccupancyAtlas(
+  const Vec3<int32_t>& position,
+  const int atlasShift,
+  NodeIt first,
+  NodeIt last,
+  MortonMap3D* occupancyAtlas,
+  Vec3<int32_t>* atlasOrigin);
+
 // populate (if necessary) the occupancy atlas with occupancy information
 // from @fifo.
 void updateGeometryOccupancyAtlas(
@@ -227,4 +238,45 @@ void updateGeometryOccupancyAtlasOccChild(
   uint8_t childOccupancy,
   MortonMap3D* occupancyAtlas);
 
+//============================================================================
+
+template<typename NodeIt>
+void
+updateGeometryOccupancyAtlas(
+  const Vec3<int32_t>& currentPosition,
+  const int atlasShift,
+  NodeIt first,
+  NodeIt last,
+  MortonMap3D* occupancyAtlas,
+  Vec3<int32_t>* atlasOrigin)
+{
+  const uint32_t mask = (1 << occupancyAtlas->cubeSizeLog2()) - 1;
+  const int shift = occupancyAtlas->cubeSizeLog2();
+  const int shiftX = (atlasShift & 4 ? 1 : 0);
+  const int shiftY = (atlasShift & 2 ? 1 : 0);
+  const int shiftZ = (atlasShift & 1 ? 1 : 0);
+
+  const auto currentOrigin = currentPosition >> shift;
+
+  // only refresh the atlas if the current position lies outside the
+  // the current atlas.
+  if (*atlasOrigin == currentOrigin) {
+    return;
+  }
+
+  *atlasOrigin = currentOrigin;
+  occupancyAtlas->clearUpdates();
+
+  for (auto it = first; it != last; ++it) {
+    if (currentOrigin != it->pos >> shift)
+      break;
+    const uint32_t x = (it->pos[0] & mask) >> shiftX;
+    const uint32_t y = (it->pos[1] & mask) >> shiftY;
+    const uint32_t z = (it->pos[2] & mask) >> shiftZ;
+    occupancyAtlas->setByte(x, y, z, it->siblingOccupancy);
+  }
+}
+
+//============================================================================
+
 }  // namespace pcc
@@ -447,6 +447,27 @@ public:
         std::next(reflectances.begin(), dstEnd));
   }
 
+  // Replace the contents with the points [begin, end) of src
+  void assign(const PCCPointSet3& src, size_t begin, size_t end)
+  {
+    addRemoveAttributes(src.hasColors(), src.hasReflectances());
+    resize(end - begin);
+
+    std::copy(
+      std::next(src.positions.begin(), begin),
+      std::next(src.positions.begin(), end), positions.begin());
+
+    if (hasColors())
+      std::copy(
+        std::next(src.colors.begin(), begin),
+        std::next(src.colors.begin(), end), colors.begin());
+
+    if (hasReflectances())
+      std::copy(
+        std::next(src.reflectances.begin(), begin),
+        std::next(src.reflectances.begin(), end), reflectances.begin());
+  }
+
   void swapPoints(const size_t index1, const size_t index2)
   {
     assert(index1 < getPointCount());
@@ -460,6 +481,20 @@ public:
     }
   }
 
+  // Reorder the points [begin, begin + order.size()) such that the point at
+  // begin + i becomes the point previously at index order[i].  Each array
+  // is reordered by a single gather, rather than by swapping points.
+  void permute(size_t begin, const std::vector<int32_t>& order)
+  {
+    permuteRange(positions, begin, order);
+    if (hasColors())
+      permuteRange(colors, begin, order);
+    if (hasReflectances())
+      permuteRange(reflectances, begin, order);
+    if (hasFrameIndex())
+      permuteRange(frameidx, begin, order);
+  }
+
   Box3<int32_t> computeBoundingBox() const
   {
     Box3<int32_t> bbox(
@@ -509,6 +544,16 @@ public:
   //--------------------------------------------------------------------------
 
 private:
+  template<typename T>
+  static void permuteRange(
+    std::vector<T>& values, size_t begin, const std::vector<int32_t>& order)
+  {
+    auto first = std::next(values.begin(), begin);
+    std::vector<T> src(first, std::next(first, order.size()));
+    for (size_t i = 0; i < order.size(); i++)
+      first[i] = src[order[i] - begin];
+  }
+
   std::vector<PointType> positions;
   std::vector<Vec3<attr_t>> colors;
   std::vector<attr_t> reflectances;
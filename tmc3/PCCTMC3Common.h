@@ -40,6 +40,8 @@
 #include "PCCPointSet.h"
 #include "constants.h"
 #include "hls.h"
+#include "lifting_kernels.h"
+#include "thread_pool.h"
 
 #include "nanoflann.hpp"
 
@@ -236,56 +238,6 @@ struct PCCNeighborInfo {
 struct PCCPredictor {
   uint32_t neighborCount;
   PCCNeighborInfo neighbors[kAttributePredictionMaxNeighbourCount];
-  int8_t predMode;
-  int64_t maxDiff;
-
-  Vec3<attr_t> predictColor(
-    const PCCPointSet3& pointCloud, const std::vector<uint32_t>& indexes) const
-  {
-    Vec3<int64_t> predicted(0);
-    if (predMode > neighborCount) {
-      /* nop */
-    } else if (predMode > 0) {
-      const Vec3<attr_t> color =
-        pointCloud.getColor(indexes[neighbors[predMode - 1].predictorIndex]);
-      for (size_t k = 0; k < 3; ++k) {
-        predicted[k] += color[k];
-      }
-    } else {
-      for (size_t i = 0; i < neighborCount; ++i) {
-        const Vec3<attr_t> color =
-          pointCloud.getColor(indexes[neighbors[i].predictorIndex]);
-        const uint32_t w = neighbors[i].weight;
-        for (size_t k = 0; k < 3; ++k) {
-          predicted[k] += w * color[k];
-        }
-      }
-      for (uint32_t k = 0; k < 3; ++k) {
-        predicted[k] =
-          divExp2RoundHalfInf(predicted[k], kFixedPointWeightShift);
-      }
-    }
-    return Vec3<attr_t>(predicted[0], predicted[1], predicted[2]);
-  }
-
-  int64_t predictReflectance(
-    const PCCPointSet3& pointCloud, const std::vector<uint32_t>& indexes) const
-  {
-    int64_t predicted(0);
-    if (predMode > neighborCount) {
-      /* nop */
-    } else if (predMode > 0) {
-      predicted = pointCloud.getReflectance(
-        indexes[neighbors[predMode - 1].predictorIndex]);
-    } else {
-      for (size_t i = 0; i < neighborCount; ++i) {
-        predicted += neighbors[i].weight
-          * pointCloud.getReflectance(indexes[neighbors[i].predictorIndex]);
-      }
-      predicted = divExp2RoundHalfInf(predicted, kFixedPointWeightShift);
-    }
-    return predicted;
-  }
 
   void computeWeights()
   {
@@ -372,7 +324,6 @@ struct PCCPredictor {
     neighborCount = (predictorIndex != PCC_UNDEFINED_INDEX) ? 1 : 0;
     neighbors[0].predictorIndex = predictorIndex;
     neighbors[0].weight = 1;
-    predMode = 0;
   }
 
   void init()
@@ -389,31 +340,13 @@ struct PCCPredictor {
 template<typename T>
 void
 PCCLiftPredict(
-  const std::vector<PCCPredictor>& predictors,
+  const PredictorStore& predictors,
   const size_t startIndex,
   const size_t endIndex,
   const bool direct,
   std::vector<T>& attributes)
 {
-  const size_t predictorCount = endIndex - startIndex;
-  for (size_t index = 0; index < predictorCount; ++index) {
-    const size_t predictorIndex = predictorCount - index - 1 + startIndex;
-    const auto& predictor = predictors[predictorIndex];
-    auto& attribute = attributes[predictorIndex];
-    T predicted(T(0));
-    for (size_t i = 0; i < predictor.neighborCount; ++i) {
-      const size_t neighborPredIndex = predictor.neighbors[i].predictorIndex;
-      const uint32_t weight = predictor.neighbors[i].weight;
-      assert(neighborPredIndex < startIndex);
-      predicted += weight * attributes[neighborPredIndex];
-    }
-    predicted = divExp2RoundHalfInf(predicted, kFixedPointWeightShift);
-    if (direct) {
-      attribute -= predicted;
-    } else {
-      attribute += predicted;
-    }
-  }
+  liftPredict(predictors, startIndex, endIndex, direct, attributes.data());
 }
 
 //---------------------------------------------------------------------------
@@ -421,48 +354,37 @@ PCCLiftPredict(
 template<typename T>
 void
 PCCLiftUpdate(
-  const std::vector<PCCPredictor>& predictors,
+  const PredictorStore& predictors,
   const std::vector<uint64_t>& quantizationWeights,
   const size_t startIndex,
   const size_t endIndex,
   const bool direct,
   std::vector<T>& attributes)
 {
-  std::vector<uint64_t> updateWeights;
-  updateWeights.resize(startIndex, uint64_t(0));
-  std::vector<T> updates;
-  updates.resize(startIndex);
-  for (size_t index = 0; index < startIndex; ++index) {
-    updates[index] = int64_t(0);
-  }
-  const size_t predictorCount = endIndex - startIndex;
-  for (size_t index = 0; index < predictorCount; ++index) {
-    const size_t predictorIndex = predictorCount - index - 1 + startIndex;
-    const auto& predictor = predictors[predictorIndex];
-    const auto currentQuantWeight = quantizationWeights[predictorIndex];
-    for (size_t i = 0; i < predictor.neighborCount; ++i) {
-      const size_t neighborPredIndex = predictor.neighbors[i].predictorIndex;
-      const auto weight = divExp2RoundHalfInf(
-        predictor.neighbors[i].weight * currentQuantWeight,
-        kFixedPointWeightShift);
-      assert(neighborPredIndex < startIndex);
-      updateWeights[neighborPredIndex] += weight;
-      updates[neighborPredIndex] += weight * attributes[predictorIndex];
-    }
-  }
-  for (size_t predictorIndex = 0; predictorIndex < startIndex;
-       ++predictorIndex) {
-    const uint32_t sumWeights = updateWeights[predictorIndex];
-    if (sumWeights) {
-      auto& update = updates[predictorIndex];
-      update = divApprox(update, sumWeights, 0);
-      auto& attribute = attributes[predictorIndex];
-      if (direct) {
-        attribute += update;
-      } else {
-        attribute -= update;
-      }
+  liftUpdate(
+    predictors, quantizationWeights.data(), startIndex, endIndex, direct,
+    attributes.data());
+}
+
+//---------------------------------------------------------------------------
+
+// Converts the predictors generated by the LoD builder into the compact
+// form retained for attribute coding.
+
+inline void
+compactPredictors(
+  const std::vector<PCCPredictor>& predictors, PredictorStore& store)
+{
+  store.resize(predictors.size());
+  for (size_t i = 0; i < predictors.size(); ++i) {
+    const auto& predictor = predictors[i];
+    uint32_t indexes[kAttributePredictionMaxNeighbourCount];
+    uint32_t weights[kAttributePredictionMaxNeighbourCount];
+    for (size_t k = 0; k < predictor.neighborCount; ++k) {
+      indexes[k] = predictor.neighbors[k].predictorIndex;
+      weights[k] = uint32_t(predictor.neighbors[k].weight);
     }
+    store.setNeighbors(i, predictor.neighborCount, indexes, weights);
   }
 }
 
@@ -470,7 +392,7 @@ PCCLiftUpdate(
 
 inline void
 PCCComputeQuantizationWeights(
-  const std::vector<PCCPredictor>& predictors,
+  const PredictorStore& predictors,
   std::vector<uint64_t>& quantizationWeights)
 {
   const size_t pointCount = predictors.size();
@@ -480,11 +402,12 @@ PCCComputeQuantizationWeights(
   }
   for (size_t i = 0; i < pointCount; ++i) {
     const size_t predictorIndex = pointCount - i - 1;
-    const auto& predictor = predictors[predictorIndex];
     const auto currentQuantWeight = quantizationWeights[predictorIndex];
-    for (size_t j = 0; j < predictor.neighborCount; ++j) {
-      const size_t neighborPredIndex = predictor.neighbors[j].predictorIndex;
-      const auto weight = predictor.neighbors[j].weight;
+    const int neighborCount = predictors.neighborCount(predictorIndex);
+    for (int j = 0; j < neighborCount; ++j) {
+      const size_t neighborPredIndex =
+        predictors.neighborIndex(predictorIndex, j);
+      const uint64_t weight = predictors.neighborWeight(predictorIndex, j);
       auto& neighborQuantWeight = quantizationWeights[neighborPredIndex];
       neighborQuantWeight += divExp2RoundHalfInf(
         weight * currentQuantWeight, kFixedPointWeightShift);
@@ -496,7 +419,7 @@ PCCComputeQuantizationWeights(
 
 inline void
 computeQuantizationWeightsScalable(
-  const std::vector<PCCPredictor>& predictors,
+  const PredictorStore& predictors,
   const std::vector<uint32_t>& numberOfPointsPerLOD,
   size_t numPoints,
   int32_t minGeomNodeSizeLog2,
@@ -642,7 +565,9 @@ computeNearestNeighbors(
   std::vector<PCCPredictor>& predictors,
   std::vector<uint32_t>& pointIndexToPredictorIndex,
   int32_t& predIndex,
-  MortonIndexMap3d& atlas)
+  MortonIndexMap3d& atlas,
+  std::vector<MortonIndexMap3d>& workerAtlases,
+  ThreadPool* threadPool)
 {
   constexpr auto searchRangeNear = 2;
   constexpr auto bucketSizeLog2 = 5;
@@ -695,8 +620,6 @@ computeNearestNeighbors(
   };
 
   atlas.reserve(retainedSize);
-  std::vector<int32_t> neighborIndexes;
-  neighborIndexes.reserve(64);
 
   BoxHierarchy<bucketSizeLog2, levelCount> hBBoxes;
   hBBoxes.resize(retainedSize);
@@ -726,106 +649,228 @@ computeNearestNeighbors(
   const auto bucketSize1Log2 = hBBoxes.bucketSizeLog2(1);
   const auto bucketSize2Log2 = hBBoxes.bucketSizeLog2(2);
 
-  int64_t atlasMortonCode = -1;
-  int64_t lastMortonCodeShift3 = -1;
-  int64_t cubeIndex = 0;
-  for (int32_t i = startIndex, j = 0; i < endIndex; ++i) {
-    int32_t localIndexes[3] = {-1, -1, -1};
-    int64_t minDistances[3] = {std::numeric_limits<int64_t>::max(),
-                               std::numeric_limits<int64_t>::max(),
-                               std::numeric_limits<int64_t>::max()};
-
-    const int32_t index = indexes[i];
-    const auto& pv = packedVoxel[index];
-    const int64_t mortonCode = pv.mortonCode;
-    const int64_t mortonCodeShift3 = mortonCode >> shift3;
-    const int64_t mortonCodeShiftBits3 = mortonCode >> shiftBits3;
-    const int32_t pointIndex = pv.index;
-    const auto point = pv.position;
-    const auto bpoint = pv.bposition;
-    indexes[i] = pointIndex;
-    auto& predictor = predictors[--predIndex];
-    pointIndexToPredictorIndex[pointIndex] = predIndex;
-
-    if (retainedSize) {
-      while (j < retainedSize - 1
-             && mortonCode >= packedVoxel[retained[j]].mortonCode) {
-        ++j;
-      }
+  // NB: indexes[i] is replaced by the point index only once every search
+  //     is complete, since the intra-lod search examines indexes[k > i].
+  const int32_t predIndexEnd = predIndex;
+  predIndex -= indexesSize;
+
+  // Find the neighbours of points [i0, i1), where the retained point search
+  // state (j, cubeIndex) is that of a search of every point before i0.
+  auto search = [&](
+                  int32_t i0, int32_t i1, int32_t j, int64_t cubeIndex,
+                  MortonIndexMap3d& atlas) {
+    std::vector<int32_t> neighborIndexes;
+    neighborIndexes.reserve(64);
+
+    int64_t atlasMortonCode = -1;
+    int64_t lastMortonCodeShift3 = -1;
+    for (int32_t i = i0; i < i1; ++i) {
+      int32_t localIndexes[3] = {-1, -1, -1};
+      int64_t minDistances[3] = {std::numeric_limits<int64_t>::max(),
+                                 std::numeric_limits<int64_t>::max(),
+                                 std::numeric_limits<int64_t>::max()};
+
+      const int32_t index = indexes[i];
+      const auto& pv = packedVoxel[index];
+      const int64_t mortonCode = pv.mortonCode;
+      const int64_t mortonCodeShift3 = mortonCode >> shift3;
+      const int64_t mortonCodeShiftBits3 = mortonCode >> shiftBits3;
+      const int32_t pointIndex = pv.index;
+      const auto point = pv.position;
+      const auto bpoint = pv.bposition;
+      const int32_t predictorIndex = predIndexEnd - 1 - (i - startIndex);
+      auto& predictor = predictors[predictorIndex];
+      pointIndexToPredictorIndex[pointIndex] = predictorIndex;
 
-      if (atlasMortonCode != mortonCodeShift3) {
-        atlas.clearUpdates();
-        atlasMortonCode = mortonCodeShift3;
-        while (cubeIndex < retainedSize
-               && (packedVoxel[retained[cubeIndex]].mortonCode >> shift3)
-                 == atlasMortonCode) {
-          atlas.set(
-            packedVoxel[retained[cubeIndex]].mortonCode >> shiftBits3,
-            cubeIndex);
-          ++cubeIndex;
+      if (retainedSize) {
+        while (j < retainedSize - 1
+               && mortonCode >= packedVoxel[retained[j]].mortonCode) {
+          ++j;
         }
-      }
 
-      if (lastMortonCodeShift3 != mortonCodeShiftBits3) {
-        lastMortonCodeShift3 = mortonCodeShiftBits3;
-        const auto basePosition = morton3dAdd(mortonCodeShiftBits3, -1ll);
-        neighborIndexes.resize(0);
-        for (int32_t n = 0; n < 27; ++n) {
-          const auto neighbMortonCode =
-            morton3dAdd(basePosition, kNeighOffset[n]);
-          if ((neighbMortonCode >> log2CubeSize3) != atlasMortonCode) {
-            continue;
+        if (atlasMortonCode != mortonCodeShift3) {
+          atlas.clearUpdates();
+          atlasMortonCode = mortonCodeShift3;
+          while (cubeIndex < retainedSize
+                 && (packedVoxel[retained[cubeIndex]].mortonCode >> shift3)
+                   == atlasMortonCode) {
+            atlas.set(
+              packedVoxel[retained[cubeIndex]].mortonCode >> shiftBits3,
+              cubeIndex);
+            ++cubeIndex;
           }
-          const auto range = atlas.get(neighbMortonCode);
-          for (int32_t k = range.start; k < range.end; ++k) {
-            neighborIndexes.push_back(k);
+        }
+
+        if (lastMortonCodeShift3 != mortonCodeShiftBits3) {
+          lastMortonCodeShift3 = mortonCodeShiftBits3;
+          const auto basePosition = morton3dAdd(mortonCodeShiftBits3, -1ll);
+          neighborIndexes.resize(0);
+          for (int32_t n = 0; n < 27; ++n) {
+            const auto neighbMortonCode =
+              morton3dAdd(basePosition, kNeighOffset[n]);
+            if ((neighbMortonCode >> log2CubeSize3) != atlasMortonCode) {
+              continue;
+            }
+            const auto range = atlas.get(neighbMortonCode);
+            for (int32_t k = range.start; k < range.end; ++k) {
+              neighborIndexes.push_back(k);
+            }
           }
         }
-      }
 
-      for (const auto k : neighborIndexes) {
-        updateNearestNeigh(
-          bpoint, packedVoxel[retained[k]].bposition, k, localIndexes,
-          minDistances);
-      }
+        for (const auto k : neighborIndexes) {
+          updateNearestNeigh(
+            bpoint, packedVoxel[retained[k]].bposition, k, localIndexes,
+            minDistances);
+        }
 
-      if (localIndexes[2] == -1) {
-        const auto center = localIndexes[0] == -1 ? j : localIndexes[0];
-        const auto k0 = std::max(0, center - rangeInterLod);
-        const auto k1 = std::min(retainedSize - 1, center + rangeInterLod);
-        updateNearestNeighWithCheck(
-          bpoint, packedVoxel[retained[center]].bposition, center,
-          localIndexes, minDistances);
-        for (int32_t n = 1; n <= searchRangeNear; ++n) {
-          const int32_t kp = center + n;
-          if (kp <= k1) {
-            updateNearestNeighWithCheck(
-              bpoint, packedVoxel[retained[kp]].bposition, kp, localIndexes,
-              minDistances);
+        if (localIndexes[2] == -1) {
+          const auto center = localIndexes[0] == -1 ? j : localIndexes[0];
+          const auto k0 = std::max(0, center - rangeInterLod);
+          const auto k1 = std::min(retainedSize - 1, center + rangeInterLod);
+          updateNearestNeighWithCheck(
+            bpoint, packedVoxel[retained[center]].bposition, center,
+            localIndexes, minDistances);
+          for (int32_t n = 1; n <= searchRangeNear; ++n) {
+            const int32_t kp = center + n;
+            if (kp <= k1) {
+              updateNearestNeighWithCheck(
+                bpoint, packedVoxel[retained[kp]].bposition, kp, localIndexes,
+                minDistances);
+            }
+            const int32_t kn = center - n;
+            if (kn >= k0) {
+              updateNearestNeighWithCheck(
+                bpoint, packedVoxel[retained[kn]].bposition, kn, localIndexes,
+                minDistances);
+            }
           }
-          const int32_t kn = center - n;
-          if (kn >= k0) {
-            updateNearestNeighWithCheck(
-              bpoint, packedVoxel[retained[kn]].bposition, kn, localIndexes,
-              minDistances);
+
+          const int32_t p1 =
+            std::min(retainedSize - 1, center + searchRangeNear + 1);
+          const int32_t p0 = std::max(0, center - searchRangeNear - 1);
+
+          // search p1...k1
+          const int32_t b21 = k1 >> bucketSize2Log2;
+          const int32_t b20 = p1 >> bucketSize2Log2;
+          const int32_t b11 = k1 >> bucketSize1Log2;
+          const int32_t b10 = p1 >> bucketSize1Log2;
+          const int32_t b01 = k1 >> bucketSize0Log2;
+          const int32_t b00 = p1 >> bucketSize0Log2;
+          for (int32_t b2 = b20; b2 <= b21; ++b2) {
+            if (
+              localIndexes[2] != -1
+              && hBBoxes.bBox(b2, 2).getDist1(bpoint) >= minDistances[2])
+              continue;
+
+            const auto alignedIndex1 = b2 << bucketSizeLog2;
+            const auto start1 = std::max(b10, alignedIndex1);
+            const auto end1 = std::min(b11, alignedIndex1 + bucketSizeMinus1);
+            for (int32_t b1 = start1; b1 <= end1; ++b1) {
+              if (
+                localIndexes[2] != -1
+                && hBBoxes.bBox(b1, 1).getDist1(bpoint) >= minDistances[2])
+                continue;
+
+              const auto alignedIndex0 = b1 << bucketSizeLog2;
+              const auto start0 = std::max(b00, alignedIndex0);
+              const auto end0 =
+                std::min(b01, alignedIndex0 + bucketSizeMinus1);
+              for (int32_t b0 = start0; b0 <= end0; ++b0) {
+                if (
+                  localIndexes[2] != -1
+                  && hBBoxes.bBox(b0, 0).getDist1(bpoint) >= minDistances[2])
+                  continue;
+
+                const int32_t alignedIndex = b0 << bucketSizeLog2;
+                const int32_t h0 = std::max(p1, alignedIndex);
+                const int32_t h1 =
+                  std::min(k1, alignedIndex + bucketSizeMinus1);
+                for (int32_t k = h0; k <= h1; ++k) {
+                  updateNearestNeighWithCheck(
+                    bpoint, packedVoxel[retained[k]].bposition, k,
+                    localIndexes, minDistances);
+                }
+              }
+            }
+          }
+
+          // search k0...p1
+          const int32_t c21 = p0 >> bucketSize2Log2;
+          const int32_t c20 = k0 >> bucketSize2Log2;
+          const int32_t c11 = p0 >> bucketSize1Log2;
+          const int32_t c10 = k0 >> bucketSize1Log2;
+          const int32_t c01 = p0 >> bucketSize0Log2;
+          const int32_t c00 = k0 >> bucketSize0Log2;
+          for (int32_t c2 = c21; c2 >= c20; --c2) {
+            if (
+              localIndexes[2] != -1
+              && hBBoxes.bBox(c2, 2).getDist1(bpoint) >= minDistances[2])
+              continue;
+
+            const auto alignedIndex1 = c2 << bucketSizeLog2;
+            const auto start1 = std::max(c10, alignedIndex1);
+            const auto end1 = std::min(c11, alignedIndex1 + bucketSizeMinus1);
+            for (int32_t c1 = end1; c1 >= start1; --c1) {
+              if (
+                localIndexes[2] != -1
+                && hBBoxes.bBox(c1, 1).getDist1(bpoint) >= minDistances[2])
+                continue;
+
+              const auto alignedIndex0 = c1 << bucketSizeLog2;
+              const auto start0 = std::max(c00, alignedIndex0);
+              const auto end0 =
+                std::min(c01, alignedIndex0 + bucketSizeMinus1);
+              for (int32_t c0 = end0; c0 >= start0; --c0) {
+                if (
+                  localIndexes[2] != -1
+                  && hBBoxes.bBox(c0, 0).getDist1(bpoint) >= minDistances[2])
+                  continue;
+
+                const int32_t alignedIndex = c0 << bucketSizeLog2;
+                const int32_t h0 = std::max(k0, alignedIndex);
+                const int32_t h1 =
+                  std::min(p0, alignedIndex + bucketSizeMinus1);
+                for (int32_t k = h1; k >= h0; --k) {
+                  updateNearestNeighWithCheck(
+                    bpoint, packedVoxel[retained[k]].bposition, k,
+                    localIndexes, minDistances);
+                }
+              }
+            }
           }
         }
 
-        const int32_t p1 =
-          std::min(retainedSize - 1, center + searchRangeNear + 1);
-        const int32_t p0 = std::max(0, center - searchRangeNear - 1);
+        predictor.neighborCount = (localIndexes[0] != -1)
+          + (localIndexes[1] != -1) + (localIndexes[2] != -1);
 
-        // search p1...k1
+        for (int32_t h = 0; h < predictor.neighborCount; ++h)
+          localIndexes[h] = retained[localIndexes[h]];
+      }
+
+      if (aps.intra_lod_prediction_enabled_flag) {
+        const int32_t k00 = i + 1;
+        const int32_t k01 = std::min(endIndex - 1, k00 + searchRangeNear);
+        for (int32_t k = k00; k <= k01; ++k) {
+          updateNearestNeigh(
+            bpoint, packedVoxel[indexes[k]].bposition, indexes[k],
+            localIndexes, minDistances);
+        }
+        const int32_t k0 = k01 + 1 - startIndex;
+        const int32_t k1 =
+          std::min(endIndex - 1, k00 + rangeIntraLod) - startIndex;
+
+        // search k0...k1
         const int32_t b21 = k1 >> bucketSize2Log2;
-        const int32_t b20 = p1 >> bucketSize2Log2;
+        const int32_t b20 = k0 >> bucketSize2Log2;
         const int32_t b11 = k1 >> bucketSize1Log2;
-        const int32_t b10 = p1 >> bucketSize1Log2;
+        const int32_t b10 = k0 >> bucketSize1Log2;
         const int32_t b01 = k1 >> bucketSize0Log2;
-        const int32_t b00 = p1 >> bucketSize0Log2;
+        const int32_t b00 = k0 >> bucketSize0Log2;
         for (int32_t b2 = b20; b2 <= b21; ++b2) {
           if (
             localIndexes[2] != -1
-            && hBBoxes.bBox(b2, 2).getDist1(bpoint) >= minDistances[2])
+            && hIntraBBoxes.bBox(b2, 2).getDist1(bpoint) >= minDistances[2])
             continue;
 
           const auto alignedIndex1 = b2 << bucketSizeLog2;
@@ -834,7 +879,7 @@ computeNearestNeighbors(
           for (int32_t b1 = start1; b1 <= end1; ++b1) {
             if (
               localIndexes[2] != -1
-              && hBBoxes.bBox(b1, 1).getDist1(bpoint) >= minDistances[2])
+              && hIntraBBoxes.bBox(b1, 1).getDist1(bpoint) >= minDistances[2])
               continue;
 
             const auto alignedIndex0 = b1 << bucketSizeLog2;
@@ -843,160 +888,128 @@ computeNearestNeighbors(
             for (int32_t b0 = start0; b0 <= end0; ++b0) {
               if (
                 localIndexes[2] != -1
-                && hBBoxes.bBox(b0, 0).getDist1(bpoint) >= minDistances[2])
+                && hIntraBBoxes.bBox(b0, 0).getDist1(bpoint)
+                  >= minDistances[2])
                 continue;
 
               const int32_t alignedIndex = b0 << bucketSizeLog2;
-              const int32_t h0 = std::max(p1, alignedIndex);
+              const int32_t h0 = std::max(k0, alignedIndex);
               const int32_t h1 = std::min(k1, alignedIndex + bucketSizeMinus1);
-              for (int32_t k = h0; k <= h1; ++k) {
-                updateNearestNeighWithCheck(
-                  bpoint, packedVoxel[retained[k]].bposition, k, localIndexes,
-                  minDistances);
+              for (int32_t h = h0; h <= h1; ++h) {
+                const int32_t k = startIndex + h;
+                updateNearestNeigh(
+                  bpoint, packedVoxel[indexes[k]].bposition, indexes[k],
+                  localIndexes, minDistances);
               }
             }
           }
         }
+      }
 
-        // search k0...p1
-        const int32_t c21 = p0 >> bucketSize2Log2;
-        const int32_t c20 = k0 >> bucketSize2Log2;
-        const int32_t c11 = p0 >> bucketSize1Log2;
-        const int32_t c10 = k0 >> bucketSize1Log2;
-        const int32_t c01 = p0 >> bucketSize0Log2;
-        const int32_t c00 = k0 >> bucketSize0Log2;
-        for (int32_t c2 = c21; c2 >= c20; --c2) {
-          if (
-            localIndexes[2] != -1
-            && hBBoxes.bBox(c2, 2).getDist1(bpoint) >= minDistances[2])
-            continue;
+      predictor.neighborCount = std::min(
+        aps.num_pred_nearest_neighbours_minus1 + 1,
+        (localIndexes[0] != -1) + (localIndexes[1] != -1)
+          + (localIndexes[2] != -1));
+      for (int32_t h = 0; h < predictor.neighborCount; ++h) {
+        auto& neigh = predictor.neighbors[h];
+        neigh.predictorIndex = packedVoxel[localIndexes[h]].index;
+        neigh.weight =
+          (packedVoxel[localIndexes[h]].bposition - bpoint)
+            .getNorm2<int64_t>();
+      }
 
-          const auto alignedIndex1 = c2 << bucketSizeLog2;
-          const auto start1 = std::max(c10, alignedIndex1);
-          const auto end1 = std::min(c11, alignedIndex1 + bucketSizeMinus1);
-          for (int32_t c1 = end1; c1 >= start1; --c1) {
+      if (predictor.neighborCount > 1) {
+        auto predTmp = predictor.neighbors[1];
+        if (predictor.neighbors[0].weight > predictor.neighbors[1].weight) {
+          predictor.neighbors[1] = predictor.neighbors[0];
+          predictor.neighbors[0] = predTmp;
+        }
+        if (predictor.neighborCount == 3) {
+          if (predictor.neighbors[1].weight > predictor.neighbors[2].weight) {
+            predTmp = predictor.neighbors[2];
+            predictor.neighbors[2] = predictor.neighbors[1];
+            predictor.neighbors[1] = predTmp;
             if (
-              localIndexes[2] != -1
-              && hBBoxes.bBox(c1, 1).getDist1(bpoint) >= minDistances[2])
-              continue;
-
-            const auto alignedIndex0 = c1 << bucketSizeLog2;
-            const auto start0 = std::max(c00, alignedIndex0);
-            const auto end0 = std::min(c01, alignedIndex0 + bucketSizeMinus1);
-            for (int32_t c0 = end0; c0 >= start0; --c0) {
-              if (
-                localIndexes[2] != -1
-                && hBBoxes.bBox(c0, 0).getDist1(bpoint) >= minDistances[2])
-                continue;
-
-              const int32_t alignedIndex = c0 << bucketSizeLog2;
-              const int32_t h0 = std::max(k0, alignedIndex);
-              const int32_t h1 = std::min(p0, alignedIndex + bucketSizeMinus1);
-              for (int32_t k = h1; k >= h0; --k) {
-                updateNearestNeighWithCheck(
-                  bpoint, packedVoxel[retained[k]].bposition, k, localIndexes,
-                  minDistances);
-              }
+              predictor.neighbors[0].weight
+              > predictor.neighbors[1].weight) {
+              predTmp = predictor.neighbors[1];
+              predictor.neighbors[1] = predictor.neighbors[0];
+              predictor.neighbors[0] = predTmp;
             }
           }
         }
       }
-
-      predictor.neighborCount = (localIndexes[0] != -1)
-        + (localIndexes[1] != -1) + (localIndexes[2] != -1);
-
-      for (int32_t h = 0; h < predictor.neighborCount; ++h)
-        localIndexes[h] = retained[localIndexes[h]];
     }
+  };
 
-    if (aps.intra_lod_prediction_enabled_flag) {
-      const int32_t k00 = i + 1;
-      const int32_t k01 = std::min(endIndex - 1, k00 + searchRangeNear);
-      for (int32_t k = k00; k <= k01; ++k) {
-        updateNearestNeigh(
-          bpoint, packedVoxel[indexes[k]].bposition, indexes[k], localIndexes,
-          minDistances);
-      }
-      const int32_t k0 = k01 + 1 - startIndex;
-      const int32_t k1 =
-        std::min(endIndex - 1, k00 + rangeIntraLod) - startIndex;
-
-      // search k0...k1
-      const int32_t b21 = k1 >> bucketSize2Log2;
-      const int32_t b20 = k0 >> bucketSize2Log2;
-      const int32_t b11 = k1 >> bucketSize1Log2;
-      const int32_t b10 = k0 >> bucketSize1Log2;
-      const int32_t b01 = k1 >> bucketSize0Log2;
-      const int32_t b00 = k0 >> bucketSize0Log2;
-      for (int32_t b2 = b20; b2 <= b21; ++b2) {
-        if (
-          localIndexes[2] != -1
-          && hIntraBBoxes.bBox(b2, 2).getDist1(bpoint) >= minDistances[2])
-          continue;
+  // Large levels of detail are split into chunks that are searched
+  // concurrently, each using a separate atlas.
+  constexpr int32_t kMinChunkSize = 4096;
+  int numChunks = 1;
+  if (threadPool && retainedSize)
+    numChunks =
+      std::min(threadPool->numThreads(), indexesSize / kMinChunkSize);
 
-        const auto alignedIndex1 = b2 << bucketSizeLog2;
-        const auto start1 = std::max(b10, alignedIndex1);
-        const auto end1 = std::min(b11, alignedIndex1 + bucketSizeMinus1);
-        for (int32_t b1 = start1; b1 <= end1; ++b1) {
-          if (
-            localIndexes[2] != -1
-            && hIntraBBoxes.bBox(b1, 1).getDist1(bpoint) >= minDistances[2])
-            continue;
+  if (numChunks < 2) {
+    search(startIndex, endIndex, 0, 0, atlas);
+  } else {
+    auto chunkStart = [=](int c) {
+      return startIndex + int32_t(int64_t(indexesSize) * c / numChunks);
+    };
+
+    // Determine the retained point search state at the start of each chunk
+    // by replaying the serial search.  A chunk that starts within the cube
+    // of its predecessor must refill the atlas with the whole cube.
+    std::vector<int32_t> chunkJ(numChunks);
+    std::vector<int64_t> chunkCubeIndex(numChunks);
+    int64_t atlasMortonCode = -1;
+    int64_t cubeIndex = 0;
+    int64_t cubeStartIndex = 0;
+    for (int32_t i = startIndex, j = 0, c = 0; i < endIndex; ++i) {
+      const int64_t mortonCode = packedVoxel[indexes[i]].mortonCode;
+      const int64_t mortonCodeShift3 = mortonCode >> shift3;
+      if (c < numChunks && i == chunkStart(c)) {
+        chunkJ[c] = j;
+        chunkCubeIndex[c] =
+          atlasMortonCode == mortonCodeShift3 ? cubeStartIndex : cubeIndex;
+        c++;
+      }
 
-          const auto alignedIndex0 = b1 << bucketSizeLog2;
-          const auto start0 = std::max(b00, alignedIndex0);
-          const auto end0 = std::min(b01, alignedIndex0 + bucketSizeMinus1);
-          for (int32_t b0 = start0; b0 <= end0; ++b0) {
-            if (
-              localIndexes[2] != -1
-              && hIntraBBoxes.bBox(b0, 0).getDist1(bpoint) >= minDistances[2])
-              continue;
+      while (j < retainedSize - 1
+             && mortonCode >= packedVoxel[retained[j]].mortonCode) {
+        ++j;
+      }
 
-            const int32_t alignedIndex = b0 << bucketSizeLog2;
-            const int32_t h0 = std::max(k0, alignedIndex);
-            const int32_t h1 = std::min(k1, alignedIndex + bucketSizeMinus1);
-            for (int32_t h = h0; h <= h1; ++h) {
-              const int32_t k = startIndex + h;
-              updateNearestNeigh(
-                bpoint, packedVoxel[indexes[k]].bposition, indexes[k],
-                localIndexes, minDistances);
-            }
-          }
+      if (atlasMortonCode != mortonCodeShift3) {
+        atlasMortonCode = mortonCodeShift3;
+        cubeStartIndex = cubeIndex;
+        while (cubeIndex < retainedSize
+               && (packedVoxel[retained[cubeIndex]].mortonCode >> shift3)
+                 == atlasMortonCode) {
+          ++cubeIndex;
         }
       }
     }
 
-    predictor.neighborCount = std::min(
-      aps.num_pred_nearest_neighbours_minus1 + 1,
-      (localIndexes[0] != -1) + (localIndexes[1] != -1)
-        + (localIndexes[2] != -1));
-    for (int32_t h = 0; h < predictor.neighborCount; ++h) {
-      auto& neigh = predictor.neighbors[h];
-      neigh.predictorIndex = packedVoxel[localIndexes[h]].index;
-      neigh.weight =
-        (packedVoxel[localIndexes[h]].bposition - bpoint).getNorm2<int64_t>();
+    while (workerAtlases.size() < size_t(numChunks - 1)) {
+      workerAtlases.emplace_back();
+      workerAtlases.back().resize(log2CubeSize);
+      workerAtlases.back().init();
     }
 
-    if (predictor.neighborCount > 1) {
-      auto predTmp = predictor.neighbors[1];
-      if (predictor.neighbors[0].weight > predictor.neighbors[1].weight) {
-        predictor.neighbors[1] = predictor.neighbors[0];
-        predictor.neighbors[0] = predTmp;
+    parallelFor(threadPool, numChunks, [&](size_t begin, size_t end) {
+      for (int c = int(begin); c < int(end); c++) {
+        auto& chunkAtlas = c ? workerAtlases[c - 1] : atlas;
+        chunkAtlas.reserve(retainedSize);
+        search(
+          chunkStart(c), chunkStart(c + 1), chunkJ[c], chunkCubeIndex[c],
+          chunkAtlas);
       }
-      if (predictor.neighborCount == 3) {
-        if (predictor.neighbors[1].weight > predictor.neighbors[2].weight) {
-          predTmp = predictor.neighbors[2];
-          predictor.neighbors[2] = predictor.neighbors[1];
-          predictor.neighbors[1] = predTmp;
-          if (predictor.neighbors[0].weight > predictor.neighbors[1].weight) {
-            predTmp = predictor.neighbors[1];
-            predictor.neighbors[1] = predictor.neighbors[0];
-            predictor.neighbors[0] = predTmp;
-          }
-        }
-      }
-    }
+    });
   }
+
+  for (int32_t i = startIndex; i < endIndex; ++i)
+    indexes[i] = packedVoxel[indexes[i]].index;
 }
 
 //---------------------------------------------------------------------------
@@ -1690,7 +1703,8 @@ buildPredictorsFast(
   int geom_num_points_minus1,
   std::vector<PCCPredictor>& predictors,
   std::vector<uint32_t>& numberOfPointsPerLevelOfDetail,
-  std::vector<uint32_t>& indexes)
+  std::vector<uint32_t>& indexes,
+  ThreadPool* threadPool = nullptr)
 {
   const int32_t pointCount = int32_t(pointCloud.getPointCount());
   assert(pointCount);
@@ -1735,6 +1749,9 @@ buildPredictorsFast(
   atlas.resize(log2CubeSize);
   atlas.init();
 
+  // Additional atlases used by concurrent neighbour searches
+  std::vector<MortonIndexMap3d> workerAtlases;
+
   int32_t predIndex = int32_t(pointCount);
   for (auto lodIndex = minGeomNodeSizeLog2;
        !input.empty() && lodIndex <= num_detail_levels; ++lodIndex) {
@@ -1788,7 +1805,8 @@ buildPredictorsFast(
     else
       computeNearestNeighbors(
         aps, abh, packedVoxel, retained, startIndex, endIndex, lodIndex,
-        indexes, predictors, pointIndexToPredictorIndex, predIndex, atlas);
+        indexes, predictors, pointIndexToPredictorIndex, predIndex, atlas,
+        workerAtlases, threadPool);
 
     if (!retained.empty()) {
       numberOfPointsPerLevelOfDetail.push_back(retained.size());
@@ -36,7 +36,11 @@
 #pragma once
 
 #include <functional>
+#include <future>
 #include <map>
+#include <memory>
+#include <sstream>
+#include <vector>
 
 #include "Attribute.h"
 #include "PayloadBuffer.h"
@@ -44,6 +48,7 @@
 #include "PCCPointSet.h"
 #include "hls.h"
 #include "geometry.h"
+#include "thread_pool.h"
 
 namespace pcc {
 
@@ -57,6 +62,15 @@ struct DecoderParams {
 
   // A maximum number of points to partially decode.
   int decodeMaxPoints;
+
+  // Number of worker threads used to decode independent slices, or to
+  // overlap the decoding of slices with entropy continuation.
+  // Values less than two select the serial slice decoder.
+  int numThreads;
+
+  // Maximum number of attribute LoDs retained for reuse by subsequent
+  // slices with identical geometry.  A value of 0 disables the cache.
+  int lodCacheSize;
 };
 
 //============================================================================
@@ -74,7 +88,25 @@ public:
 
   void init();
 
-  int decompress(const PayloadBuffer* buf, Callbacks* callback);
+  // Decode a single data unit, or flush the decoder if buf is null.
+  // NB: the data unit is referenced, not copied, and its storage must remain
+  //     valid until the frame containing it has been output.
+  int decompress(const PayloadView* buf, Callbacks* callback);
+
+  // Create a decoder for an independently decodable frame that shares the
+  // parameter sets received by this decoder.
+  std::unique_ptr<PCCTMC3Decoder3> cloneForFrame() const;
+
+  // Determine the frame_idx of a geometry brick using the received
+  // parameter sets.
+  int peekFrameIdx(const PayloadView& buf);
+
+  // Determine if the frame starting with a geometry brick may be decoded
+  // independently of the preceding frames using the received parameter
+  // sets, ie, by a decoder created with cloneForFrame().
+  bool isIndependentFrame(const PayloadView& buf);
+
+  void setLogStream(std::ostream* log) { _log = log; }
 
   //==========================================================================
 
@@ -86,10 +118,28 @@ public:
   //==========================================================================
 
 private:
+  // Construct a decoder that shares an existing LoD cache
+  PCCTMC3Decoder3(
+    const DecoderParams& params, std::shared_ptr<AttributeLodCache> lodCache);
+
   void activateParameterSets(const GeometryBrickHeader& gbh);
-  int decodeGeometryBrick(const PayloadBuffer& buf);
-  void decodeAttributeBrick(const PayloadBuffer& buf);
-  void decodeConstantAttribute(const PayloadBuffer& buf);
+  void shareParameterSets(PCCTMC3Decoder3* decoder) const;
+  void accumulateSlice();
+  bool decodeSlicesConcurrently() const;
+  int decodeBufferedSlice();
+  int decodeSliceGeometry(const PayloadView& buf);
+  void dispatchSlice();
+  void collectSlices();
+  bool decodeAttributesConcurrently() const;
+  void dispatchAttributes();
+  void collectAttributes();
+  int decodeGeometryBrick(const PayloadView& buf);
+  void decodeAttributeBricks(const std::vector<PayloadView>& bufs);
+  bool decodeAttributeBricksFused(const PayloadView* bufs, size_t count);
+  AttributeBrickDecoding
+  parseAttributeBrick(const PayloadView& buf, AttributeBrickHeader* abh);
+  void decodeAttributeBrick(const PayloadView& buf);
+  void decodeConstantAttribute(const PayloadView& buf);
   bool frameIdxChanged(const GeometryBrickHeader& gbh) const;
 
   //==========================================================================
@@ -119,12 +169,14 @@ private:
   PCCPointSet3 _accumCloud;
 
   // Received parameter sets, mapping parameter set id -> parameterset
-  std::map<int, SequenceParameterSet> _spss;
-  std::map<int, GeometryParameterSet> _gpss;
-  std::map<int, AttributeParameterSet> _apss;
+  // NB: parameter sets are immutable once received and may be shared
+  //     with the decoders of concurrently decoded slices and frames.
+  std::map<int, std::shared_ptr<const SequenceParameterSet>> _spss;
+  std::map<int, std::shared_ptr<const GeometryParameterSet>> _gpss;
+  std::map<int, std::shared_ptr<const AttributeParameterSet>> _apss;
 
   // Metadata that allows slices/tiles to be indentified by their bounding box
-  TileInventory _tileInventory;
+  std::shared_ptr<const TileInventory> _tileInventory;
 
   // The active SPS
   const SequenceParameterSet* _sps;
@@ -140,6 +192,44 @@ private:
 
   // Attribute decoder for reuse between attributes of same slice
   std::unique_ptr<AttributeDecoderIntf> _attrDecoder;
+
+  // Payloads of the slice being buffered for concurrent decoding
+  std::vector<PayloadView> _slicePayloads;
+
+  // Slices being decoded concurrently, in bitstream order
+  struct SliceTask {
+    std::unique_ptr<PCCTMC3Decoder3> decoder;
+    std::unique_ptr<std::ostringstream> log;
+    std::future<void> done;
+  };
+  std::vector<SliceTask> _sliceTasks;
+
+  // Attribute data units of the current slice, buffered until the slice is
+  // complete, and progress messages of the current slice
+  std::vector<PayloadView> _attrPayloads;
+  std::unique_ptr<std::ostringstream> _sliceLog;
+
+  // Decoder of the previous slice's attributes, which runs concurrently
+  // with the geometry decoding of the current slice.
+  // NB: the attribute contexts are retained between slices
+  std::unique_ptr<PCCTMC3Decoder3> _attrStage;
+  std::unique_ptr<std::ostringstream> _attrStageLog;
+  std::future<void> _attrStageDone;
+
+  // Workers used to decode slices concurrently.
+  // NB: declared after _sliceTasks and _attrStage so that pending tasks
+  //     complete first
+  std::unique_ptr<ThreadPool> _threadPool;
+
+  // Workers that a slice or attribute stage decoder may use to generate
+  // levels of detail (owned by the dispatching decoder)
+  ThreadPool* _lodThreadPool;
+
+  // Attribute LoDs shared with slice and frame decoders
+  std::shared_ptr<AttributeLodCache> _lodCache;
+
+  // Destination for decoder progress messages
+  std::ostream* _log;
 };
 
 //----------------------------------------------------------------------------
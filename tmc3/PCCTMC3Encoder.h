@@ -37,6 +37,8 @@
 
 #include <functional>
 #include <map>
+#include <memory>
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -49,6 +51,7 @@
 #include "hls.h"
 #include "partitioning.h"
 #include "geometry.h"
+#include "thread_pool.h"
 
 namespace pcc {
 
@@ -119,6 +122,18 @@ struct EncoderParams {
 
   // Qp used for IDCM quantisation (used to derive HLS values)
   int idcmQp;
+
+  // Number of worker threads used to encode independent slices.
+  // Values less than two select the serial slice encoder.
+  int numThreads;
+
+  // Reset the entropy state at the start of every slice, rather than only
+  // at the start of each frame, when entropy continuation is enabled.
+  bool independentSlices;
+
+  // Maximum number of attribute LoDs retained for reuse by subsequent
+  // slices with identical geometry.  A value of 0 disables the cache.
+  int lodCacheSize;
 };
 
 //============================================================================
@@ -134,14 +149,28 @@ public:
   PCCTMC3Encoder3& operator=(PCCTMC3Encoder3&& rhs) = default;
   ~PCCTMC3Encoder3();
 
+  // Create an encoder that codes further frames of the same sequence
+  // independently of this encoder.  The first frame that it codes is
+  // numbered frameCounter.
+  // NB: this encoder must have coded at least one frame.
+  // NB: the frames are only independent if entropy continuation is enabled,
+  //     otherwise the saved context state is carried between frames.
+  std::unique_ptr<PCCTMC3Encoder3> cloneForFrame(int frameCounter) const;
+
+  // Redirect progress messages (stdout by default)
+  void setLogStream(std::ostream* log) { _log = log; }
+
   int compress(
     const PCCPointSet3& inputPointCloud,
     EncoderParams* params,
     Callbacks*,
     PCCPointSet3* reconstructedCloud = nullptr);
 
+  // Encode the points [pointBegin, pointEnd) of cloud as a single slice
   void compressPartition(
-    const PCCPointSet3& inputPointCloud,
+    const PCCPointSet3& cloud,
+    int pointBegin,
+    int pointEnd,
     const PCCPointSet3& originPartCloud,
     EncoderParams* params,
     Callbacks*,
@@ -151,11 +180,51 @@ public:
   static void fixupParameterSets(EncoderParams* params);
 
 private:
+  void compressSlicesConcurrently(
+    const PCCPointSet3& inputPointCloud,
+    const SrcMappedPointSet& quantizedInput,
+    const std::vector<Partition>& slices,
+    EncoderParams* params,
+    Callbacks*,
+    PCCPointSet3* reconstructedCloud);
+
   void appendReconstructedPoints(PCCPointSet3* reconstructedCloud);
 
+  bool continuesEntropyState(
+    const EncoderParams* params, bool firstSliceInFrame) const;
+
   void encodeGeometryBrick(const EncoderParams*, PayloadBuffer* buf);
 
-  SrcMappedPointSet quantization(const PCCPointSet3& src);
+  void compressAttributesConcurrently(
+    const EncoderParams*, int numInputPoints, Callbacks*);
+
+  void encodeAttributeBrick(
+    const EncoderParams*,
+    int attrIdx,
+    int numInputPoints,
+    std::unique_ptr<AttributeEncoderIntf>* attrEncoder,
+    PayloadBuffer* buf,
+    std::ostream* log);
+
+  bool encodeAttributeBricksFused(
+    const EncoderParams*,
+    int numInputPoints,
+    std::unique_ptr<AttributeEncoderIntf>* attrEncoder,
+    Callbacks*);
+
+  AttributeBrickHeader
+  makeAttributeBrickHeader(const EncoderParams*, int attrIdx) const;
+
+  SrcMappedPointSet
+  quantization(const PCCPointSet3& src, ThreadPool* threadPool);
+
+  // The shared thread pool for numThreads workers, or nullptr if only a
+  // single thread is to be used.
+  ThreadPool* getThreadPool(int numThreads);
+
+  // The LoD cache holding at most maxEntries entries, or nullptr if
+  // maxEntries is 0.
+  AttributeLodCache* getLodCache(int maxEntries);
 
 private:
   PCCPointSet3 pointCloud;
@@ -198,6 +267,15 @@ private:
   std::unique_ptr<PredGeomContexts> _ctxtMemPredGeom;
   std::vector<AttributeContexts> _ctxtMemAttrs;
   std::vector<int> _ctxtMemAttrSliceIds;
+
+  // Workers used to encode slices or attributes concurrently
+  std::unique_ptr<ThreadPool> _threadPool;
+
+  // Attribute LoDs shared with slice and frame encoders
+  std::shared_ptr<AttributeLodCache> _lodCache;
+
+  // Destination for encoder progress messages
+  std::ostream* _log;
 };
 
 //----------------------------------------------------------------------------
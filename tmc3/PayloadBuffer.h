@@ -37,6 +37,7 @@
 
 #include "hls.h"
 
+#include <cstddef>
 #include <vector>
 
 namespace pcc {
@@ -54,6 +55,36 @@ struct PayloadBuffer : public std::vector<char> {
   }
 };
 
+//============================================================================
+// A payload whose storage is owned elsewhere, for instance by a PayloadBuffer
+// or a memory mapped bitstream.
+//
+// NB: the referenced storage must outlive the view.
+
+struct PayloadView {
+  PayloadType type;
+
+  PayloadView() = default;
+
+  PayloadView(PayloadType payload_type, const char* data, size_t size)
+    : type(payload_type), _data(data), _size(size)
+  {}
+
+  PayloadView(const PayloadBuffer& buf)
+    : type(buf.type), _data(buf.data()), _size(buf.size())
+  {}
+
+  const char* data() const { return _data; }
+  size_t size() const { return _size; }
+
+  const char* begin() const { return _data; }
+  const char* end() const { return _data + _size; }
+
+private:
+  const char* _data = nullptr;
+  size_t _size = 0;
+};
+
 //============================================================================
 
 }  // namespace pcc
\ No newline at end of file
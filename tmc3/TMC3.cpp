@@ -35,7 +35,10 @@
 
 #include "TMC3.h"
 
+#include <deque>
+#include <future>
 #include <memory>
+#include <sstream>
 
 #include "PCCTMC3Encoder.h"
 #include "PCCTMC3Decoder.h"
@@ -44,6 +47,7 @@
 #include "pointset_processing.h"
 #include "program_options_lite.h"
 #include "io_tlv.h"
+#include "thread_pool.h"
 #include "version.h"
 
 using namespace std;
@@ -93,6 +97,19 @@ struct Parameters {
 
   // resort the input points by azimuth angle
   bool sortInputByAzimuth;
+
+  // Number of worker threads used for concurrent slice coding
+  int numThreads;
+
+  // Number of frames coded concurrently
+  int numFrameThreads;
+
+  // Number of attribute LoDs cached for reuse by slices of later frames
+  int lodCacheSize;
+
+  // Number of frames read ahead of, or written behind, the frame being
+  // coded using background i/o threads
+  int ioQueueDepth;
 };
 
 //----------------------------------------------------------------------------
@@ -109,11 +126,22 @@ public:
 
 protected:
   int compressOneFrame(Stopwatch* clock);
+  bool encodeFramesConcurrently() const;
+  int compressFramesConcurrently(Stopwatch* clock);
+
+  int fetchInputFrame(int frameNum, PCCPointSet3* pointCloud);
+  int readInputFrame(int frameNum, PCCPointSet3* pointCloud);
+  void preprocessInputFrame(PCCPointSet3* pointCloud);
+  void writeReconstructedFrame(int frameNum, PCCPointSet3* reconPointCloud);
+  void writePostRecolour(int frameNum, const PCCPointSet3& cloud);
 
   void onOutputBuffer(const PayloadBuffer& buf) override;
   void onPostRecolour(const PCCPointSet3& cloud) override;
 
 private:
+  struct FrameOutput;
+  struct PrefetchedFrame;
+
   ply::PropertyNameMap _plyAttrNames;
 
   // The raw origin used for input sorting
@@ -125,6 +153,16 @@ private:
   std::ofstream bytestreamFile;
 
   int frameNum;
+
+  // Input frames being read in the background, in frame order
+  std::deque<PrefetchedFrame> _prefetchedFrames;
+  std::unique_ptr<ThreadPool> _readPool;
+
+  // Workers used to parse and format ply files
+  std::unique_ptr<ThreadPool> _plyPool;
+
+  // Output frames being written in the background
+  BoundedTaskQueue _writeQueue;
 };
 
 //----------------------------------------------------------------------------
@@ -140,11 +178,24 @@ public:
   double outputScale(const SequenceParameterSet& sps);
 
 protected:
+  int decompressFramesSerially(TlvFileReader& fin, const PayloadView* buf);
+  int decompressFramesConcurrently(TlvFileReader& fin);
+
+  void postprocessDecodedFrame(
+    const SequenceParameterSet& sps, PCCPointSet3* pointCloud);
+
+  void writeDecodedFrame(
+    int frameNum,
+    const SequenceParameterSet& sps,
+    const PCCPointSet3& pointCloud);
+
   void onOutputCloud(
     const SequenceParameterSet& sps,
     const PCCPointSet3& decodedPointCloud) override;
 
 private:
+  struct FrameOutput;
+
   const Parameters* params;
   PCCTMC3Decoder3 decoder;
 
@@ -152,6 +203,12 @@ private:
 
   int frameNum;
   Stopwatch* clock;
+
+  // Workers used to format ply files
+  std::unique_ptr<ThreadPool> _plyPool;
+
+  // Output frames being written in the background
+  BoundedTaskQueue _writeQueue;
 };
 
 //============================================================================
@@ -436,6 +493,30 @@ ParseParameters(int argc, char* argv[], Parameters& params)
     "  0: encode\n"
     "  1: decode")
 
+  ("threads",
+    params.numThreads, 1,
+    "Number of worker threads used to code independent slices "
+    "(or the attributes of a slice when encoding):\n"
+    "  0|1: serial slice coding")
+
+  ("frameThreads",
+    params.numFrameThreads, 1,
+    "Number of frames to code concurrently when entropy continuation "
+    "is enabled:\n"
+    "  0|1: serial frame coding")
+
+  ("lodCacheSize",
+    params.lodCacheSize, 0,
+    "Number of attribute levels of detail retained for reuse by slices "
+    "with identical geometry:\n"
+    "  0: disabled")
+
+  ("ioQueueDepth",
+    params.ioQueueDepth, 0,
+    "Number of frames to read ahead or write behind using background "
+    "threads:\n"
+    "  0: synchronous ply i/o")
+
   // i/o parameters
   ("firstFrameNum",
      params.firstFrameNum, 0,
@@ -572,6 +653,11 @@ ParseParameters(int argc, char* argv[], Parameters& params)
     params.encoder.sps.entropy_continuation_enabled_flag, false,
     "Propagate context state between slices")
 
+  ("independentSlices",
+    params.encoder.independentSlices, false,
+    "Reset the context state at the start of each slice when entropy "
+    "continuation is enabled, permitting slices to be coded concurrently")
+
   ("disableAttributeCoding",
     params.disableAttributeCoding, false,
     "Ignore attribute coding configuration")
@@ -992,6 +1078,14 @@ ParseParameters(int argc, char* argv[], Parameters& params)
   params.encoder.gbh.geom_qp_offset_intvl_log2_delta -=
     params.encoder.gps.geom_qp_offset_intvl_log2;
 
+  // slices are coded using a pool of worker threads
+  params.encoder.numThreads = params.numThreads;
+  params.decoder.numThreads = params.numThreads;
+
+  // attribute LoDs may be reused by slices of subsequent frames
+  params.encoder.lodCacheSize = params.lodCacheSize;
+  params.decoder.lodCacheSize = params.lodCacheSize;
+
   // set default output resolution (this works for the decoder too)
   if (params.outputResolution < 0)
     params.outputResolution = params.encoder.srcResolution;
@@ -1342,7 +1436,8 @@ ParseParameters(int argc, char* argv[], Parameters& params)
 
 //============================================================================
 
-SequenceEncoder::SequenceEncoder(Parameters* params) : params(params)
+SequenceEncoder::SequenceEncoder(Parameters* params)
+  : params(params), _writeQueue(params->ioQueueDepth)
 {
   // determine the naming (ordering) of ply properties
   _plyAttrNames.position =
@@ -1350,6 +1445,9 @@ SequenceEncoder::SequenceEncoder(Parameters* params) : params(params)
 
   // NB: this is the raw origin before the encoder tweaks it
   _angularOrigin = params->encoder.gps.geomAngularOrigin;
+
+  if (params->numThreads > 1)
+    _plyPool.reset(new ThreadPool(params->numThreads));
 }
 
 //----------------------------------------------------------------------------
@@ -1380,10 +1478,23 @@ SequenceEncoder::compress(Stopwatch* clock)
 
   const int lastFrameNum = params->firstFrameNum + params->frameCount;
   for (frameNum = params->firstFrameNum; frameNum < lastFrameNum; frameNum++) {
+    // the first frame determines the sequence parameters
+    bool concurrentFrames =
+      encodeFramesConcurrently() && frameNum != params->firstFrameNum;
+
+    if (concurrentFrames) {
+      if (compressFramesConcurrently(clock))
+        return -1;
+      break;
+    }
+
     if (compressOneFrame(clock))
       return -1;
   }
 
+  // complete any pending output before reporting
+  _writeQueue.wait();
+
   std::cout << "Total bitstream size " << bytestreamFile.tellp() << " B\n";
   bytestreamFile.close();
 
@@ -1395,46 +1506,13 @@ SequenceEncoder::compress(Stopwatch* clock)
 int
 SequenceEncoder::compressOneFrame(Stopwatch* clock)
 {
-  std::string srcName{expandNum(params->uncompressedDataPath, frameNum)};
   PCCPointSet3 pointCloud;
-  if (
-    !ply::read(srcName, _plyAttrNames, pointCloud)
-    || pointCloud.getPointCount() == 0) {
-    cout << "Error: can't open input file!" << endl;
+  if (fetchInputFrame(frameNum, &pointCloud))
     return -1;
-  }
-
-  // Some evaluations wish to scan the points in azimuth order to simulate
-  // real-time acquisition (since the input has lost its original order).
-  // NB: because this is trying to emulate the input order, binning is disabled
-  if (params->sortInputByAzimuth)
-    sortByAzimuth(
-      pointCloud, 0, pointCloud.getPointCount(), 0., _angularOrigin);
-
-  // Sanitise the input point cloud
-  // todo(df): remove the following with generic handling of properties
-  bool codeColour = params->encoder.attributeIdxMap.count("color");
-  if (!codeColour)
-    pointCloud.removeColors();
-  assert(codeColour == pointCloud.hasColors());
-
-  bool codeReflectance = params->encoder.attributeIdxMap.count("reflectance");
-  if (!codeReflectance)
-    pointCloud.removeReflectances();
-  assert(codeReflectance == pointCloud.hasReflectances());
 
   clock->start();
 
-  if (params->convertColourspace)
-    convertFromGbr(params->encoder.sps, pointCloud);
-
-  if (params->reflectanceScale > 1 && pointCloud.hasReflectances()) {
-    const auto pointCount = pointCloud.getPointCount();
-    for (size_t i = 0; i < pointCount; ++i) {
-      int val = pointCloud.getReflectance(i) / params->reflectanceScale;
-      pointCloud.setReflectance(i, val);
-    }
-  }
+  preprocessInputFrame(&pointCloud);
 
   // The reconstructed point cloud
   std::unique_ptr<PCCPointSet3> reconPointCloud;
@@ -1458,30 +1536,275 @@ SequenceEncoder::compressOneFrame(Stopwatch* clock)
 
   clock->stop();
 
-  if (!params->reconstructedDataPath.empty()) {
-    if (params->convertColourspace)
-      convertToGbr(params->encoder.sps, *reconPointCloud);
-
-    if (params->reflectanceScale > 1 && reconPointCloud->hasReflectances()) {
-      const auto pointCount = reconPointCloud->getPointCount();
-      for (size_t i = 0; i < pointCount; ++i) {
-        int val =
-          reconPointCloud->getReflectance(i) * params->reflectanceScale;
-        reconPointCloud->setReflectance(i, val);
-      }
+  if (reconPointCloud) {
+    int curFrameNum = frameNum;
+    std::shared_ptr<PCCPointSet3> cloud(std::move(reconPointCloud));
+    _writeQueue.submit(
+      [=]() { writeReconstructedFrame(curFrameNum, cloud.get()); });
+  }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+// Frames may only be encoded concurrently if each is independent of the
+// preceding frames.  Without entropy continuation, the saved context state
+// is carried from one frame to the next; with it, the state is reset by the
+// first slice of each frame.
+
+bool
+SequenceEncoder::encodeFramesConcurrently() const
+{
+  return params->numFrameThreads > 1
+    && params->encoder.sps.entropy_continuation_enabled_flag;
+}
+
+//----------------------------------------------------------------------------
+// Encoder output of a frame that is coded concurrently with other frames.
+
+struct SequenceEncoder::FrameOutput : public PCCTMC3Encoder3::Callbacks {
+  SequenceEncoder* seqEncoder;
+  int frameNum;
+  int ret = 0;
+
+  std::vector<PayloadBuffer> payloads;
+  std::ostringstream log;
+
+  void onOutputBuffer(const PayloadBuffer& buf) override
+  {
+    payloads.push_back(buf);
+  }
+
+  void onPostRecolour(const PCCPointSet3& cloud) override
+  {
+    seqEncoder->writePostRecolour(frameNum, cloud);
+  }
+};
+
+//----------------------------------------------------------------------------
+// Encode the remaining frames of the sequence, keeping numFrameThreads
+// frames in flight.  Each frame is coded by a separate encoder that
+// continues the sequence started by the first frame.  The output of each
+// frame is written to the bitstream in frame order.
+//
+// NB: the clock measures all processing, including ply i/o.
+
+int
+SequenceEncoder::compressFramesConcurrently(Stopwatch* clock)
+{
+  const int lastFrameNum = params->firstFrameNum + params->frameCount;
+  int ret = 0;
+
+  clock->start();
+
+  std::deque<std::future<std::unique_ptr<FrameOutput>>> frames;
+  ThreadPool threadPool(params->numFrameThreads);
+
+  while (frameNum < lastFrameNum || !frames.empty()) {
+    // keep the pool busy
+    bool poolFull = frames.size() >= size_t(threadPool.numThreads());
+    if (!ret && frameNum < lastFrameNum && !poolFull) {
+      int frameCounter = frameNum - params->firstFrameNum;
+      std::shared_ptr<PCCTMC3Encoder3> frameEncoder(
+        encoder.cloneForFrame(frameCounter));
+
+      // NB: the encoder modifies its parameters
+      auto frameParams = std::make_shared<EncoderParams>(params->encoder);
+
+      int curFrameNum = frameNum++;
+      frames.push_back(threadPool.submit([=]() {
+        int frameNum = curFrameNum;
+        std::unique_ptr<FrameOutput> output(new FrameOutput);
+        output->seqEncoder = this;
+        output->frameNum = frameNum;
+        frameEncoder->setLogStream(&output->log);
+
+        PCCPointSet3 pointCloud;
+        if (readInputFrame(frameNum, &pointCloud)) {
+          output->ret = -1;
+          return output;
+        }
+
+        preprocessInputFrame(&pointCloud);
+
+        std::unique_ptr<PCCPointSet3> reconPointCloud;
+        if (!params->reconstructedDataPath.empty())
+          reconPointCloud.reset(new PCCPointSet3);
+
+        output->ret = frameEncoder->compress(
+          pointCloud, frameParams.get(), output.get(), reconPointCloud.get());
+
+        if (!output->ret && reconPointCloud)
+          writeReconstructedFrame(frameNum, reconPointCloud.get());
+
+        return output;
+      }));
+      continue;
     }
 
-    std::string recName{expandNum(params->reconstructedDataPath, frameNum)};
-    auto plyScale = outputScale(params->encoder.sps);
-    auto plyOrigin = params->encoder.sps.seqBoundingBoxOrigin * plyScale;
-    ply::write(
-      *reconPointCloud, _plyAttrNames, plyScale, plyOrigin, recName,
-      !params->outputBinaryPly);
+    // write out the oldest frame
+    auto output = frames.front().get();
+    frames.pop_front();
+
+    if (ret)
+      continue;
+
+    std::cout << output->log.str();
+    if (output->ret) {
+      cout << "Error: can't compress point cloud!" << endl;
+      ret = -1;
+      continue;
+    }
+
+    auto bytestreamLenFrameStart = bytestreamFile.tellp();
+    for (const auto& buf : output->payloads)
+      writeTlv(buf, bytestreamFile);
+
+    auto bytestreamLenFrameEnd = bytestreamFile.tellp();
+    int frameLen = bytestreamLenFrameEnd - bytestreamLenFrameStart;
+    std::cout << "Total frame size " << frameLen << " B" << std::endl;
   }
 
+  clock->stop();
+
+  return ret;
+}
+
+//----------------------------------------------------------------------------
+// An input frame being read in the background.
+
+struct SequenceEncoder::PrefetchedFrame {
+  int frameNum;
+  std::shared_ptr<PCCPointSet3> cloud;
+  std::future<int> ret;
+};
+
+//----------------------------------------------------------------------------
+// Obtain an input frame for serial encoding.  With ioQueueDepth > 0, up to
+// ioQueueDepth subsequent frames are read in the background.
+
+int
+SequenceEncoder::fetchInputFrame(int frameNum, PCCPointSet3* pointCloud)
+{
+  if (params->ioQueueDepth < 1)
+    return readInputFrame(frameNum, pointCloud);
+
+  if (!_readPool)
+    _readPool.reset(new ThreadPool(1));
+
+  // Only the first frame is coded serially when coding frames concurrently
+  int lastFrameNum = params->firstFrameNum + params->frameCount;
+  if (encodeFramesConcurrently())
+    lastFrameNum = std::min(lastFrameNum, params->firstFrameNum + 1);
+
+  // discard any frames that are no longer required
+  while (!_prefetchedFrames.empty()
+         && _prefetchedFrames.front().frameNum != frameNum) {
+    _prefetchedFrames.front().ret.wait();
+    _prefetchedFrames.pop_front();
+  }
+
+  int nextFrameNum = _prefetchedFrames.empty()
+    ? frameNum
+    : _prefetchedFrames.back().frameNum + 1;
+
+  // NB: the current frame is not counted towards the queue depth
+  while (_prefetchedFrames.size() <= size_t(params->ioQueueDepth)
+         && nextFrameNum < lastFrameNum) {
+    int readFrameNum = nextFrameNum++;
+    std::shared_ptr<PCCPointSet3> cloud(new PCCPointSet3);
+    auto ret = _readPool->submit(
+      [=]() { return readInputFrame(readFrameNum, cloud.get()); });
+    _prefetchedFrames.push_back({readFrameNum, cloud, std::move(ret)});
+  }
+
+  auto frame = std::move(_prefetchedFrames.front());
+  _prefetchedFrames.pop_front();
+
+  int ret = frame.ret.get();
+  pointCloud->swap(*frame.cloud);
+  return ret;
+}
+
+//----------------------------------------------------------------------------
+// Read and sanitise an input frame.
+
+int
+SequenceEncoder::readInputFrame(int frameNum, PCCPointSet3* pointCloud)
+{
+  std::string srcName{expandNum(params->uncompressedDataPath, frameNum)};
+  if (
+    !ply::read(srcName, _plyAttrNames, *pointCloud, _plyPool.get())
+    || pointCloud->getPointCount() == 0) {
+    cout << "Error: can't open input file!" << endl;
+    return -1;
+  }
+
+  // Some evaluations wish to scan the points in azimuth order to simulate
+  // real-time acquisition (since the input has lost its original order).
+  // NB: because this is trying to emulate the input order, binning is disabled
+  if (params->sortInputByAzimuth)
+    sortByAzimuth(
+      *pointCloud, 0, pointCloud->getPointCount(), 0., _angularOrigin);
+
+  // Sanitise the input point cloud
+  // todo(df): remove the following with generic handling of properties
+  bool codeColour = params->encoder.attributeIdxMap.count("color");
+  if (!codeColour)
+    pointCloud->removeColors();
+  assert(codeColour == pointCloud->hasColors());
+
+  bool codeReflectance = params->encoder.attributeIdxMap.count("reflectance");
+  if (!codeReflectance)
+    pointCloud->removeReflectances();
+  assert(codeReflectance == pointCloud->hasReflectances());
+
   return 0;
 }
 
+//----------------------------------------------------------------------------
+// Convert the input attributes to the coded representation.
+
+void
+SequenceEncoder::preprocessInputFrame(PCCPointSet3* pointCloud)
+{
+  if (params->convertColourspace)
+    convertFromGbr(params->encoder.sps, *pointCloud);
+
+  if (params->reflectanceScale > 1 && pointCloud->hasReflectances()) {
+    const auto pointCount = pointCloud->getPointCount();
+    for (size_t i = 0; i < pointCount; ++i) {
+      int val = pointCloud->getReflectance(i) / params->reflectanceScale;
+      pointCloud->setReflectance(i, val);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+
+void
+SequenceEncoder::writeReconstructedFrame(
+  int frameNum, PCCPointSet3* reconPointCloud)
+{
+  if (params->convertColourspace)
+    convertToGbr(params->encoder.sps, *reconPointCloud);
+
+  if (params->reflectanceScale > 1 && reconPointCloud->hasReflectances()) {
+    const auto pointCount = reconPointCloud->getPointCount();
+    for (size_t i = 0; i < pointCount; ++i) {
+      int val = reconPointCloud->getReflectance(i) * params->reflectanceScale;
+      reconPointCloud->setReflectance(i, val);
+    }
+  }
+
+  std::string recName{expandNum(params->reconstructedDataPath, frameNum)};
+  auto plyScale = outputScale(params->encoder.sps);
+  auto plyOrigin = params->encoder.sps.seqBoundingBoxOrigin * plyScale;
+  ply::write(
+    *reconPointCloud, _plyAttrNames, plyScale, plyOrigin, recName,
+    !params->outputBinaryPly, _plyPool.get());
+}
+
 //----------------------------------------------------------------------------
 
 void
@@ -1494,6 +1817,19 @@ SequenceEncoder::onOutputBuffer(const PayloadBuffer& buf)
 
 void
 SequenceEncoder::onPostRecolour(const PCCPointSet3& cloud)
+{
+  if (params->postRecolorPath.empty())
+    return;
+
+  int curFrameNum = frameNum;
+  auto cloudCopy = std::make_shared<PCCPointSet3>(cloud);
+  _writeQueue.submit([=]() { writePostRecolour(curFrameNum, *cloudCopy); });
+}
+
+//----------------------------------------------------------------------------
+
+void
+SequenceEncoder::writePostRecolour(int frameNum, const PCCPointSet3& cloud)
 {
   if (params->postRecolorPath.empty()) {
     return;
@@ -1507,7 +1843,7 @@ SequenceEncoder::onPostRecolour(const PCCPointSet3& cloud)
   if (!params->convertColourspace) {
     ply::write(
       cloud, _plyAttrNames, plyScale, plyOrigin, plyName,
-      !params->outputBinaryPly);
+      !params->outputBinaryPly, _plyPool.get());
     return;
   }
 
@@ -1515,14 +1851,19 @@ SequenceEncoder::onPostRecolour(const PCCPointSet3& cloud)
   convertToGbr(params->encoder.sps, tmpCloud);
   ply::write(
     tmpCloud, _plyAttrNames, plyScale, plyOrigin, plyName,
-    !params->outputBinaryPly);
+    !params->outputBinaryPly, _plyPool.get());
 }
 
 //============================================================================
 
 SequenceDecoder::SequenceDecoder(const Parameters* params)
-  : params(params), decoder(params->decoder)
-{}
+  : params(params)
+  , decoder(params->decoder)
+  , _writeQueue(params->ioQueueDepth)
+{
+  if (params->numThreads > 1)
+    _plyPool.reset(new ThreadPool(params->numThreads));
+}
 
 //----------------------------------------------------------------------------
 
@@ -1545,25 +1886,74 @@ SequenceDecoder::outputScale(const SequenceParameterSet& sps)
 int
 SequenceDecoder::decompress(Stopwatch* clock)
 {
-  ifstream fin(params->compressedStreamPath, ios::binary);
-  if (!fin.is_open()) {
+  TlvFileReader fin;
+  if (!fin.open(params->compressedStreamPath.c_str())) {
     return -1;
   }
 
   frameNum = params->firstFrameNum;
   this->clock = clock;
 
-  PayloadBuffer buf;
-
   clock->start();
 
+  if (params->numFrameThreads > 1) {
+    if (decompressFramesConcurrently(fin))
+      return -1;
+  } else {
+    if (decompressFramesSerially(fin, nullptr))
+      return -1;
+  }
+
+  std::cout << "Total bitstream size " << fin.size() << " B" << std::endl;
+
+  clock->stop();
+
+  // NB: the clock excludes ply output
+  _writeQueue.wait();
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+// Decoder output of a frame that is decoded concurrently with other frames.
+
+struct SequenceDecoder::FrameOutput : public PCCTMC3Decoder3::Callbacks {
+  SequenceDecoder* seqDecoder;
+  int frameNum;
+  int ret = 0;
+
+  std::ostringstream log;
+
+  void onOutputCloud(
+    const SequenceParameterSet& sps,
+    const PCCPointSet3& decodedPointCloud) override
+  {
+    PCCPointSet3 pointCloud(decodedPointCloud);
+    seqDecoder->postprocessDecodedFrame(sps, &pointCloud);
+    seqDecoder->writeDecodedFrame(frameNum, sps, pointCloud);
+  }
+};
+
+//----------------------------------------------------------------------------
+// Decode the remainder of the bitstream one data unit at a time, starting
+// with firstBuf, if not null.
+
+int
+SequenceDecoder::decompressFramesSerially(
+  TlvFileReader& fin, const PayloadView* firstBuf)
+{
+  PayloadView buf;
+  bool haveBuf = firstBuf != nullptr;
+  if (haveBuf)
+    buf = *firstBuf;
+
   while (true) {
-    PayloadBuffer* buf_ptr = &buf;
-    readTlv(fin, &buf);
+    PayloadView* buf_ptr = &buf;
 
     // at end of file (or other error), flush decoder
-    if (!fin)
+    if (!haveBuf && !fin.readTlv(&buf))
       buf_ptr = nullptr;
+    haveBuf = false;
 
     if (decoder.decompress(buf_ptr, this)) {
       cout << "Error: can't decompress point cloud!" << endl;
@@ -1574,13 +1964,125 @@ SequenceDecoder::decompress(Stopwatch* clock)
       break;
   }
 
-  fin.clear();
-  fin.seekg(0, ios_base::end);
-  std::cout << "Total bitstream size " << fin.tellg() << " B" << std::endl;
+  return 0;
+}
 
-  clock->stop();
+//----------------------------------------------------------------------------
+// Split the bitstream into frames and decode up to numFrameThreads frames
+// concurrently, each using a separate decoder that shares the parameter
+// sets received by the primary decoder.
+//
+// A frame ends at a frame boundary marker, when the frame_idx of a geometry
+// brick differs from that of the preceding brick, or at the end of the
+// bitstream.  Since the first slice of a frame never continues the entropy
+// state of a previous slice, each frame may be decoded independently,
+// provided that entropy continuation is enabled.  Otherwise, the saved
+// context state is carried between frames and the first frame's
+// parameter sets determine that the bitstream is decoded serially.
+//
+// NB: the clock measures all processing, including ply i/o.
 
-  return 0;
+int
+SequenceDecoder::decompressFramesConcurrently(TlvFileReader& fin)
+{
+  std::deque<std::future<std::unique_ptr<FrameOutput>>> frames;
+  ThreadPool threadPool(params->numFrameThreads);
+  int ret = 0;
+
+  // Wait for the oldest frame and emit its log
+  auto retireFrame = [&]() {
+    auto output = frames.front().get();
+    frames.pop_front();
+    std::cout << output->log.str();
+    if (output->ret) {
+      cout << "Error: can't decompress point cloud!" << endl;
+      ret = -1;
+    }
+  };
+
+  // NB: the data units of each frame reference the mapped bitstream, which
+  //     outlives all frame decoders
+  std::vector<PayloadView> framePayloads;
+  int frameIdx = -1;
+
+  PayloadView buf;
+  while (!ret) {
+    bool endOfStream = !fin.readTlv(&buf);
+
+    // at end of file (or other error), flush the last frame
+    bool endOfFrame = endOfStream;
+    bool frameData = false;
+
+    if (!endOfStream) {
+      switch (buf.type) {
+      case PayloadType::kFrameBoundaryMarker:
+        endOfFrame = true;
+        frameIdx = -1;
+        break;
+
+      case PayloadType::kGeometryBrick: {
+        if (frameNum == params->firstFrameNum && framePayloads.empty()
+            && !decoder.isIndependentFrame(buf))
+          return decompressFramesSerially(fin, &buf);
+
+        int gbhFrameIdx = decoder.peekFrameIdx(buf);
+        endOfFrame = frameIdx >= 0 && frameIdx != gbhFrameIdx;
+        frameIdx = gbhFrameIdx;
+        frameData = true;
+        break;
+      }
+
+      case PayloadType::kAttributeBrick:
+      case PayloadType::kConstantAttribute: frameData = true; break;
+
+      default:
+        // parameter sets are received by the primary decoder
+        if (decoder.decompress(&buf, nullptr)) {
+          cout << "Error: can't decompress point cloud!" << endl;
+          ret = -1;
+        }
+        break;
+      }
+    }
+
+    if (endOfFrame) {
+      if (frames.size() >= size_t(threadPool.numThreads()))
+        retireFrame();
+
+      std::shared_ptr<PCCTMC3Decoder3> frameDecoder(decoder.cloneForFrame());
+      auto payloads = std::make_shared<std::vector<PayloadView>>();
+      payloads->swap(framePayloads);
+
+      int curFrameNum = frameNum++;
+      frames.push_back(threadPool.submit([=]() {
+        std::unique_ptr<FrameOutput> output(new FrameOutput);
+        output->seqDecoder = this;
+        output->frameNum = curFrameNum;
+        frameDecoder->setLogStream(&output->log);
+
+        for (const auto& buf : *payloads) {
+          output->ret = frameDecoder->decompress(&buf, output.get());
+          if (output->ret)
+            return output;
+        }
+
+        // flush the decoder to output the frame
+        output->ret = frameDecoder->decompress(nullptr, output.get());
+        return output;
+      }));
+    }
+
+    if (frameData)
+      framePayloads.push_back(buf);
+
+    if (endOfStream)
+      break;
+  }
+
+  while (!frames.empty())
+    retireFrame();
+
+  return ret;
 }
 
 //----------------------------------------------------------------------------
@@ -1590,19 +2092,50 @@ SequenceDecoder::onOutputCloud(
   const SequenceParameterSet& sps, const PCCPointSet3& decodedPointCloud)
 {
   // copy the point cloud in order to modify it according to the output options
-  PCCPointSet3 pointCloud(decodedPointCloud);
+  auto pointCloud = std::make_shared<PCCPointSet3>(decodedPointCloud);
+  postprocessDecodedFrame(sps, pointCloud.get());
+
+  clock->stop();
+
+  // NB: the frame may be written after the decoder has moved on
+  int curFrameNum = frameNum;
+  auto spsCopy = std::make_shared<SequenceParameterSet>(sps);
+  _writeQueue.submit(
+    [=]() { writeDecodedFrame(curFrameNum, *spsCopy, *pointCloud); });
+
+  clock->start();
+
+  // todo(df): frame number should be derived from the bitstream
+  frameNum++;
+}
 
+//----------------------------------------------------------------------------
+// Convert the decoded attributes to the output representation.
+
+void
+SequenceDecoder::postprocessDecodedFrame(
+  const SequenceParameterSet& sps, PCCPointSet3* pointCloud)
+{
   if (params->convertColourspace)
-    convertToGbr(sps, pointCloud);
+    convertToGbr(sps, *pointCloud);
 
-  if (params->reflectanceScale > 1 && pointCloud.hasReflectances()) {
-    const auto pointCount = pointCloud.getPointCount();
+  if (params->reflectanceScale > 1 && pointCloud->hasReflectances()) {
+    const auto pointCount = pointCloud->getPointCount();
     for (size_t i = 0; i < pointCount; ++i) {
-      int val = pointCloud.getReflectance(i) * params->reflectanceScale;
-      pointCloud.setReflectance(i, val);
+      int val = pointCloud->getReflectance(i) * params->reflectanceScale;
+      pointCloud->setReflectance(i, val);
     }
   }
+}
+
+//----------------------------------------------------------------------------
 
+void
+SequenceDecoder::writeDecodedFrame(
+  int frameNum,
+  const SequenceParameterSet& sps,
+  const PCCPointSet3& pointCloud)
+{
   // the order of the property names must be determined from the sps
   ply::PropertyNameMap attrNames;
   attrNames.position = axisOrderToPropertyNames(sps.geometry_axis_order);
@@ -1612,24 +2145,17 @@ SequenceDecoder::onOutputCloud(
     std::string filename{expandNum(params->preInvScalePath, frameNum)};
     ply::write(
       pointCloud, attrNames, 1.0, 0.0, params->preInvScalePath,
-      !params->outputBinaryPly);
+      !params->outputBinaryPly, _plyPool.get());
   }
 
-  clock->stop();
-
   auto plyScale = outputScale(sps);
   auto plyOrigin = sps.seqBoundingBoxOrigin * plyScale;
   std::string decName{expandNum(params->reconstructedDataPath, frameNum)};
   if (!ply::write(
         pointCloud, attrNames, plyScale, plyOrigin, decName,
-        !params->outputBinaryPly)) {
+        !params->outputBinaryPly, _plyPool.get())) {
     cout << "Error: can't open output file!" << endl;
   }
-
-  clock->start();
-
-  // todo(df): frame number should be derived from the bitstream
-  frameNum++;
 }
 
 //============================================================================
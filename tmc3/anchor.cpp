@@ -371,9 +371,10 @@ AttributeEncoderIntf::~AttributeEncoderIntf() = default;
 // AttributeEncoder factory
 
 std::unique_ptr<AttributeEncoderIntf>
-makeAttributeEncoder()
+makeAttributeEncoder(ThreadPool* threadPool, AttributeLodCache* lodCache)
 {
-  return std::unique_ptr<AttributeEncoder>(new AttributeEncoder());
+  return std::unique_ptr<AttributeEncoder>(
+    new AttributeEncoder(threadPool, lodCache));
 }
 
 //============================================================================
@@ -394,7 +395,8 @@ AttributeEncoder::encode(
   // generate LoDs if necessary
   if (attr_aps.lodParametersPresent() && _lods.empty())
     _lods.generate(
-      attr_aps, abh, pointCloud.getPointCount() - 1, 0, pointCloud);
+      attr_aps, abh, pointCloud.getPointCount() - 1, 0, pointCloud,
+      _threadPool, _lodCache);
 
   // write abh
   write(sps, attr_aps, abh, payload);
@@ -473,25 +475,27 @@ AttributeEncoder::computeReflectanceResidual(
 
 //----------------------------------------------------------------------------
 
-void
+bool
 AttributeEncoder::computeReflectancePredictionWeights(
   const AttributeParameterSet& aps,
   const PCCPointSet3& pointCloud,
   const std::vector<uint32_t>& indexesLOD,
   const uint32_t predictorIndex,
-  PCCPredictor& predictor,
+  PredictorStore& predictors,
   PCCResidualsEncoder& encoder,
   PCCResidualsEntropyEstimator& context,
   const Quantizer& quant)
 {
-  predictor.predMode = 0;
-  predictor.maxDiff = 0;
-  if (predictor.neighborCount > 1 && aps.max_num_direct_predictors) {
+  const int neighborCount = predictors.neighborCount(predictorIndex);
+  int8_t& predMode = predictors.predMode[predictorIndex];
+  predMode = 0;
+  int64_t maxDiff = 0;
+  if (neighborCount > 1 && aps.max_num_direct_predictors) {
     int64_t minValue = 0;
     int64_t maxValue = 0;
-    for (size_t i = 0; i < predictor.neighborCount; ++i) {
+    for (int i = 0; i < neighborCount; ++i) {
       const uint64_t reflectanceNeighbor = pointCloud.getReflectance(
-        indexesLOD[predictor.neighbors[i].predictorIndex]);
+        indexesLOD[predictors.neighborIndex(predictorIndex, i)]);
       if (i == 0 || reflectanceNeighbor < minValue) {
         minValue = reflectanceNeighbor;
       }
@@ -499,124 +503,193 @@ AttributeEncoder::computeReflectancePredictionWeights(
         maxValue = reflectanceNeighbor;
       }
     }
-    const int64_t maxDiff = maxValue - minValue;
-    predictor.maxDiff = maxDiff;
+    maxDiff = maxValue - minValue;
     if (maxDiff >= aps.adaptive_prediction_threshold) {
       uint64_t attrValue =
         pointCloud.getReflectance(indexesLOD[predictorIndex]);
 
       // base case: start with the first neighbour
       // NB: skip evaluation of mode 0 (weighted average of n neighbours)
-      predictor.predMode = 1;
-      uint64_t attrPred = predictor.predictReflectance(pointCloud, indexesLOD);
+      predMode = 1;
+      uint64_t attrPred =
+        predictors.predictReflectance(predictorIndex, pointCloud, indexesLOD);
       int64_t attrResidualQuant =
         computeReflectanceResidual(attrValue, attrPred, quant);
 
       // NB: idxBits is not included in the score
       int64_t best_score = attrResidualQuant;
 
-      for (int i = 1; i < predictor.neighborCount; i++) {
+      for (int i = 1; i < neighborCount; i++) {
         if (i == aps.max_num_direct_predictors)
           break;
 
         attrPred = pointCloud.getReflectance(
-          indexesLOD[predictor.neighbors[i].predictorIndex]);
+          indexesLOD[predictors.neighborIndex(predictorIndex, i)]);
         attrResidualQuant =
           computeReflectanceResidual(attrValue, attrPred, quant);
 
         if (attrResidualQuant < best_score) {
           best_score = attrResidualQuant;
-          predictor.predMode = i + 1;
-          // NB: setting predictor.neighborCount = 1 will cause issues
+          predMode = i + 1;
+          // NB: setting the neighbour count to 1 will cause issues
           // with reconstruction.
         }
       }
     }
   }
+
+  return maxDiff >= aps.adaptive_prediction_threshold;
 }
 
+//----------------------------------------------------------------------------
+// Encoding of an attribute using the predicting transform, one point at a
+// time, in predictor order.  The prediction modes and residuals are
+// entropy coded once all points have been processed.
+
+class AttributeEncoder::PredEncoder {
+public:
+  virtual ~PredEncoder() = default;
+  virtual void encodePoint(size_t predictorIndex) = 0;
+  virtual void finish() = 0;
+};
+
+//----------------------------------------------------------------------------
+
+class AttributeEncoder::ReflectancePredEncoder
+  : public AttributeEncoder::PredEncoder {
+public:
+  ReflectancePredEncoder(
+    AttributeLods& lods,
+    const AttributeDescription& desc,
+    const AttributeParameterSet& aps,
+    const QpSet& qpSet,
+    PCCPointSet3& pointCloud,
+    PCCResidualsEncoder& encoder)
+    : _lods(lods)
+    , _aps(aps)
+    , _qpSet(qpSet)
+    , _pointCloud(pointCloud)
+    , _encoder(encoder)
+    , _clipMax((1ll << desc.bitdepth) - 1)
+    , _zeroCnt(0)
+    , _quantLayer(0)
+  {
+    const uint32_t pointCount = pointCloud.getPointCount();
+    _zerorun.reserve(pointCount);
+    _residual.resize(pointCount);
+    _signalledPredMode.resize(pointCount);
+  }
+
+  void encodePoint(size_t predictorIndex) override;
+  void finish() override;
+
+private:
+  AttributeLods& _lods;
+  const AttributeParameterSet& _aps;
+  const QpSet& _qpSet;
+  PCCPointSet3& _pointCloud;
+  PCCResidualsEncoder& _encoder;
+  const int64_t _clipMax;
+  PCCResidualsEntropyEstimator _context;
+  int _zeroCnt;
+  std::vector<int> _zerorun;
+  std::vector<uint32_t> _residual;
+
+  // The prediction mode of each point, or -1 if it is not signalled
+  std::vector<int8_t> _signalledPredMode;
+
+  int _quantLayer;
+};
+
 //----------------------------------------------------------------------------
 
 void
-AttributeEncoder::encodeReflectancesPred(
-  const AttributeDescription& desc,
-  const AttributeParameterSet& aps,
-  const QpSet& qpSet,
-  PCCPointSet3& pointCloud,
-  PCCResidualsEncoder& encoder)
+AttributeEncoder::ReflectancePredEncoder::encodePoint(size_t predictorIndex)
 {
-  const uint32_t pointCount = pointCloud.getPointCount();
-  const int64_t clipMax = (1ll << desc.bitdepth) - 1;
-  PCCResidualsEntropyEstimator context;
-  int zero_cnt = 0;
-  std::vector<int> zerorun;
-  zerorun.reserve(pointCount);
-  std::vector<uint32_t> residual;
-  residual.resize(pointCount);
-
-  int quantLayer = 0;
-  for (size_t predictorIndex = 0; predictorIndex < pointCount;
-       ++predictorIndex) {
-    if (predictorIndex == _lods.numPointsInLod[quantLayer]) {
-      quantLayer = std::min(int(qpSet.layers.size()) - 1, quantLayer + 1);
-    }
-    const uint32_t pointIndex = _lods.indexes[predictorIndex];
-    auto quant = qpSet.quantizers(pointCloud[pointIndex], quantLayer);
-    auto& predictor = _lods.predictors[predictorIndex];
-
-    computeReflectancePredictionWeights(
-      aps, pointCloud, _lods.indexes, predictorIndex, predictor, encoder,
-      context, quant[0]);
-
-    const uint64_t reflectance = pointCloud.getReflectance(pointIndex);
-    const attr_t predictedReflectance =
-      predictor.predictReflectance(pointCloud, _lods.indexes);
-    const int64_t quantAttValue = reflectance;
-    const int64_t quantPredAttValue = predictedReflectance;
-    const int64_t delta = quant[0].quantize(
-      (quantAttValue - quantPredAttValue) << kFixedPointAttributeShift);
-    const auto attValue0 = delta;
-    const int64_t reconstructedDelta =
-      divExp2RoundHalfUp(quant[0].scale(delta), kFixedPointAttributeShift);
-    const int64_t reconstructedQuantAttValue =
-      quantPredAttValue + reconstructedDelta;
-    const attr_t reconstructedReflectance =
-      attr_t(PCCClip(reconstructedQuantAttValue, int64_t(0), clipMax));
-
-    if (!attValue0)
-      ++zero_cnt;
-    else {
-      zerorun.push_back(zero_cnt);
-      zero_cnt = 0;
-    }
-    residual[predictorIndex] = attValue0;
-    pointCloud.setReflectance(pointIndex, reconstructedReflectance);
+  if (predictorIndex == _lods.numPointsInLod[_quantLayer]) {
+    _quantLayer = std::min(int(_qpSet.layers.size()) - 1, _quantLayer + 1);
   }
+  const uint32_t pointIndex = _lods.indexes[predictorIndex];
+  auto quant = _qpSet.quantizers(_pointCloud[pointIndex], _quantLayer);
+  bool predModeSignalled = computeReflectancePredictionWeights(
+    _aps, _pointCloud, _lods.indexes, predictorIndex, _lods.predictors,
+    _encoder, _context, quant[0]);
+  _signalledPredMode[predictorIndex] =
+    predModeSignalled ? _lods.predictors.predMode[predictorIndex] : -1;
+
+  const uint64_t reflectance = _pointCloud.getReflectance(pointIndex);
+  const attr_t predictedReflectance = _lods.predictors.predictReflectance(
+    predictorIndex, _pointCloud, _lods.indexes);
+  const int64_t quantAttValue = reflectance;
+  const int64_t quantPredAttValue = predictedReflectance;
+  const int64_t delta = quant[0].quantize(
+    (quantAttValue - quantPredAttValue) << kFixedPointAttributeShift);
+  const auto attValue0 = delta;
+  const int64_t reconstructedDelta =
+    divExp2RoundHalfUp(quant[0].scale(delta), kFixedPointAttributeShift);
+  const int64_t reconstructedQuantAttValue =
+    quantPredAttValue + reconstructedDelta;
+  const attr_t reconstructedReflectance =
+    attr_t(PCCClip(reconstructedQuantAttValue, int64_t(0), _clipMax));
+
+  if (!attValue0)
+    ++_zeroCnt;
+  else {
+    _zerorun.push_back(_zeroCnt);
+    _zeroCnt = 0;
+  }
+  _residual[predictorIndex] = attValue0;
+  _pointCloud.setReflectance(pointIndex, reconstructedReflectance);
+}
+
+//----------------------------------------------------------------------------
 
-  zerorun.push_back(zero_cnt);
+void
+AttributeEncoder::ReflectancePredEncoder::finish()
+{
+  _zerorun.push_back(_zeroCnt);
   int run_index = 0;
-  encoder.encodeRunLength(zerorun[run_index]);
-  zero_cnt = zerorun[run_index++];
+  _encoder.encodeRunLength(_zerorun[run_index]);
+  int zero_cnt = _zerorun[run_index++];
 
-  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+  for (size_t predictorIndex = 0; predictorIndex < _residual.size();
        ++predictorIndex) {
-    auto& predictor = _lods.predictors[predictorIndex];
-    if (predictor.maxDiff >= aps.adaptive_prediction_threshold) {
-      encoder.encodePredMode(
-        predictor.predMode, aps.max_num_direct_predictors);
+    if (_signalledPredMode[predictorIndex] >= 0) {
+      _encoder.encodePredMode(
+        _signalledPredMode[predictorIndex], _aps.max_num_direct_predictors);
     }
     if (zero_cnt > 0)
       zero_cnt--;
     else {
-      encoder.encode(residual[predictorIndex]);
-      encoder.encodeRunLength(zerorun[run_index]);
-      zero_cnt = zerorun[run_index++];
+      _encoder.encode(_residual[predictorIndex]);
+      _encoder.encodeRunLength(_zerorun[run_index]);
+      zero_cnt = _zerorun[run_index++];
     }
   }
 }
 
 //----------------------------------------------------------------------------
 
+void
+AttributeEncoder::encodeReflectancesPred(
+  const AttributeDescription& desc,
+  const AttributeParameterSet& aps,
+  const QpSet& qpSet,
+  PCCPointSet3& pointCloud,
+  PCCResidualsEncoder& encoder)
+{
+  ReflectancePredEncoder coder(_lods, desc, aps, qpSet, pointCloud, encoder);
+
+  const size_t pointCount = pointCloud.getPointCount();
+  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+       ++predictorIndex)
+    coder.encodePoint(predictorIndex);
+
+  coder.finish();
+}
+
+//----------------------------------------------------------------------------
+
 Vec3<int64_t>
 AttributeEncoder::computeColorResiduals(
   const AttributeParameterSet& aps,
@@ -651,24 +724,26 @@ AttributeEncoder::computeColorResiduals(
 
 //----------------------------------------------------------------------------
 
-void
+bool
 AttributeEncoder::computeColorPredictionWeights(
   const AttributeParameterSet& aps,
   const PCCPointSet3& pointCloud,
   const std::vector<uint32_t>& indexesLOD,
   const uint32_t predictorIndex,
-  PCCPredictor& predictor,
+  PredictorStore& predictors,
   PCCResidualsEncoder& encoder,
   PCCResidualsEntropyEstimator& context,
   const Quantizers& quant)
 {
-  predictor.maxDiff = 0;
-  if (predictor.neighborCount > 1 && aps.max_num_direct_predictors) {
+  const int neighborCount = predictors.neighborCount(predictorIndex);
+  int8_t& predMode = predictors.predMode[predictorIndex];
+  int64_t maxDiff = 0;
+  if (neighborCount > 1 && aps.max_num_direct_predictors) {
     int64_t minValue[3] = {0, 0, 0};
     int64_t maxValue[3] = {0, 0, 0};
-    for (int i = 0; i < predictor.neighborCount; ++i) {
-      const Vec3<attr_t> colorNeighbor =
-        pointCloud.getColor(indexesLOD[predictor.neighbors[i].predictorIndex]);
+    for (int i = 0; i < neighborCount; ++i) {
+      const Vec3<attr_t> colorNeighbor = pointCloud.getColor(
+        indexesLOD[predictors.neighborIndex(predictorIndex, i)]);
       for (size_t k = 0; k < 3; ++k) {
         if (i == 0 || colorNeighbor[k] < minValue[k]) {
           minValue[k] = colorNeighbor[k];
@@ -678,17 +753,17 @@ AttributeEncoder::computeColorPredictionWeights(
         }
       }
     }
-    const int64_t maxDiff = (std::max)(
+    maxDiff = (std::max)(
       maxValue[2] - minValue[2],
       (std::max)(maxValue[0] - minValue[0], maxValue[1] - minValue[1]));
-    predictor.maxDiff = maxDiff;
 
     if (maxDiff >= aps.adaptive_prediction_threshold) {
       Vec3<attr_t> attrValue = pointCloud.getColor(indexesLOD[predictorIndex]);
 
       // base case: weighted average of n neighbours
-      predictor.predMode = 0;
-      Vec3<attr_t> attrPred = predictor.predictColor(pointCloud, indexesLOD);
+      predMode = 0;
+      Vec3<attr_t> attrPred =
+        predictors.predictColor(predictorIndex, pointCloud, indexesLOD);
       Vec3<int64_t> attrResidualQuant =
         computeColorResiduals(aps, attrValue, attrPred, quant);
 
@@ -697,12 +772,12 @@ AttributeEncoder::computeColorPredictionWeights(
         + kAttrPredLambdaC
           * (double)(quant[0].stepSize() >> kFixedPointAttributeShift);
 
-      for (int i = 0; i < predictor.neighborCount; i++) {
+      for (int i = 0; i < neighborCount; i++) {
         if (i == aps.max_num_direct_predictors)
           break;
 
         attrPred = pointCloud.getColor(
-          indexesLOD[predictor.neighbors[i].predictorIndex]);
+          indexesLOD[predictors.neighborIndex(predictorIndex, i)]);
         attrResidualQuant =
           computeColorResiduals(aps, attrValue, attrPred, quant);
 
@@ -714,121 +789,270 @@ AttributeEncoder::computeColorPredictionWeights(
 
         if (score < best_score) {
           best_score = score;
-          predictor.predMode = i + 1;
-          // NB: setting predictor.neighborCount = 1 will cause issues
+          predMode = i + 1;
+          // NB: setting the neighbour count to 1 will cause issues
           // with reconstruction.
         }
       }
     }
   }
+
+  return maxDiff >= aps.adaptive_prediction_threshold;
 }
 
 //----------------------------------------------------------------------------
 
+class AttributeEncoder::ColorPredEncoder
+  : public AttributeEncoder::PredEncoder {
+public:
+  ColorPredEncoder(
+    AttributeLods& lods,
+    const AttributeDescription& desc,
+    const AttributeParameterSet& aps,
+    const QpSet& qpSet,
+    PCCPointSet3& pointCloud,
+    PCCResidualsEncoder& encoder)
+    : _lods(lods)
+    , _aps(aps)
+    , _qpSet(qpSet)
+    , _pointCloud(pointCloud)
+    , _encoder(encoder)
+    , _clipMax{(1 << desc.bitdepth) - 1, (1 << desc.bitdepthSecondary) - 1,
+               (1 << desc.bitdepthSecondary) - 1}
+    , _zeroCnt(0)
+    , _quantLayer(0)
+  {
+    const size_t pointCount = pointCloud.getPointCount();
+    for (int i = 0; i < 3; i++) {
+      _residual[i].resize(pointCount);
+    }
+    _signalledPredMode.resize(pointCount);
+  }
+
+  void encodePoint(size_t predictorIndex) override;
+  void finish() override;
+
+private:
+  AttributeLods& _lods;
+  const AttributeParameterSet& _aps;
+  const QpSet& _qpSet;
+  PCCPointSet3& _pointCloud;
+  PCCResidualsEncoder& _encoder;
+  const Vec3<int64_t> _clipMax;
+  PCCResidualsEntropyEstimator _context;
+  int _zeroCnt;
+  std::vector<int> _zerorun;
+  std::vector<int32_t> _residual[3];
+
+  // The prediction mode of each point, or -1 if it is not signalled
+  std::vector<int8_t> _signalledPredMode;
+
+  int _quantLayer;
+};
+
+//----------------------------------------------------------------------------
+
 void
-AttributeEncoder::encodeColorsPred(
-  const AttributeDescription& desc,
-  const AttributeParameterSet& aps,
-  const QpSet& qpSet,
-  PCCPointSet3& pointCloud,
-  PCCResidualsEncoder& encoder)
+AttributeEncoder::ColorPredEncoder::encodePoint(size_t predictorIndex)
 {
-  const size_t pointCount = pointCloud.getPointCount();
-
-  Vec3<int64_t> clipMax{(1 << desc.bitdepth) - 1,
-                        (1 << desc.bitdepthSecondary) - 1,
-                        (1 << desc.bitdepthSecondary) - 1};
+  if (predictorIndex == _lods.numPointsInLod[_quantLayer]) {
+    _quantLayer = std::min(int(_qpSet.layers.size()) - 1, _quantLayer + 1);
+  }
+  const auto pointIndex = _lods.indexes[predictorIndex];
+  auto quant = _qpSet.quantizers(_pointCloud[pointIndex], _quantLayer);
+  bool predModeSignalled = computeColorPredictionWeights(
+    _aps, _pointCloud, _lods.indexes, predictorIndex, _lods.predictors,
+    _encoder, _context, quant);
+  _signalledPredMode[predictorIndex] =
+    predModeSignalled ? _lods.predictors.predMode[predictorIndex] : -1;
+
+  const Vec3<attr_t> color = _pointCloud.getColor(pointIndex);
+  const Vec3<attr_t> predictedColor =
+    _lods.predictors.predictColor(predictorIndex, _pointCloud, _lods.indexes);
 
   int32_t values[3];
-  PCCResidualsEntropyEstimator context;
-  int zero_cnt = 0;
-  std::vector<int> zerorun;
-  std::vector<int32_t> residual[3];
-  for (int i = 0; i < 3; i++) {
-    residual[i].resize(pointCount);
-  }
-  int quantLayer = 0;
-  for (size_t predictorIndex = 0; predictorIndex < pointCount;
-       ++predictorIndex) {
-    if (predictorIndex == _lods.numPointsInLod[quantLayer]) {
-      quantLayer = std::min(int(qpSet.layers.size()) - 1, quantLayer + 1);
+  Vec3<attr_t> reconstructedColor;
+  int64_t residual0 = 0;
+  for (int k = 0; k < 3; ++k) {
+    const auto& q = quant[std::min(k, 1)];
+    int64_t residual = color[k] - predictedColor[k];
+
+    int64_t residualQ = q.quantize(residual << kFixedPointAttributeShift);
+    int64_t residualR =
+      divExp2RoundHalfUp(q.scale(residualQ), kFixedPointAttributeShift);
+
+    if (_aps.inter_component_prediction_enabled_flag && k > 0) {
+      residual = residual - residual0;
+      residualQ = q.quantize(residual << kFixedPointAttributeShift);
+      residualR = residual0
+        + divExp2RoundHalfUp(q.scale(residualQ), kFixedPointAttributeShift);
     }
-    const auto pointIndex = _lods.indexes[predictorIndex];
-    auto quant = qpSet.quantizers(pointCloud[pointIndex], quantLayer);
-    auto& predictor = _lods.predictors[predictorIndex];
-
-    computeColorPredictionWeights(
-      aps, pointCloud, _lods.indexes, predictorIndex, predictor, encoder,
-      context, quant);
-    const Vec3<attr_t> color = pointCloud.getColor(pointIndex);
-    const Vec3<attr_t> predictedColor =
-      predictor.predictColor(pointCloud, _lods.indexes);
-
-    Vec3<attr_t> reconstructedColor;
-    int64_t residual0 = 0;
-    for (int k = 0; k < 3; ++k) {
-      const auto& q = quant[std::min(k, 1)];
-      int64_t residual = color[k] - predictedColor[k];
-
-      int64_t residualQ = q.quantize(residual << kFixedPointAttributeShift);
-      int64_t residualR =
-        divExp2RoundHalfUp(q.scale(residualQ), kFixedPointAttributeShift);
-
-      if (aps.inter_component_prediction_enabled_flag && k > 0) {
-        residual = residual - residual0;
-        residualQ = q.quantize(residual << kFixedPointAttributeShift);
-        residualR = residual0
-          + divExp2RoundHalfUp(q.scale(residualQ), kFixedPointAttributeShift);
-      }
 
-      if (k == 0)
-        residual0 = residualR;
+    if (k == 0)
+      residual0 = residualR;
 
-      values[k] = residualQ;
+    values[k] = residualQ;
 
-      int64_t recon = predictedColor[k] + residualR;
-      reconstructedColor[k] = attr_t(PCCClip(recon, int64_t(0), clipMax[k]));
-    }
-    pointCloud.setColor(pointIndex, reconstructedColor);
+    int64_t recon = predictedColor[k] + residualR;
+    reconstructedColor[k] = attr_t(PCCClip(recon, int64_t(0), _clipMax[k]));
+  }
+  _pointCloud.setColor(pointIndex, reconstructedColor);
 
-    if (!values[0] && !values[1] && !values[2]) {
-      ++zero_cnt;
-    } else {
-      zerorun.push_back(zero_cnt);
-      zero_cnt = 0;
-    }
+  if (!values[0] && !values[1] && !values[2]) {
+    ++_zeroCnt;
+  } else {
+    _zerorun.push_back(_zeroCnt);
+    _zeroCnt = 0;
+  }
 
-    for (int i = 0; i < 3; i++) {
-      residual[i][predictorIndex] = values[i];
-    }
+  for (int i = 0; i < 3; i++) {
+    _residual[i][predictorIndex] = values[i];
   }
+}
+
+//----------------------------------------------------------------------------
 
-  zerorun.push_back(zero_cnt);
+void
+AttributeEncoder::ColorPredEncoder::finish()
+{
+  int32_t values[3];
+  _zerorun.push_back(_zeroCnt);
   int run_index = 0;
-  encoder.encodeRunLength(zerorun[run_index]);
-  zero_cnt = zerorun[run_index++];
-  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+  _encoder.encodeRunLength(_zerorun[run_index]);
+  int zero_cnt = _zerorun[run_index++];
+  for (size_t predictorIndex = 0; predictorIndex < _residual[0].size();
        ++predictorIndex) {
-    auto& predictor = _lods.predictors[predictorIndex];
-    if (predictor.maxDiff >= aps.adaptive_prediction_threshold) {
-      encoder.encodePredMode(
-        predictor.predMode, aps.max_num_direct_predictors);
+    if (_signalledPredMode[predictorIndex] >= 0) {
+      _encoder.encodePredMode(
+        _signalledPredMode[predictorIndex], _aps.max_num_direct_predictors);
     }
     if (zero_cnt > 0)
       zero_cnt--;
     else {
       for (size_t k = 0; k < 3; k++)
-        values[k] = residual[k][predictorIndex];
+        values[k] = _residual[k][predictorIndex];
 
-      encoder.encode(values[0], values[1], values[2]);
-      encoder.encodeRunLength(zerorun[run_index]);
-      zero_cnt = zerorun[run_index++];
+      _encoder.encode(values[0], values[1], values[2]);
+      _encoder.encodeRunLength(_zerorun[run_index]);
+      zero_cnt = _zerorun[run_index++];
     }
   }
 }
 
 //----------------------------------------------------------------------------
 
+void
+AttributeEncoder::encodeColorsPred(
+  const AttributeDescription& desc,
+  const AttributeParameterSet& aps,
+  const QpSet& qpSet,
+  PCCPointSet3& pointCloud,
+  PCCResidualsEncoder& encoder)
+{
+  ColorPredEncoder coder(_lods, desc, aps, qpSet, pointCloud, encoder);
+
+  const size_t pointCount = pointCloud.getPointCount();
+  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+       ++predictorIndex)
+    coder.encodePoint(predictorIndex);
+
+  coder.finish();
+}
+
+//----------------------------------------------------------------------------
+
+bool
+AttributeEncoder::encodeFused(
+  const SequenceParameterSet& sps,
+  const std::vector<AttributeBrickEncoding>& attrs,
+  PCCPointSet3& pointCloud)
+{
+  // NB: the attributes must all be coded using the same transform
+  const auto encoding = attrs[0].aps->attr_encoding;
+  for (const auto& attr : attrs)
+    if (
+      !fusedCodingSupported(*attr.aps)
+      || attr.aps->attr_encoding != encoding)
+      return false;
+
+  // generate LoDs if necessary, and check that they are shared by all
+  if (_lods.empty())
+    _lods.generate(
+      *attrs[0].aps, *attrs[0].abh, pointCloud.getPointCount() - 1, 0,
+      pointCloud, _threadPool, _lodCache);
+
+  for (const auto& attr : attrs)
+    if (!_lods.isReusable(*attr.aps, *attr.abh))
+      return false;
+
+  const size_t numAttrs = attrs.size();
+  std::vector<QpSet> qpSets(numAttrs);
+  std::vector<std::unique_ptr<PCCResidualsEncoder>> encoders(numAttrs);
+  for (size_t i = 0; i < numAttrs; i++) {
+    const auto& attr = attrs[i];
+    qpSets[i] = deriveQpSet(*attr.desc, *attr.aps, *attr.abh);
+
+    // write abh
+    write(sps, *attr.aps, *attr.abh, attr.payload);
+
+    encoders[i].reset(new PCCResidualsEncoder(*attr.abh, *attr.ctxtMem));
+    encoders[i]->start(sps, int(pointCloud.getPointCount()));
+  }
+
+  if (encoding == AttributeEncoding::kLiftingTransform)
+    encodeLiftFused(attrs, qpSets, encoders, pointCloud);
+  else
+    encodePredFused(attrs, qpSets, encoders, pointCloud);
+
+  for (size_t i = 0; i < numAttrs; i++) {
+    auto& encoder = *encoders[i];
+    uint32_t acDataLen = encoder.stop();
+    std::copy_n(
+      encoder.arithmeticEncoder.buffer(), acDataLen,
+      std::back_inserter(*attrs[i].payload));
+
+    // save the context state for re-use by a future slice if required
+    *attrs[i].ctxtMem = encoder.getCtx();
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+void
+AttributeEncoder::encodePredFused(
+  const std::vector<AttributeBrickEncoding>& attrs,
+  const std::vector<QpSet>& qpSets,
+  const std::vector<std::unique_ptr<PCCResidualsEncoder>>& encoders,
+  PCCPointSet3& pointCloud)
+{
+  const size_t numAttrs = attrs.size();
+  std::vector<std::unique_ptr<PredEncoder>> coders(numAttrs);
+  for (size_t i = 0; i < numAttrs; i++) {
+    const auto& attr = attrs[i];
+    if (attr.desc->attr_num_dimensions_minus1 == 0)
+      coders[i].reset(new ReflectancePredEncoder(
+        _lods, *attr.desc, *attr.aps, qpSets[i], pointCloud, *encoders[i]));
+    else
+      coders[i].reset(new ColorPredEncoder(
+        _lods, *attr.desc, *attr.aps, qpSets[i], pointCloud, *encoders[i]));
+  }
+
+  // NB: each point is encoded in attribute order, as if the attributes
+  //     were encoded in turn, since they share the prediction modes.
+  const size_t pointCount = pointCloud.getPointCount();
+  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+       ++predictorIndex)
+    for (auto& coder : coders)
+      coder->encodePoint(predictorIndex);
+
+  for (auto& coder : coders)
+    coder->finish();
+}
+
+//----------------------------------------------------------------------------
+
 void
 AttributeEncoder::encodeReflectancesTransformRaht(
   const AttributeDescription& desc,
@@ -972,133 +1196,344 @@ AttributeEncoder::encodeColorsTransformRaht(
 
 //----------------------------------------------------------------------------
 
+// Encoding of an attribute using the lifting transform.  The forward
+// transform is applied one level of detail at a time.  The coefficients are
+// then coded one point at a time, in predictor order, and the attribute is
+// reconstructed one level of detail at a time.
+
+class AttributeEncoder::LiftEncoder {
+public:
+  virtual ~LiftEncoder() = default;
+  virtual void transformLod(size_t lodIndex) = 0;
+
+  // Called once every level of detail has been transformed
+  virtual void start() {}
+
+  virtual void encodePoint(size_t predictorIndex) = 0;
+  virtual void reconstructLod(size_t lodIndex) = 0;
+  virtual void finish() = 0;
+};
+
+//----------------------------------------------------------------------------
+
+class AttributeEncoder::ReflectanceLiftEncoder
+  : public AttributeEncoder::LiftEncoder {
+public:
+  ReflectanceLiftEncoder(
+    const AttributeLods& lods,
+    const AttributeDescription& desc,
+    const QpSet& qpSet,
+    const std::vector<uint64_t>& weights,
+    PCCPointSet3& pointCloud,
+    PCCResidualsEncoder& encoder)
+    : _lods(lods)
+    , _qpSet(qpSet)
+    , _weights(weights)
+    , _pointCloud(pointCloud)
+    , _encoder(encoder)
+    , _maxReflectance((1ll << desc.bitdepth) - 1)
+    , _reflectances(pointCloud.getPointCount())
+    , _zeroCnt(0)
+    , _quantLayer(0)
+  {
+    for (size_t index = 0; index < _reflectances.size(); ++index) {
+      _reflectances[index] =
+        int32_t(pointCloud.getReflectance(lods.indexes[index]))
+        << kFixedPointAttributeShift;
+    }
+  }
+
+  void transformLod(size_t lodIndex) override;
+  void encodePoint(size_t predictorIndex) override;
+  void reconstructLod(size_t lodIndex) override;
+  void finish() override;
+
+private:
+  const AttributeLods& _lods;
+  const QpSet& _qpSet;
+  const std::vector<uint64_t>& _weights;
+  PCCPointSet3& _pointCloud;
+  PCCResidualsEncoder& _encoder;
+  const int64_t _maxReflectance;
+  std::vector<int64_t> _reflectances;
+  int _zeroCnt;
+  int _quantLayer;
+};
+
+//----------------------------------------------------------------------------
+
+void
+AttributeEncoder::ReflectanceLiftEncoder::transformLod(size_t lodIndex)
+{
+  const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
+  const size_t endIndex = _lods.numPointsInLod[lodIndex];
+  PCCLiftPredict(_lods.predictors, startIndex, endIndex, true, _reflectances);
+  PCCLiftUpdate(
+    _lods.predictors, _weights, startIndex, endIndex, true, _reflectances);
+}
+
+//----------------------------------------------------------------------------
+
 void
-AttributeEncoder::encodeColorsLift(
-  const AttributeDescription& desc,
-  const AttributeParameterSet& aps,
-  const QpSet& qpSet,
-  PCCPointSet3& pointCloud,
-  PCCResidualsEncoder& encoder)
+AttributeEncoder::ReflectanceLiftEncoder::encodePoint(size_t predictorIndex)
 {
-  const size_t pointCount = pointCloud.getPointCount();
-  std::vector<uint64_t> weights;
+  if (predictorIndex == _lods.numPointsInLod[_quantLayer]) {
+    _quantLayer = std::min(int(_qpSet.layers.size()) - 1, _quantLayer + 1);
+  }
+  const auto pointIndex = _lods.indexes[predictorIndex];
+  auto quant = _qpSet.quantizers(_pointCloud[pointIndex], _quantLayer);
+
+  const int64_t iQuantWeight = irsqrt(_weights[predictorIndex]);
+  const int64_t quantWeight =
+    (_weights[predictorIndex] * iQuantWeight + (1ull << 39)) >> 40;
+
+  auto& reflectance = _reflectances[predictorIndex];
+  const int64_t delta = quant[0].quantize(reflectance * quantWeight);
+  const auto detail = delta;
+  const int64_t reconstructedDelta = quant[0].scale(delta);
+  reflectance = divExp2RoundHalfInf(reconstructedDelta * iQuantWeight, 40);
+  if (!detail)
+    ++_zeroCnt;
+  else {
+    _encoder.encodeRunLength(_zeroCnt);
+    _encoder.encode(detail);
+    _zeroCnt = 0;
+  }
+}
 
-  if (!aps.scalable_lifting_enabled_flag) {
-    PCCComputeQuantizationWeights(_lods.predictors, weights);
-  } else {
-    computeQuantizationWeightsScalable(
-      _lods.predictors, _lods.numPointsInLod, pointCount, 0, weights);
+//----------------------------------------------------------------------------
+
+void
+AttributeEncoder::ReflectanceLiftEncoder::reconstructLod(size_t lodIndex)
+{
+  const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
+  const size_t endIndex = _lods.numPointsInLod[lodIndex];
+  PCCLiftUpdate(
+    _lods.predictors, _weights, startIndex, endIndex, false, _reflectances);
+  PCCLiftPredict(
+    _lods.predictors, startIndex, endIndex, false, _reflectances);
+}
+
+//----------------------------------------------------------------------------
+
+void
+AttributeEncoder::ReflectanceLiftEncoder::finish()
+{
+  _encoder.encodeRunLength(_zeroCnt);
+
+  const size_t pointCount = _reflectances.size();
+  for (size_t f = 0; f < pointCount; ++f) {
+    const int64_t refl =
+      divExp2RoundHalfInf(_reflectances[f], kFixedPointAttributeShift);
+    _pointCloud.setReflectance(
+      _lods.indexes[f], attr_t(PCCClip(refl, int64_t(0), _maxReflectance)));
   }
+}
 
-  const size_t lodCount = _lods.numPointsInLod.size();
-  std::vector<Vec3<int64_t>> colors;
-  colors.resize(pointCount);
+//----------------------------------------------------------------------------
 
-  for (size_t index = 0; index < pointCount; ++index) {
-    const auto& color = pointCloud.getColor(_lods.indexes[index]);
-    for (size_t d = 0; d < 3; ++d) {
-      colors[index][d] = int32_t(color[d]) << kFixedPointAttributeShift;
+class AttributeEncoder::ColorLiftEncoder
+  : public AttributeEncoder::LiftEncoder {
+public:
+  ColorLiftEncoder(
+    const AttributeLods& lods,
+    const AttributeDescription& desc,
+    const AttributeParameterSet& aps,
+    const QpSet& qpSet,
+    const std::vector<uint64_t>& weights,
+    PCCPointSet3& pointCloud,
+    PCCResidualsEncoder& encoder)
+    : _lods(lods)
+    , _aps(aps)
+    , _qpSet(qpSet)
+    , _weights(weights)
+    , _pointCloud(pointCloud)
+    , _encoder(encoder)
+    , _clipMax{(1 << desc.bitdepth) - 1, (1 << desc.bitdepthSecondary) - 1,
+               (1 << desc.bitdepthSecondary) - 1}
+    , _colors(pointCloud.getPointCount())
+    , _lastCompPredCoeff(0)
+    , _zeroCnt(0)
+    , _quantLayer(0)
+    , _lod(0)
+  {
+    for (size_t index = 0; index < _colors.size(); ++index) {
+      const auto& color = pointCloud.getColor(lods.indexes[index]);
+      for (size_t d = 0; d < 3; ++d) {
+        _colors[index][d] = int32_t(color[d]) << kFixedPointAttributeShift;
+      }
     }
   }
 
-  for (size_t i = 0; (i + 1) < lodCount; ++i) {
-    const size_t lodIndex = lodCount - i - 1;
-    const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
-    const size_t endIndex = _lods.numPointsInLod[lodIndex];
-    PCCLiftPredict(_lods.predictors, startIndex, endIndex, true, colors);
-    PCCLiftUpdate(
-      _lods.predictors, weights, startIndex, endIndex, true, colors);
-  }
+  void transformLod(size_t lodIndex) override;
+  void start() override;
+  void encodePoint(size_t predictorIndex) override;
+  void reconstructLod(size_t lodIndex) override;
+  void finish() override;
+
+private:
+  const AttributeLods& _lods;
+  const AttributeParameterSet& _aps;
+  const QpSet& _qpSet;
+  const std::vector<uint64_t>& _weights;
+  PCCPointSet3& _pointCloud;
+  PCCResidualsEncoder& _encoder;
+  const Vec3<int64_t> _clipMax;
+  std::vector<Vec3<int64_t>> _colors;
+  std::vector<int8_t> _lastCompPredCoeffs;
+  int8_t _lastCompPredCoeff;
+  int _zeroCnt;
+  int _quantLayer;
+  int _lod;
+};
+
+//----------------------------------------------------------------------------
+
+void
+AttributeEncoder::ColorLiftEncoder::transformLod(size_t lodIndex)
+{
+  const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
+  const size_t endIndex = _lods.numPointsInLod[lodIndex];
+  PCCLiftPredict(_lods.predictors, startIndex, endIndex, true, _colors);
+  PCCLiftUpdate(
+    _lods.predictors, _weights, startIndex, endIndex, true, _colors);
+}
+
+//----------------------------------------------------------------------------
 
+void
+AttributeEncoder::ColorLiftEncoder::start()
+{
   // Per level-of-detail coefficients {-1,0,1} for last component prediction
-  int8_t lastCompPredCoeff = 0;
-  std::vector<int8_t> lastCompPredCoeffs;
-  if (aps.last_component_prediction_enabled_flag) {
-    lastCompPredCoeffs = computeLastComponentPredictionCoeff(colors);
-    encoder.encodeLastCompPredCoeffs(lastCompPredCoeffs);
-    lastCompPredCoeff = lastCompPredCoeffs[0];
+  if (_aps.last_component_prediction_enabled_flag) {
+    _lastCompPredCoeffs =
+      computeLastComponentPredictionCoeff(_lods.numPointsInLod, _colors);
+    _encoder.encodeLastCompPredCoeffs(_lastCompPredCoeffs);
+    _lastCompPredCoeff = _lastCompPredCoeffs[0];
   }
+}
 
-  int zero_cnt = 0;
-  int quantLayer = 0;
-  int lod = 0;
-  for (size_t predictorIndex = 0; predictorIndex < pointCount;
-       ++predictorIndex) {
-    if (predictorIndex == _lods.numPointsInLod[quantLayer]) {
-      quantLayer = std::min(int(qpSet.layers.size()) - 1, quantLayer + 1);
-    }
+//----------------------------------------------------------------------------
 
-    if (predictorIndex == _lods.numPointsInLod[lod]) {
-      lod++;
-      if (aps.last_component_prediction_enabled_flag)
-        lastCompPredCoeff = lastCompPredCoeffs[lod];
-    }
+void
+AttributeEncoder::ColorLiftEncoder::encodePoint(size_t predictorIndex)
+{
+  if (predictorIndex == _lods.numPointsInLod[_quantLayer]) {
+    _quantLayer = std::min(int(_qpSet.layers.size()) - 1, _quantLayer + 1);
+  }
 
-    const auto pointIndex = _lods.indexes[predictorIndex];
-    auto quant = qpSet.quantizers(pointCloud[pointIndex], quantLayer);
+  if (predictorIndex == _lods.numPointsInLod[_lod]) {
+    _lod++;
+    if (_aps.last_component_prediction_enabled_flag)
+      _lastCompPredCoeff = _lastCompPredCoeffs[_lod];
+  }
 
-    const int64_t iQuantWeight = irsqrt(weights[predictorIndex]);
-    const int64_t quantWeight =
-      (weights[predictorIndex] * iQuantWeight + (1ull << 39)) >> 40;
+  const auto pointIndex = _lods.indexes[predictorIndex];
+  auto quant = _qpSet.quantizers(_pointCloud[pointIndex], _quantLayer);
 
-    auto& color = colors[predictorIndex];
-    int values[3];
-    values[0] = quant[0].quantize(color[0] * quantWeight);
-    int64_t scaled = quant[0].scale(values[0]);
-    color[0] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
+  const int64_t iQuantWeight = irsqrt(_weights[predictorIndex]);
+  const int64_t quantWeight =
+    (_weights[predictorIndex] * iQuantWeight + (1ull << 39)) >> 40;
 
-    values[1] = quant[1].quantize(color[1] * quantWeight);
-    scaled = quant[1].scale(values[1]);
-    color[1] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
+  auto& color = _colors[predictorIndex];
+  int values[3];
+  values[0] = quant[0].quantize(color[0] * quantWeight);
+  int64_t scaled = quant[0].scale(values[0]);
+  color[0] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
 
-    color[2] -= lastCompPredCoeff * color[1];
-    scaled *= lastCompPredCoeff;
+  values[1] = quant[1].quantize(color[1] * quantWeight);
+  scaled = quant[1].scale(values[1]);
+  color[1] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
 
-    values[2] = quant[1].quantize(color[2] * quantWeight);
-    scaled += quant[1].scale(values[2]);
-    color[2] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
+  color[2] -= _lastCompPredCoeff * color[1];
+  scaled *= _lastCompPredCoeff;
 
-    if (!values[0] && !values[1] && !values[2])
-      ++zero_cnt;
-    else {
-      encoder.encodeRunLength(zero_cnt);
-      encoder.encode(values[0], values[1], values[2]);
-      zero_cnt = 0;
-    }
-  }
-  encoder.encodeRunLength(zero_cnt);
+  values[2] = quant[1].quantize(color[2] * quantWeight);
+  scaled += quant[1].scale(values[2]);
+  color[2] = divExp2RoundHalfInf(scaled * iQuantWeight, 40);
 
-  // reconstruct
-  for (size_t lodIndex = 1; lodIndex < lodCount; ++lodIndex) {
-    const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
-    const size_t endIndex = _lods.numPointsInLod[lodIndex];
-    PCCLiftUpdate(
-      _lods.predictors, weights, startIndex, endIndex, false, colors);
-    PCCLiftPredict(_lods.predictors, startIndex, endIndex, false, colors);
+  if (!values[0] && !values[1] && !values[2])
+    ++_zeroCnt;
+  else {
+    _encoder.encodeRunLength(_zeroCnt);
+    _encoder.encode(values[0], values[1], values[2]);
+    _zeroCnt = 0;
   }
+}
 
-  Vec3<int64_t> clipMax{(1 << desc.bitdepth) - 1,
-                        (1 << desc.bitdepthSecondary) - 1,
-                        (1 << desc.bitdepthSecondary) - 1};
+//----------------------------------------------------------------------------
 
+void
+AttributeEncoder::ColorLiftEncoder::reconstructLod(size_t lodIndex)
+{
+  const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
+  const size_t endIndex = _lods.numPointsInLod[lodIndex];
+  PCCLiftUpdate(
+    _lods.predictors, _weights, startIndex, endIndex, false, _colors);
+  PCCLiftPredict(_lods.predictors, startIndex, endIndex, false, _colors);
+}
+
+//----------------------------------------------------------------------------
+
+void
+AttributeEncoder::ColorLiftEncoder::finish()
+{
+  _encoder.encodeRunLength(_zeroCnt);
+
+  const size_t pointCount = _colors.size();
   for (size_t f = 0; f < pointCount; ++f) {
     const auto color0 =
-      divExp2RoundHalfInf(colors[f], kFixedPointAttributeShift);
+      divExp2RoundHalfInf(_colors[f], kFixedPointAttributeShift);
     Vec3<attr_t> color;
     for (size_t d = 0; d < 3; ++d) {
-      color[d] = attr_t(PCCClip(color0[d], 0, clipMax[d]));
+      color[d] = attr_t(PCCClip(color0[d], 0, _clipMax[d]));
     }
-    pointCloud.setColor(_lods.indexes[f], color);
+    _pointCloud.setColor(_lods.indexes[f], color);
   }
 }
 
 //----------------------------------------------------------------------------
 
+void
+AttributeEncoder::encodeColorsLift(
+  const AttributeDescription& desc,
+  const AttributeParameterSet& aps,
+  const QpSet& qpSet,
+  PCCPointSet3& pointCloud,
+  PCCResidualsEncoder& encoder)
+{
+  const size_t pointCount = pointCloud.getPointCount();
+  std::vector<uint64_t> weights;
+  computeLiftingWeights(_lods, aps, pointCount, 0, weights);
+
+  ColorLiftEncoder coder(
+    _lods, desc, aps, qpSet, weights, pointCloud, encoder);
+
+  const size_t lodCount = _lods.numPointsInLod.size();
+  for (size_t i = 0; (i + 1) < lodCount; ++i)
+    coder.transformLod(lodCount - i - 1);
+
+  coder.start();
+
+  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+       ++predictorIndex)
+    coder.encodePoint(predictorIndex);
+
+  // reconstruct
+  for (size_t lodIndex = 1; lodIndex < lodCount; ++lodIndex)
+    coder.reconstructLod(lodIndex);
+
+  coder.finish();
+}
+
+//----------------------------------------------------------------------------
+
 std::vector<int8_t>
 AttributeEncoder::computeLastComponentPredictionCoeff(
+  const std::vector<uint32_t>& numPointsInLod,
   const std::vector<Vec3<int64_t>>& coeffs)
 {
-  std::vector<int8_t> signs(_lods.numPointsInLod.size(), 0);
+  std::vector<int8_t> signs(numPointsInLod.size(), 0);
 
   int numGt0 = 0;
   int numLt0 = 0;
@@ -1114,7 +1549,7 @@ AttributeEncoder::computeLastComponentPredictionCoeff(
     else if (mult < 0)
       numLt0++;
 
-    if (coeffIdx == _lods.numPointsInLod[lod] - 1) {
+    if (coeffIdx == numPointsInLod[lod] - 1) {
       constexpr double threshold = 0.7;
       if (numGt0 > threshold * lodPointIdx)
         signs[lod] = 1;
@@ -1144,7 +1579,7 @@ AttributeEncoder::computeLastComponentPredictionCoeff(
       sumOrigCoeff += abs(coeff[2]);
     }
 
-    if (coeffIdx == _lods.numPointsInLod[lod] - 1) {
+    if (coeffIdx == numPointsInLod[lod] - 1) {
       constexpr double threshold2 = 0.9;
       if (signs[lod] != 0 && sumPredCoeff > threshold2 * sumOrigCoeff)
         signs[lod] = 0;
@@ -1170,79 +1605,74 @@ AttributeEncoder::encodeReflectancesLift(
 {
   const size_t pointCount = pointCloud.getPointCount();
   std::vector<uint64_t> weights;
+  computeLiftingWeights(_lods, aps, pointCount, 0, weights);
 
-  if (!aps.scalable_lifting_enabled_flag) {
-    PCCComputeQuantizationWeights(_lods.predictors, weights);
-  } else {
-    computeQuantizationWeightsScalable(
-      _lods.predictors, _lods.numPointsInLod, pointCount, 0, weights);
-  }
+  ReflectanceLiftEncoder coder(
+    _lods, desc, qpSet, weights, pointCloud, encoder);
 
   const size_t lodCount = _lods.numPointsInLod.size();
-  std::vector<int64_t> reflectances;
-  reflectances.resize(pointCount);
+  for (size_t i = 0; (i + 1) < lodCount; ++i)
+    coder.transformLod(lodCount - i - 1);
 
-  for (size_t index = 0; index < pointCount; ++index) {
-    reflectances[index] =
-      int32_t(pointCloud.getReflectance(_lods.indexes[index]))
-      << kFixedPointAttributeShift;
-  }
+  // compress
+  for (size_t predictorIndex = 0; predictorIndex < pointCount;
+       ++predictorIndex)
+    coder.encodePoint(predictorIndex);
+
+  // reconstruct
+  for (size_t lodIndex = 1; lodIndex < lodCount; ++lodIndex)
+    coder.reconstructLod(lodIndex);
 
-  for (size_t i = 0; (i + 1) < lodCount; ++i) {
-    const size_t lodIndex = lodCount - i - 1;
-    const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
-    const size_t endIndex = _lods.numPointsInLod[lodIndex];
-    PCCLiftPredict(_lods.predictors, startIndex, endIndex, true, reflectances);
-    PCCLiftUpdate(
-      _lods.predictors, weights, startIndex, endIndex, true, reflectances);
+  coder.finish();
+}
+
+//----------------------------------------------------------------------------
+
+void
+AttributeEncoder::encodeLiftFused(
+  const std::vector<AttributeBrickEncoding>& attrs,
+  const std::vector<QpSet>& qpSets,
+  const std::vector<std::unique_ptr<PCCResidualsEncoder>>& encoders,
+  PCCPointSet3& pointCloud)
+{
+  // NB: the quantisation weights depend only upon the shared LoDs
+  const size_t pointCount = pointCloud.getPointCount();
+  std::vector<uint64_t> weights;
+  computeLiftingWeights(_lods, *attrs[0].aps, pointCount, 0, weights);
+
+  const size_t numAttrs = attrs.size();
+  std::vector<std::unique_ptr<LiftEncoder>> coders(numAttrs);
+  for (size_t i = 0; i < numAttrs; i++) {
+    const auto& attr = attrs[i];
+    if (attr.desc->attr_num_dimensions_minus1 == 0)
+      coders[i].reset(new ReflectanceLiftEncoder(
+        _lods, *attr.desc, qpSets[i], weights, pointCloud, *encoders[i]));
+    else
+      coders[i].reset(new ColorLiftEncoder(
+        _lods, *attr.desc, *attr.aps, qpSets[i], weights, pointCloud,
+        *encoders[i]));
   }
 
-  // compress
-  int zero_cnt = 0;
-  int quantLayer = 0;
+  const size_t lodCount = _lods.numPointsInLod.size();
+  for (size_t i = 0; (i + 1) < lodCount; ++i)
+    for (auto& coder : coders)
+      coder->transformLod(lodCount - i - 1);
+
+  for (auto& coder : coders)
+    coder->start();
+
   for (size_t predictorIndex = 0; predictorIndex < pointCount;
-       ++predictorIndex) {
-    if (predictorIndex == _lods.numPointsInLod[quantLayer]) {
-      quantLayer = std::min(int(qpSet.layers.size()) - 1, quantLayer + 1);
-    }
-    const auto pointIndex = _lods.indexes[predictorIndex];
-    auto quant = qpSet.quantizers(pointCloud[pointIndex], quantLayer);
-
-    const int64_t iQuantWeight = irsqrt(weights[predictorIndex]);
-    const int64_t quantWeight =
-      (weights[predictorIndex] * iQuantWeight + (1ull << 39)) >> 40;
-
-    auto& reflectance = reflectances[predictorIndex];
-    const int64_t delta = quant[0].quantize(reflectance * quantWeight);
-    const auto detail = delta;
-    const int64_t reconstructedDelta = quant[0].scale(delta);
-    reflectance = divExp2RoundHalfInf(reconstructedDelta * iQuantWeight, 40);
-    if (!detail)
-      ++zero_cnt;
-    else {
-      encoder.encodeRunLength(zero_cnt);
-      encoder.encode(detail);
-      zero_cnt = 0;
-    }
-  }
-  encoder.encodeRunLength(zero_cnt);
+       ++predictorIndex)
+    for (auto& coder : coders)
+      coder->encodePoint(predictorIndex);
 
   // reconstruct
-  for (size_t lodIndex = 1; lodIndex < lodCount; ++lodIndex) {
-    const size_t startIndex = _lods.numPointsInLod[lodIndex - 1];
-    const size_t endIndex = _lods.numPointsInLod[lodIndex];
-    PCCLiftUpdate(
-      _lods.predictors, weights, startIndex, endIndex, false, reflectances);
-    PCCLiftPredict(
-      _lods.predictors, startIndex, endIndex, false, reflectances);
-  }
-  const int64_t maxReflectance = (1 << desc.bitdepth) - 1;
-  for (size_t f = 0; f < pointCount; ++f) {
-    const int64_t refl =
-      divExp2RoundHalfInf(reflectances[f], kFixedPointAttributeShift);
-    pointCloud.setReflectance(
-      _lods.indexes[f], attr_t(PCCClip(refl, int64_t(0), maxReflectance)));
-  }
+  for (size_t lodIndex = 1; lodIndex < lodCount; ++lodIndex)
+    for (auto& coder : coders)
+      coder->reconstructLod(lodIndex);
+
+  for (auto& coder : coders)
+    coder->finish();
 }
 
 //============================================================================
@@ -0,0 +1,175 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2020, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "codec.h"
+
+namespace pcc {
+
+//============================================================================
+
+void
+setPoints(
+  PCCPointSet3* cloud,
+  size_t numPoints,
+  const int32_t* positions,
+  const attr_t* colours,
+  const attr_t* reflectances)
+{
+  cloud->clear();
+  cloud->addRemoveAttributes(colours != nullptr, reflectances != nullptr);
+  cloud->resize(numPoints);
+
+  for (size_t i = 0; i < numPoints; i++, positions += 3)
+    (*cloud)[i] = {positions[0], positions[1], positions[2]};
+
+  if (colours)
+    for (size_t i = 0; i < numPoints; i++, colours += 3)
+      cloud->setColor(i, {colours[0], colours[1], colours[2]});
+
+  if (reflectances)
+    for (size_t i = 0; i < numPoints; i++)
+      cloud->setReflectance(i, reflectances[i]);
+}
+
+//----------------------------------------------------------------------------
+
+void
+getPoints(
+  const PCCPointSet3& cloud,
+  int32_t* positions,
+  attr_t* colours,
+  attr_t* reflectances)
+{
+  size_t numPoints = cloud.getPointCount();
+
+  for (size_t i = 0; i < numPoints; i++) {
+    const auto& pos = cloud[i];
+    *positions++ = pos[0];
+    *positions++ = pos[1];
+    *positions++ = pos[2];
+  }
+
+  if (colours && cloud.hasColors()) {
+    for (size_t i = 0; i < numPoints; i++) {
+      const auto& colour = cloud.getColor(i);
+      *colours++ = colour[0];
+      *colours++ = colour[1];
+      *colours++ = colour[2];
+    }
+  }
+
+  if (reflectances && cloud.hasReflectances())
+    for (size_t i = 0; i < numPoints; i++)
+      reflectances[i] = cloud.getReflectance(i);
+}
+
+//============================================================================
+// Collects the data units produced by the encoder.
+
+namespace {
+  struct PayloadCollector : public PCCTMC3Encoder3::Callbacks {
+    std::vector<PayloadBuffer>* payloads;
+
+    void onOutputBuffer(const PayloadBuffer& buf) override
+    {
+      payloads->push_back(buf);
+    }
+
+    void onPostRecolour(const PCCPointSet3&) override {}
+  };
+}  // namespace
+
+//----------------------------------------------------------------------------
+
+int
+encodeFrame(
+  PCCTMC3Encoder3* encoder,
+  const PCCPointSet3& cloud,
+  EncoderParams* params,
+  std::vector<PayloadBuffer>* payloads,
+  PCCPointSet3* reconstructedCloud)
+{
+  PayloadCollector collector;
+  collector.payloads = payloads;
+  return encoder->compress(cloud, params, &collector, reconstructedCloud);
+}
+
+//============================================================================
+
+int
+decodeFrames(
+  PCCTMC3Decoder3* decoder,
+  const std::vector<PayloadView>& payloads,
+  PCCTMC3Decoder3::Callbacks* callback)
+{
+  for (const auto& buf : payloads)
+    if (int ret = decoder->decompress(&buf, callback))
+      return ret;
+
+  // flush the decoder to output the last frame
+  return decoder->decompress(nullptr, callback);
+}
+
+//----------------------------------------------------------------------------
+// Collects the frames produced by the decoder.
+
+namespace {
+  struct FrameCollector : public PCCTMC3Decoder3::Callbacks {
+    std::vector<PCCPointSet3>* frames;
+
+    void onOutputCloud(
+      const SequenceParameterSet&, const PCCPointSet3& cloud) override
+    {
+      frames->push_back(cloud);
+    }
+  };
+}  // namespace
+
+//----------------------------------------------------------------------------
+
+int
+decodeFrames(
+  PCCTMC3Decoder3* decoder,
+  const std::vector<PayloadView>& payloads,
+  std::vector<PCCPointSet3>* frames)
+{
+  FrameCollector collector;
+  collector.frames = frames;
+  return decodeFrames(decoder, payloads, &collector);
+}
+
+//============================================================================
+
+}  // namespace pcc
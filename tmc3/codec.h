@@ -0,0 +1,111 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2020, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PCCPointSet.h"
+#include "PCCTMC3Decoder.h"
+#include "PCCTMC3Encoder.h"
+#include "PayloadBuffer.h"
+
+namespace pcc {
+
+//============================================================================
+// In-memory interface to the codec provided by the libtmc3 library.
+//
+// PCCTMC3Encoder3 and PCCTMC3Decoder3 code a sequence of frames and report
+// their output using Callbacks.  The following functions code frames to and
+// from data units held in memory; TlvReader (io_tlv.h) obtains the data
+// units of a TLV encapsulated bitstream held in memory.
+//
+// Attribute values are in the coded representation (ie, the colour space
+// signalled in the SPS) and decoded positions are relative to the sequence
+// bounding box origin.
+
+//============================================================================
+// Initialise cloud with numPoints points from arrays of interleaved x, y, z
+// positions and, optionally, interleaved colour components (three per
+// point) and reflectances.
+
+void setPoints(
+  PCCPointSet3* cloud,
+  size_t numPoints,
+  const int32_t* positions,
+  const attr_t* colours = nullptr,
+  const attr_t* reflectances = nullptr);
+
+// Copy the points of cloud to arrays that are able to hold
+// cloud.getPointCount() points.  Attribute arrays may be null if unwanted.
+void getPoints(
+  const PCCPointSet3& cloud,
+  int32_t* positions,
+  attr_t* colours = nullptr,
+  attr_t* reflectances = nullptr);
+
+//============================================================================
+// Encode a single frame, appending its data units (including the parameter
+// sets) to payloads.  The same params must be used for each frame of the
+// sequence.  Returns non-zero on error.
+
+int encodeFrame(
+  PCCTMC3Encoder3* encoder,
+  const PCCPointSet3& cloud,
+  EncoderParams* params,
+  std::vector<PayloadBuffer>* payloads,
+  PCCPointSet3* reconstructedCloud = nullptr);
+
+//----------------------------------------------------------------------------
+// Decode the data units of one or more frames, then flush the decoder.
+// Each decoded frame is reported to callback.  The decoder may be used to
+// decode further frames.  Returns non-zero on error.
+
+int decodeFrames(
+  PCCTMC3Decoder3* decoder,
+  const std::vector<PayloadView>& payloads,
+  PCCTMC3Decoder3::Callbacks* callback);
+
+// As above, appending each decoded frame to frames.
+int decodeFrames(
+  PCCTMC3Decoder3* decoder,
+  const std::vector<PayloadView>& payloads,
+  std::vector<PCCPointSet3>* frames);
+
+//============================================================================
+
+}  // namespace pcc
@@ -37,6 +37,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <iostream>
 #include <string>
 
 #include "AttributeCommon.h"
@@ -56,7 +57,22 @@ namespace pcc {
 
 //============================================================================
 
-PCCTMC3Decoder3::PCCTMC3Decoder3(const DecoderParams& params) : _params(params)
+PCCTMC3Decoder3::PCCTMC3Decoder3(const DecoderParams& params)
+  : PCCTMC3Decoder3(
+      params,
+      params.lodCacheSize > 0
+        ? std::make_shared<AttributeLodCache>(params.lodCacheSize)
+        : nullptr)
+{}
+
+//----------------------------------------------------------------------------
+
+PCCTMC3Decoder3::PCCTMC3Decoder3(
+  const DecoderParams& params, std::shared_ptr<AttributeLodCache> lodCache)
+  : _params(params)
+  , _lodThreadPool(nullptr)
+  , _lodCache(std::move(lodCache))
+  , _log(&std::cout)
 {
   init();
 }
@@ -95,23 +111,24 @@ payloadStartsNewSlice(PayloadType type)
 
 int
 PCCTMC3Decoder3::decompress(
-  const PayloadBuffer* buf, PCCTMC3Decoder3::Callbacks* callback)
+  const PayloadView* buf, PCCTMC3Decoder3::Callbacks* callback)
 {
   // Starting a new geometry brick/slice/tile, transfer any
   // finished points to the output accumulator
-  if (!buf || payloadStartsNewSlice(buf->type)) {
-    if (size_t numPoints = _currentPointCloud.getPointCount()) {
-      for (size_t i = 0; i < numPoints; i++)
-        for (int k = 0; k < 3; k++)
-          _currentPointCloud[i][k] += _sliceOrigin[k];
-      _accumCloud.append(_currentPointCloud);
-    }
-  }
+  // NB: any buffered slice is dispatched once it is known whether the
+  //     following slice depends upon it.
+  if (!buf || payloadStartsNewSlice(buf->type))
+    accumulateSlice();
 
   if (!buf) {
     // flush decoder, output pending cloud if any
+    // NB: as with a frame boundary marker, the decoder may then be used to
+    //     decode further frames.
+    collectSlices();
     callback->onOutputCloud(*_sps, _accumCloud);
     _accumCloud.clear();
+    _currentFrameIdx = -1;
+    _attrDecoder.reset();
     return 0;
   }
 
@@ -128,7 +145,7 @@ PCCTMC3Decoder3::decompress(
     // HACK: assume that an SPS has been received prior to the GPS.
     // This is not required, and parsing of the GPS is independent of the SPS.
     // todo(df): move GPS fixup to activation process
-    _sps = &_spss.cbegin()->second;
+    _sps = _spss.cbegin()->second.get();
     convertXyzToStv(*_sps, &gps);
     storeGps(std::move(gps));
     return 0;
@@ -139,7 +156,7 @@ PCCTMC3Decoder3::decompress(
     // HACK: assume that an SPS has been received prior to the APS.
     // This is not required, and parsing of the APS is independent of the SPS.
     // todo(df): move APS fixup to activation process
-    _sps = &_spss.cbegin()->second;
+    _sps = _spss.cbegin()->second.get();
     convertXyzToStv(*_sps, &aps);
     storeAps(std::move(aps));
     return 0;
@@ -150,15 +167,18 @@ PCCTMC3Decoder3::decompress(
   //     on the next slice.
   case PayloadType::kFrameBoundaryMarker:
     // todo(df): if no sps is activated ...
+    collectSlices();
     callback->onOutputCloud(*_sps, _accumCloud);
     _accumCloud.clear();
     _currentFrameIdx = -1;
     _attrDecoder.reset();
     return 0;
 
-  case PayloadType::kGeometryBrick:
+  case PayloadType::kGeometryBrick: {
     activateParameterSets(parseGbhIds(*buf));
-    if (frameIdxChanged(parseGbh(*_sps, *_gps, *buf, nullptr))) {
+    auto gbh = parseGbh(*_sps, *_gps, *buf, nullptr);
+    if (frameIdxChanged(gbh)) {
+      collectSlices();
       callback->onOutputCloud(*_sps, _accumCloud);
       _accumCloud.clear();
       _firstSliceInFrame = true;
@@ -166,12 +186,39 @@ PCCTMC3Decoder3::decompress(
 
     // avoid accidents with stale attribute decoder on next slice
     _attrDecoder.reset();
-    return decodeGeometryBrick(*buf);
 
-  case PayloadType::kAttributeBrick: decodeAttributeBrick(*buf); return 0;
+    if (decodeSlicesConcurrently()) {
+      // A slice that does not continue the entropy state is independent
+      // of the preceding slices, and the buffered slice is independent of
+      // it.  Decoding is deferred until the rest of the slice is received.
+      if (!gbh.entropy_continuation_flag) {
+        dispatchSlice();
+        _currentFrameIdx = gbh.frame_idx;
+        _slicePayloads.push_back(*buf);
+        return 0;
+      }
+
+      // Otherwise, the buffered slice must be decoded first, by this
+      // decoder, since its final context state is continued
+      if (int ret = decodeBufferedSlice())
+        return ret;
+    }
+
+    return decodeSliceGeometry(*buf);
+  }
+
+  case PayloadType::kAttributeBrick:
+    if (!_slicePayloads.empty())
+      _slicePayloads.push_back(*buf);
+    else
+      _attrPayloads.push_back(*buf);
+    return 0;
 
   case PayloadType::kConstantAttribute:
-    decodeConstantAttribute(*buf);
+    if (!_slicePayloads.empty())
+      _slicePayloads.push_back(*buf);
+    else
+      _attrPayloads.push_back(*buf);
     return 0;
 
   case PayloadType::kTileInventory:
@@ -185,13 +232,300 @@ PCCTMC3Decoder3::decompress(
   return 1;
 }
 
+//--------------------------------------------------------------------------
+// Transfer the points of the current slice to the output accumulator
+
+void
+PCCTMC3Decoder3::accumulateSlice()
+{
+  if (decodeAttributesConcurrently()) {
+    dispatchAttributes();
+    return;
+  }
+
+  decodeAttributeBricks(_attrPayloads);
+  _attrPayloads.clear();
+
+  size_t numPoints = _currentPointCloud.getPointCount();
+  if (!numPoints)
+    return;
+
+  for (size_t i = 0; i < numPoints; i++)
+    for (int k = 0; k < 3; k++)
+      _currentPointCloud[i][k] += _sliceOrigin[k];
+  _accumCloud.append(_currentPointCloud);
+  _currentPointCloud.clear();
+}
+
+//--------------------------------------------------------------------------
+// Slices may only be decoded concurrently if they do not depend upon the
+// context state left by the preceding slices.  The state is reset at the
+// start of a slice that does not continue the entropy state of its
+// predecessor, but only when entropy continuation is enabled: otherwise,
+// the state is carried from one slice (and frame) to the next.
+
+bool
+PCCTMC3Decoder3::decodeSlicesConcurrently() const
+{
+  return _params.numThreads > 1 && _sps->entropy_continuation_enabled_flag;
+}
+
+//--------------------------------------------------------------------------
+// Decode the buffered slice, if any, using this decoder, so that a
+// following slice may continue its entropy state.
+
+int
+PCCTMC3Decoder3::decodeBufferedSlice()
+{
+  if (_slicePayloads.empty())
+    return 0;
+
+  std::vector<PayloadView> payloads;
+  payloads.swap(_slicePayloads);
+
+  // the concurrently decoded slices precede the buffered slice
+  collectSlices();
+
+  const auto& geomBuf = payloads.front();
+  activateParameterSets(parseGbhIds(geomBuf));
+  if (int ret = decodeSliceGeometry(geomBuf))
+    return ret;
+
+  _attrPayloads.assign(payloads.begin() + 1, payloads.end());
+  accumulateSlice();
+  return 0;
+}
+
+//--------------------------------------------------------------------------
+// Decode the geometry of a slice using this decoder.
+
+int
+PCCTMC3Decoder3::decodeSliceGeometry(const PayloadView& buf)
+{
+  // the slice's messages are output after its attributes are decoded
+  if (decodeAttributesConcurrently()) {
+    std::ostream* log = _log;
+    _sliceLog.reset(new std::ostringstream);
+    _log = _sliceLog.get();
+    int ret = decodeGeometryBrick(buf);
+    _log = log;
+    return ret;
+  }
+
+  return decodeGeometryBrick(buf);
+}
+
+//--------------------------------------------------------------------------
+// Decode the buffered slice using a separate decoder instance.
+
+void
+PCCTMC3Decoder3::dispatchSlice()
+{
+  if (_slicePayloads.empty())
+    return;
+
+  if (!_threadPool || _threadPool->numThreads() != _params.numThreads)
+    _threadPool.reset(new ThreadPool(_params.numThreads));
+
+  // The slice decoder shares the current parameter sets, but no other state.
+  DecoderParams sliceParams = _params;
+  sliceParams.numThreads = 1;
+
+  _sliceTasks.emplace_back();
+  auto& task = _sliceTasks.back();
+  task.decoder.reset(new PCCTMC3Decoder3(sliceParams, _lodCache));
+  task.log.reset(new std::ostringstream);
+
+  auto& decoder = *task.decoder;
+  shareParameterSets(&decoder);
+  decoder._lodThreadPool = _threadPool.get();
+  decoder._log = task.log.get();
+
+  auto payloads = std::make_shared<std::vector<PayloadView>>();
+  payloads->swap(_slicePayloads);
+
+  task.done = _threadPool->submit([&decoder, payloads]() {
+    for (const auto& buf : *payloads)
+      decoder.decompress(&buf, nullptr);
+    decoder.accumulateSlice();
+  });
+}
+
+//--------------------------------------------------------------------------
+// Wait for each concurrently decoded slice and accumulate the output in
+// bitstream order.
+
+void
+PCCTMC3Decoder3::collectSlices()
+{
+  dispatchSlice();
+  collectAttributes();
+
+  try {
+    for (auto& task : _sliceTasks) {
+      task.done.get();
+      *_log << task.log->str();
+      _accumCloud.append(task.decoder->_accumCloud);
+    }
+  }
+  catch (...) {
+    // NB: the thread pool must not reference any destroyed decoder
+    for (auto& task : _sliceTasks)
+      if (task.done.valid())
+        task.done.wait();
+    _sliceTasks.clear();
+    throw;
+  }
+
+  _sliceTasks.clear();
+}
+
+//--------------------------------------------------------------------------
+// Slices with entropy continuation must be decoded in order.  However, the
+// geometry of one slice does not depend upon the attributes of preceding
+// slices, permitting attribute and geometry decoding to overlap.
+
+bool
+PCCTMC3Decoder3::decodeAttributesConcurrently() const
+{
+  return _params.numThreads > 1 && _sps
+    && _sps->entropy_continuation_enabled_flag;
+}
+
+//--------------------------------------------------------------------------
+// Transfer the decoded geometry and buffered attribute data units of the
+// current slice to the attribute stage decoder, and decode the attributes
+// while the next slice's geometry is decoded.
+
+void
+PCCTMC3Decoder3::dispatchAttributes()
+{
+  // The attribute stage decodes a single slice at a time
+  collectAttributes();
+
+  if (!_currentPointCloud.getPointCount()) {
+    _attrPayloads.clear();
+    if (_sliceLog)
+      *_log << _sliceLog->str();
+    _sliceLog.reset();
+    return;
+  }
+
+  if (!_threadPool || _threadPool->numThreads() != _params.numThreads)
+    _threadPool.reset(new ThreadPool(_params.numThreads));
+
+  if (!_attrStage)
+    _attrStage.reset(new PCCTMC3Decoder3(_params, _lodCache));
+
+  // The attribute stage receives the state of the current slice
+  auto& stage = *_attrStage;
+  shareParameterSets(&stage);
+  stage._params = _params;
+  stage._params.numThreads = 1;
+  stage._lodThreadPool = _threadPool.get();
+  stage._gbh = _gbh;
+  stage._sliceId = _sliceId;
+  stage._sliceOrigin = _sliceOrigin;
+  stage._currentPointCloud.swap(_currentPointCloud);
+  stage._attrDecoder.reset();
+
+  // forget (reset) all saved attribute context state at a boundary
+  if (!_gbh.entropy_continuation_flag)
+    for (auto& ctxtMem : stage._ctxtMemAttrs)
+      ctxtMem.reset();
+
+  // NB: the slice log already contains the geometry messages
+  _attrStageLog = std::move(_sliceLog);
+  if (!_attrStageLog)
+    _attrStageLog.reset(new std::ostringstream);
+  stage._log = _attrStageLog.get();
+
+  auto payloads = std::make_shared<std::vector<PayloadView>>();
+  payloads->swap(_attrPayloads);
+
+  _attrStageDone = _threadPool->submit([&stage, payloads]() {
+    stage.decodeAttributeBricks(*payloads);
+    stage.accumulateSlice();
+  });
+}
+
+//--------------------------------------------------------------------------
+// Wait for the attribute stage to complete and accumulate its output.
+
+void
+PCCTMC3Decoder3::collectAttributes()
+{
+  if (!_attrStageDone.valid())
+    return;
+
+  _attrStageDone.get();
+  *_log << _attrStageLog->str();
+  _attrStageLog.reset();
+
+  _accumCloud.append(_attrStage->_accumCloud);
+  _attrStage->_accumCloud.clear();
+}
+
+//--------------------------------------------------------------------------
+
+std::unique_ptr<PCCTMC3Decoder3>
+PCCTMC3Decoder3::cloneForFrame() const
+{
+  std::unique_ptr<PCCTMC3Decoder3> decoder(
+    new PCCTMC3Decoder3(_params, _lodCache));
+  shareParameterSets(decoder.get());
+  decoder->_log = _log;
+  return decoder;
+}
+
+//--------------------------------------------------------------------------
+
+int
+PCCTMC3Decoder3::peekFrameIdx(const PayloadView& buf)
+{
+  assert(buf.type == PayloadType::kGeometryBrick);
+  activateParameterSets(parseGbhIds(buf));
+  return parseGbh(*_sps, *_gps, buf, nullptr).frame_idx;
+}
+
+//--------------------------------------------------------------------------
+// Without entropy continuation, the saved context state is carried from
+// one frame to the next.
+
+bool
+PCCTMC3Decoder3::isIndependentFrame(const PayloadView& buf)
+{
+  assert(buf.type == PayloadType::kGeometryBrick);
+  activateParameterSets(parseGbhIds(buf));
+  return _sps->entropy_continuation_enabled_flag
+    && !parseGbh(*_sps, *_gps, buf, nullptr).entropy_continuation_flag;
+}
+
+//--------------------------------------------------------------------------
+// Parameter sets are immutable once stored and are shared, rather than
+// copied, with other decoder instances.
+
+void
+PCCTMC3Decoder3::shareParameterSets(PCCTMC3Decoder3* decoder) const
+{
+  decoder->_spss = _spss;
+  decoder->_gpss = _gpss;
+  decoder->_apss = _apss;
+  decoder->_tileInventory = _tileInventory;
+
+  // A frame without any slices is output using the active sps
+  decoder->_sps = _sps;
+  decoder->_gps = _gps;
+}
+
 //--------------------------------------------------------------------------
 
 void
 PCCTMC3Decoder3::storeSps(SequenceParameterSet&& sps)
 {
   // todo(df): handle replacement semantics
-  _spss.emplace(std::make_pair(sps.sps_seq_parameter_set_id, sps));
+  auto id = sps.sps_seq_parameter_set_id;
+  _spss.emplace(id, std::make_shared<SequenceParameterSet>(std::move(sps)));
 }
 
 //--------------------------------------------------------------------------
@@ -200,7 +534,8 @@ void
 PCCTMC3Decoder3::storeGps(GeometryParameterSet&& gps)
 {
   // todo(df): handle replacement semantics
-  _gpss.emplace(std::make_pair(gps.gps_geom_parameter_set_id, gps));
+  auto id = gps.gps_geom_parameter_set_id;
+  _gpss.emplace(id, std::make_shared<GeometryParameterSet>(std::move(gps)));
 }
 
 //--------------------------------------------------------------------------
@@ -209,7 +544,8 @@ void
 PCCTMC3Decoder3::storeAps(AttributeParameterSet&& aps)
 {
   // todo(df): handle replacement semantics
-  _apss.emplace(std::make_pair(aps.aps_attr_parameter_set_id, aps));
+  auto id = aps.aps_attr_parameter_set_id;
+  _apss.emplace(id, std::make_shared<AttributeParameterSet>(std::move(aps)));
 }
 
 //--------------------------------------------------------------------------
@@ -218,7 +554,7 @@ void
 PCCTMC3Decoder3::storeTileInventory(TileInventory&& inventory)
 {
   // todo(df): handle replacement semantics
-  _tileInventory = inventory;
+  _tileInventory = std::make_shared<TileInventory>(std::move(inventory));
 }
 
 //==========================================================================
@@ -242,18 +578,18 @@ PCCTMC3Decoder3::activateParameterSets(const GeometryBrickHeader& gbh)
   //  -- this is currently inconsistent between trisoup and octree
   assert(!_spss.empty());
   assert(!_gpss.empty());
-  _sps = &_spss.cbegin()->second;
-  _gps = &_gpss.cbegin()->second;
+  _sps = _spss.cbegin()->second.get();
+  _gps = _gpss.cbegin()->second.get();
 }
 
 //==========================================================================
 // Initialise the point cloud storage and decode a single geometry slice.
 
 int
-PCCTMC3Decoder3::decodeGeometryBrick(const PayloadBuffer& buf)
+PCCTMC3Decoder3::decodeGeometryBrick(const PayloadView& buf)
 {
   assert(buf.type == PayloadType::kGeometryBrick);
-  std::cout << "positions bitstream size " << buf.size() << " B\n";
+  *_log << "positions bitstream size " << buf.size() << " B\n";
 
   // todo(df): replace with attribute mapping
   bool hasColour = std::any_of(
@@ -364,6 +700,11 @@ PCCTMC3Decoder3::decodeGeometryBrick(const PayloadBuffer& buf)
     }
   }
 
+  // The geometry sub-streams are decoded concurrently using the worker
+  // threads, unless this decoder is itself running on a worker thread.
+  ThreadPool* threadPool =
+    _params.numThreads > 1 ? _threadPool.get() : nullptr;
+
   if (_gps->predgeom_enabled_flag)
     decodePredictiveGeometry(
       *_gps, _gbh, _currentPointCloud, *_ctxtMemPredGeom,
@@ -372,16 +713,16 @@ PCCTMC3Decoder3::decodeGeometryBrick(const PayloadBuffer& buf)
     if (!_params.minGeomNodeSizeLog2) {
       decodeGeometryOctree(
         *_gps, _gbh, _currentPointCloud, *_ctxtMemOctreeGeom,
-        arithmeticDecoders);
+        arithmeticDecoders, threadPool);
     } else {
       decodeGeometryOctreeScalable(
         *_gps, _gbh, _params.minGeomNodeSizeLog2, _currentPointCloud,
-        *_ctxtMemOctreeGeom, arithmeticDecoders);
+        *_ctxtMemOctreeGeom, arithmeticDecoders, threadPool);
     }
   } else {
     decodeGeometryTrisoup(
       *_gps, _gbh, _currentPointCloud, *_ctxtMemOctreeGeom,
-      arithmeticDecoders);
+      arithmeticDecoders, threadPool);
   }
 
   // At least the first slice's geometry has been decoded
@@ -391,56 +732,156 @@ PCCTMC3Decoder3::decodeGeometryBrick(const PayloadBuffer& buf)
 
   auto total_user =
     std::chrono::duration_cast<std::chrono::milliseconds>(clock_user.count());
-  std::cout << "positions processing time (user): "
-            << total_user.count() / 1000.0 << " s\n";
-  std::cout << std::endl;
+  *_log << "positions processing time (user): "
+        << total_user.count() / 1000.0 << " s\n";
+  *_log << std::endl;
 
   return 0;
 }
 
 //--------------------------------------------------------------------------
+// Decode the attribute data units of the current slice, in order.
+// Consecutive attribute bricks are decoded in a single pass over their
+// shared LoDs where possible.
 
 void
-PCCTMC3Decoder3::decodeAttributeBrick(const PayloadBuffer& buf)
+PCCTMC3Decoder3::decodeAttributeBricks(const std::vector<PayloadView>& bufs)
+{
+  auto isAttributeBrick = [](const PayloadView& buf) {
+    return buf.type == PayloadType::kAttributeBrick;
+  };
+
+  auto it = bufs.begin();
+  while (it != bufs.end()) {
+    if (!isAttributeBrick(*it)) {
+      decodeConstantAttribute(*it++);
+      continue;
+    }
+
+    auto end = std::find_if_not(it, bufs.end(), isAttributeBrick);
+    if (end - it > 1 && decodeAttributeBricksFused(&*it, end - it)) {
+      it = end;
+      continue;
+    }
+
+    for (; it != end; ++it)
+      decodeAttributeBrick(*it);
+  }
+}
+
+//--------------------------------------------------------------------------
+// Decode count attribute bricks in a single pass.  Returns false, having
+// decoded nothing, if the attributes cannot be decoded together.
+
+bool
+PCCTMC3Decoder3::decodeAttributeBricksFused(
+  const PayloadView* bufs, size_t count)
+{
+  std::vector<AttributeBrickHeader> abhs(count);
+  std::vector<AttributeBrickDecoding> attrs;
+  attrs.reserve(count);
+
+  for (size_t i = 0; i < count; i++) {
+    attrs.push_back(parseAttributeBrick(bufs[i], &abhs[i]));
+    if (!fusedCodingSupported(*attrs.back().aps))
+      return false;
+  }
+
+  pcc::chrono::Stopwatch<pcc::chrono::utime_inc_children_clock> clock_user;
+
+  // replace the attribute decoder if not compatible
+  if (!_attrDecoder || !_attrDecoder->isReusable(*attrs[0].aps, abhs[0]))
+    _attrDecoder = makeAttributeDecoder(_lodThreadPool, _lodCache.get());
+
+  clock_user.start();
+
+  if (!_attrDecoder->decodeFused(
+        *_sps, attrs, _gbh.footer.geom_num_points_minus1,
+        _params.minGeomNodeSizeLog2, _currentPointCloud))
+    return false;
+
+  clock_user.stop();
+
+  std::ostringstream labels;
+  for (size_t i = 0; i < count; i++) {
+    // Note the current sliceID for loss detection
+    _ctxtMemAttrSliceIds[abhs[i].attr_sps_attr_idx] = _sliceId;
+
+    const auto& label = attrs[i].desc->attributeLabel;
+    labels << (i ? "s+" : "") << label;
+    *_log << label << "s bitstream size " << bufs[i].size() << " B\n";
+  }
+
+  auto total_user =
+    std::chrono::duration_cast<std::chrono::milliseconds>(clock_user.count());
+  *_log << labels.str() << "s processing time (user): "
+        << total_user.count() / 1000.0 << " s\n";
+  *_log << std::endl;
+
+  return true;
+}
+
+//--------------------------------------------------------------------------
+// Parse the header of an attribute brick of the current slice into abh, and
+// identify the parameters and context state used to decode it.
+
+AttributeBrickDecoding
+PCCTMC3Decoder3::parseAttributeBrick(
+  const PayloadView& buf, AttributeBrickHeader* abh)
 {
   assert(buf.type == PayloadType::kAttributeBrick);
   // todo(df): replace assertions with error handling
   assert(_sps);
   assert(_gps);
 
+  // Ensure that the context arrays are allocated
+  // todo(df): move this to sps activation
+  _ctxtMemAttrSliceIds.resize(_sps->attributeSets.size());
+  _ctxtMemAttrs.resize(_sps->attributeSets.size());
+
   // verify that this corresponds to the correct geometry slice
-  AttributeBrickHeader abh = parseAbhIds(buf);
-  assert(abh.attr_geom_slice_id == _sliceId);
+  *abh = parseAbhIds(buf);
+  assert(abh->attr_geom_slice_id == _sliceId);
 
   // todo(df): validate that sps activation is not changed via the APS
-  const auto it_attr_aps = _apss.find(abh.attr_attr_parameter_set_id);
+  const auto it_attr_aps = _apss.find(abh->attr_attr_parameter_set_id);
 
   assert(it_attr_aps != _apss.cend());
-  const auto& attr_aps = it_attr_aps->second;
+  const auto& attr_aps = *it_attr_aps->second;
 
-  assert(abh.attr_sps_attr_idx < _sps->attributeSets.size());
-  const auto& attr_sps = _sps->attributeSets[abh.attr_sps_attr_idx];
-  const auto& label = attr_sps.attributeLabel;
+  assert(abh->attr_sps_attr_idx < _sps->attributeSets.size());
+  const auto& attr_sps = _sps->attributeSets[abh->attr_sps_attr_idx];
+  auto& ctxtMemAttr = _ctxtMemAttrs.at(abh->attr_sps_attr_idx);
 
   // sanity check for loss detection
   if (_gbh.entropy_continuation_flag)
-    assert(_gbh.prev_slice_id == _ctxtMemAttrSliceIds[abh.attr_sps_attr_idx]);
-
-  // Ensure context arrays are allocated context arrays
-  // todo(df): move this to sps activation
-  _ctxtMemAttrSliceIds.resize(_sps->attributeSets.size());
-  _ctxtMemAttrs.resize(_sps->attributeSets.size());
+    assert(
+      _gbh.prev_slice_id == _ctxtMemAttrSliceIds[abh->attr_sps_attr_idx]);
 
-  // In order to determinet hat the attribute decoder is reusable, the abh
+  // In order to determine that the attribute decoder is reusable, the abh
   // must be inspected.
   int abhSize;
-  abh = parseAbh(*_sps, attr_aps, buf, &abhSize);
+  *abh = parseAbh(*_sps, attr_aps, buf, &abhSize);
+
+  return {&attr_sps, &attr_aps, abh, buf.data() + abhSize,
+          buf.size() - abhSize, &ctxtMemAttr};
+}
+
+//--------------------------------------------------------------------------
+
+void
+PCCTMC3Decoder3::decodeAttributeBrick(const PayloadView& buf)
+{
+  AttributeBrickHeader abh;
+  auto attr = parseAttributeBrick(buf, &abh);
+  const auto& attr_aps = *attr.aps;
+  const auto& label = attr.desc->attributeLabel;
 
   pcc::chrono::Stopwatch<pcc::chrono::utime_inc_children_clock> clock_user;
 
   // replace the attribute decoder if not compatible
   if (!_attrDecoder || !_attrDecoder->isReusable(attr_aps, abh))
-    _attrDecoder = makeAttributeDecoder();
+    _attrDecoder = makeAttributeDecoder(_lodThreadPool, _lodCache.get());
 
   clock_user.start();
 
@@ -466,11 +907,10 @@ PCCTMC3Decoder3::decodeAttributeBrick(const PayloadBuffer& buf)
     _currentPointCloud.swapPoints(altPositions);
   }
 
-  auto& ctxtMemAttr = _ctxtMemAttrs.at(abh.attr_sps_attr_idx);
   _attrDecoder->decode(
-    *_sps, attr_sps, attr_aps, abh, _gbh.footer.geom_num_points_minus1,
-    _params.minGeomNodeSizeLog2, buf.data() + abhSize, buf.size() - abhSize,
-    ctxtMemAttr, _currentPointCloud);
+    *_sps, *attr.desc, attr_aps, abh, _gbh.footer.geom_num_points_minus1,
+    _params.minGeomNodeSizeLog2, attr.payload, attr.payloadLen, *attr.ctxtMem,
+    _currentPointCloud);
 
   if (attr_aps.spherical_coord_flag)
     _currentPointCloud.swapPoints(altPositions);
@@ -480,20 +920,19 @@ PCCTMC3Decoder3::decodeAttributeBrick(const PayloadBuffer& buf)
 
   clock_user.stop();
 
-  std::cout << label << "s bitstream size " << buf.size() << " B\n";
+  *_log << label << "s bitstream size " << buf.size() << " B\n";
 
   auto total_user =
     std::chrono::duration_cast<std::chrono::milliseconds>(clock_user.count());
-  std::cout << label
-            << "s processing time (user): " << total_user.count() / 1000.0
-            << " s\n";
-  std::cout << std::endl;
+  *_log << label << "s processing time (user): "
+        << total_user.count() / 1000.0 << " s\n";
+  *_log << std::endl;
 }
 
 //--------------------------------------------------------------------------
 
 void
-PCCTMC3Decoder3::decodeConstantAttribute(const PayloadBuffer& buf)
+PCCTMC3Decoder3::decodeConstantAttribute(const PayloadView& buf)
 {
   assert(buf.type == PayloadType::kConstantAttribute);
   // todo(df): replace assertions with error handling
@@ -36,7 +36,11 @@
 #include "PCCTMC3Encoder.h"
 
 #include <cassert>
+#include <future>
+#include <iostream>
+#include <numeric>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 
 #include "Attribute.h"
@@ -64,11 +68,15 @@ getPartition(const PCCPointSet3& src, const std::vector<int32_t>& indexes);
 PCCPointSet3 getPartition(
   const PCCPointSet3& src,
   const SrcMappedPointSet& map,
-  const std::vector<int32_t>& indexes);
+  int pointBegin,
+  int pointEnd);
+
+void sortPointsByPartition(
+  SrcMappedPointSet* points, std::vector<Partition>* partitions);
 
 //============================================================================
 
-PCCTMC3Encoder3::PCCTMC3Encoder3() : _frameCounter(-1)
+PCCTMC3Encoder3::PCCTMC3Encoder3() : _frameCounter(-1), _log(&std::cout)
 {
   _ctxtMemOctreeGeom.reset(new GeometryOctreeContexts);
   _ctxtMemPredGeom.reset(new PredGeomContexts);
@@ -80,6 +88,23 @@ PCCTMC3Encoder3::~PCCTMC3Encoder3() = default;
 
 //============================================================================
 
+std::unique_ptr<PCCTMC3Encoder3>
+PCCTMC3Encoder3::cloneForFrame(int frameCounter) const
+{
+  // NB: the first frame establishes the sequence parameters
+  assert(_frameCounter >= 0);
+
+  std::unique_ptr<PCCTMC3Encoder3> encoder(new PCCTMC3Encoder3);
+  encoder->_frameCounter = frameCounter - 1;
+  encoder->_geomPreScale = _geomPreScale;
+  encoder->_ctxtMemAttrs.resize(_ctxtMemAttrs.size());
+  encoder->_lodCache = _lodCache;
+  encoder->_log = _log;
+  return encoder;
+}
+
+//============================================================================
+
 int
 PCCTMC3Encoder3::compress(
   const PCCPointSet3& inputPointCloud,
@@ -161,7 +186,8 @@ PCCTMC3Encoder3::compress(
   //    slice partitioning subsequent
   //  todo(df):
   PartitionSet partitions;
-  SrcMappedPointSet quantizedInput = quantization(inputPointCloud);
+  SrcMappedPointSet quantizedInput =
+    quantization(inputPointCloud, getThreadPool(params->numThreads));
 
   // write out all parameter sets prior to encoding
   callback->onOutputBuffer(write(*_sps));
@@ -203,7 +229,7 @@ PCCTMC3Encoder3::compress(
   if (partitions.tileInventory.tiles.size() > 1) {
     auto& inventory = partitions.tileInventory;
     assert(inventory.tiles.size() == tileMaps.size());
-    std::cout << "Tile number: " << tileMaps.size() << std::endl;
+    *_log << "Tile number: " << tileMaps.size() << std::endl;
     inventory.ti_seq_parameter_set_id = _sps->sps_seq_parameter_set_id;
     inventory.ti_origin_bits_minus1 =
       numBits(inventory.origin.abs().max()) - 1;
@@ -226,10 +252,9 @@ PCCTMC3Encoder3::compress(
   //  - partitioning function produces a list of point indexes, origin and
   //    optional tile metadata for each partition.
   //  - encode any tile metadata
+  //  - reorder the points such that each slice is contiguous
   //  NB: the partitioning method is required to ensure that the output
   //      slices conform to any codec limits.
-  //  todo(df): consider requiring partitioning function to sort the input
-  //            points and provide ranges rather than a set of indicies.
   do {
     for (int t = 0; t < tileMaps.size(); t++) {
       const auto& tile = tileMaps[t];
@@ -295,30 +320,166 @@ PCCTMC3Encoder3::compress(
       partitions.slices.insert(
         partitions.slices.end(), curSlices.begin(), curSlices.end());
     }
-    std::cout << "Slice number: " << partitions.slices.size() << std::endl;
+    *_log << "Slice number: " << partitions.slices.size() << std::endl;
+
+    sortPointsByPartition(&quantizedInput, &partitions.slices);
   } while (0);
 
+  // Slices may only be encoded concurrently if each is independent of the
+  // preceding slices.  Without entropy continuation, the saved context state
+  // is carried from one slice (and frame) to the next; with it, the state is
+  // reset in each slice that does not continue its predecessor.
+  bool concurrentSlices = params->numThreads > 1
+    && partitions.slices.size() > 1
+    && _sps->entropy_continuation_enabled_flag && params->independentSlices;
+
+  if (concurrentSlices) {
+    compressSlicesConcurrently(
+      inputPointCloud, quantizedInput, partitions.slices, params, callback,
+      reconstructedCloud);
+    return 0;
+  }
+
   // Encode each partition:
-  //  - create a pointset comprising just the partitioned points
+  //  - create a pointset comprising the source points of the partition
   //  - compress
   for (const auto& partition : partitions.slices) {
-    // create partitioned point set
-    PCCPointSet3 sliceCloud =
-      getPartition(quantizedInput.cloud, partition.pointIndexes);
-
-    PCCPointSet3 sliceSrcCloud =
-      getPartition(inputPointCloud, quantizedInput, partition.pointIndexes);
+    PCCPointSet3 sliceSrcCloud = getPartition(
+      inputPointCloud, quantizedInput, partition.pointBegin,
+      partition.pointEnd);
 
     _sliceId = partition.sliceId;
     _tileId = partition.tileId;
-    _sliceOrigin = sliceCloud.computeBoundingBox().min;
     compressPartition(
-      sliceCloud, sliceSrcCloud, params, callback, reconstructedCloud);
+      quantizedInput.cloud, partition.pointBegin, partition.pointEnd,
+      sliceSrcCloud, params, callback, reconstructedCloud);
   }
 
   return 0;
 }
 
+//----------------------------------------------------------------------------
+// Captures the output of a slice encoder for later forwarding in slice order.
+
+namespace {
+  struct SliceEncoderOutput : public PCCTMC3Encoder3::Callbacks {
+    std::vector<PayloadBuffer> payloads;
+
+    // The recoloured slice and its position relative to payloads
+    PCCPointSet3 postRecolourCloud;
+    int postRecolourIdx = -1;
+
+    PCCPointSet3 reconstructedCloud;
+    std::ostringstream log;
+
+    void onOutputBuffer(const PayloadBuffer& buf) override
+    {
+      payloads.push_back(buf);
+    }
+
+    void onPostRecolour(const PCCPointSet3& cloud) override
+    {
+      postRecolourCloud = cloud;
+      postRecolourIdx = int(payloads.size());
+    }
+
+    void replay(PCCTMC3Encoder3::Callbacks* callback)
+    {
+      for (int i = 0; i <= int(payloads.size()); i++) {
+        if (i == postRecolourIdx)
+          callback->onPostRecolour(postRecolourCloud);
+        if (i < int(payloads.size()))
+          callback->onOutputBuffer(payloads[i]);
+      }
+    }
+  };
+}  // namespace
+
+//----------------------------------------------------------------------------
+// Encode each slice with a separate encoder instance using the thread pool.
+// The output is forwarded in slice order so that the bitstream is identical
+// to that produced by encoding each slice serially.
+//
+// NB: this requires that no state is propagated between slices: each slice
+//     must reset the saved context state.
+
+void
+PCCTMC3Encoder3::compressSlicesConcurrently(
+  const PCCPointSet3& inputPointCloud,
+  const SrcMappedPointSet& quantizedInput,
+  const std::vector<Partition>& slices,
+  EncoderParams* params,
+  PCCTMC3Encoder3::Callbacks* callback,
+  PCCPointSet3* reconstructedCloud)
+{
+  ThreadPool* threadPool = getThreadPool(params->numThreads);
+
+  // NB: the LoD cache must exist before it is shared with slice encoders
+  getLodCache(params->lodCacheSize);
+
+  std::vector<std::future<std::unique_ptr<SliceEncoderOutput>>> results;
+  for (int i = 0; i < slices.size(); i++) {
+    results.push_back(threadPool->submit([&, i]() {
+      const auto& partition = slices[i];
+      std::unique_ptr<SliceEncoderOutput> output(new SliceEncoderOutput);
+
+      // The slice encoder shares only the active parameter sets
+      PCCTMC3Encoder3 sliceEncoder;
+      sliceEncoder._log = &output->log;
+      sliceEncoder._geomPreScale = _geomPreScale;
+      sliceEncoder._sps = _sps;
+      sliceEncoder._gps = _gps;
+      sliceEncoder._aps = _aps;
+      sliceEncoder._frameCounter = _frameCounter;
+      sliceEncoder._ctxtMemAttrs.resize(_ctxtMemAttrs.size());
+      sliceEncoder._lodCache = _lodCache;
+      sliceEncoder._firstSliceInFrame = i == 0;
+      sliceEncoder._prevSliceId = i ? slices[i - 1].sliceId : _prevSliceId;
+
+      // NB: the encoder modifies the per-slice parameters
+      EncoderParams sliceParams(*params);
+
+      // The workers are already occupied by slices: code attributes serially
+      sliceParams.numThreads = 1;
+
+      PCCPointSet3 sliceSrcCloud = getPartition(
+        inputPointCloud, quantizedInput, partition.pointBegin,
+        partition.pointEnd);
+
+      sliceEncoder._sliceId = partition.sliceId;
+      sliceEncoder._tileId = partition.tileId;
+      sliceEncoder.compressPartition(
+        quantizedInput.cloud, partition.pointBegin, partition.pointEnd,
+        sliceSrcCloud, &sliceParams, output.get(),
+        reconstructedCloud ? &output->reconstructedCloud : nullptr);
+
+      return output;
+    }));
+  }
+
+  try {
+    for (auto& result : results) {
+      auto output = result.get();
+      *_log << output->log.str();
+      output->replay(callback);
+
+      if (reconstructedCloud)
+        reconstructedCloud->append(output->reconstructedCloud);
+    }
+  }
+  catch (...) {
+    // the remaining slices reference local state: wait before unwinding
+    for (auto& result : results)
+      if (result.valid())
+        result.wait();
+    throw;
+  }
+
+  _prevSliceId = slices.back().sliceId;
+  _sliceId = _prevSliceId + 1;
+  _firstSliceInFrame = false;
+}
+
 //----------------------------------------------------------------------------
 
 void
@@ -413,7 +574,9 @@ PCCTMC3Encoder3::fixupParameterSets(EncoderParams* params)
 
 void
 PCCTMC3Encoder3::compressPartition(
-  const PCCPointSet3& inputPointCloud,
+  const PCCPointSet3& cloud,
+  int pointBegin,
+  int pointEnd,
   const PCCPointSet3& originPartCloud,
   EncoderParams* params,
   PCCTMC3Encoder3::Callbacks* callback,
@@ -424,8 +587,10 @@ PCCTMC3Encoder3::compressPartition(
   //  - encode geometry (single slice, id = 0)
   //  - recolour
 
+  const int numInputPoints = pointEnd - pointBegin;
   pointCloud.clear();
-  pointCloud = inputPointCloud;
+  pointCloud.assign(cloud, pointBegin, pointEnd);
+  _sliceOrigin = pointCloud.computeBoundingBox().min;
 
   // Offset the point cloud to account for (preset) _sliceOrigin.
   // The new maximum bounds of the offset cloud
@@ -464,14 +629,14 @@ PCCTMC3Encoder3::compressPartition(
 
     clock_user.stop();
 
-    double bpp = double(8 * payload.size()) / inputPointCloud.getPointCount();
-    std::cout << "positions bitstream size " << payload.size() << " B (" << bpp
-              << " bpp)\n";
+    double bpp = double(8 * payload.size()) / numInputPoints;
+    *_log << "positions bitstream size " << payload.size() << " B (" << bpp
+          << " bpp)\n";
 
     auto total_user = std::chrono::duration_cast<std::chrono::milliseconds>(
       clock_user.count());
-    std::cout << "positions processing time (user): "
-              << total_user.count() / 1000.0 << " s" << std::endl;
+    *_log << "positions processing time (user): "
+          << total_user.count() / 1000.0 << " s" << std::endl;
 
     callback->onOutputBuffer(payload);
   }
@@ -487,10 +652,18 @@ PCCTMC3Encoder3::compressPartition(
   // recolouring
   // NB: recolouring is required if points are added / removed
   if (_gps->geom_unique_points_flag || _gps->trisoup_enabled_flag) {
+    // NB: slices coded by a worker are recoloured using a single thread
+    ThreadPool* threadPool = getThreadPool(params->numThreads);
+
+    // NB: the neighbourhoods are shared by each attribute
+    RecolourContext recolourCtxt(
+      params->recolour, originPartCloud, params->geomPreScale,
+      _sps->seqBoundingBoxOrigin + _sliceOrigin, pointCloud, threadPool);
+
     for (const auto& attr_sps : _sps->attributeSets) {
       recolour(
-        attr_sps, params->recolour, originPartCloud, params->geomPreScale,
-        _sps->seqBoundingBoxOrigin + _sliceOrigin, &pointCloud);
+        attr_sps, params->recolour, recolourCtxt, originPartCloud,
+        &pointCloud, threadPool);
     }
   }
 
@@ -499,110 +672,321 @@ PCCTMC3Encoder3::compressPartition(
   callback->onPostRecolour(pointCloud);
 
   // attributeCoding
-  auto attrEncoder = makeAttributeEncoder();
+  if (params->numThreads > 1 && params->attributeIdxMap.size() > 1) {
+    compressAttributesConcurrently(params, numInputPoints, callback);
+  } else {
+    auto attrEncoder = makeAttributeEncoder(
+      getThreadPool(params->numThreads), getLodCache(params->lodCacheSize));
+
+    // attributes are coded in a single pass over their LoDs where possible
+    bool fused = params->attributeIdxMap.size() > 1
+      && encodeAttributeBricksFused(
+           params, numInputPoints, &attrEncoder, callback);
+
+    // otherwise, for each attribute
+    if (!fused) {
+      for (const auto& it : params->attributeIdxMap) {
+        PayloadBuffer payload(PayloadType::kAttributeBrick);
+        encodeAttributeBrick(
+          params, it.second, numInputPoints, &attrEncoder, &payload, _log);
+        callback->onOutputBuffer(payload);
+      }
+    }
+  }
+
+  // Note the current slice id for loss detection with entropy continuation
+  _prevSliceId = _sliceId;
+
+  // prevent re-use of this sliceId:  the next slice (geometry + attributes)
+  // should be distinguishable from the current slice.
+  _sliceId++;
+  _firstSliceInFrame = false;
+
+  appendReconstructedPoints(reconstructedCloud);
+}
+
+//----------------------------------------------------------------------------
+// Encode each attribute of the current slice using the thread pool.
+// The attribute brick payloads are forwarded in attribute order.
+
+namespace {
+  struct AttributeBrickOutput {
+    PayloadBuffer payload{PayloadType::kAttributeBrick};
+    std::ostringstream log;
+  };
+}  // namespace
+
+void
+PCCTMC3Encoder3::compressAttributesConcurrently(
+  const EncoderParams* params,
+  int numInputPoints,
+  PCCTMC3Encoder3::Callbacks* callback)
+{
+  ThreadPool* threadPool = getThreadPool(params->numThreads);
+  AttributeLodCache* lodCache = getLodCache(params->lodCacheSize);
 
-  // for each attribute
+  std::vector<std::future<std::unique_ptr<AttributeBrickOutput>>> results;
   for (const auto& it : params->attributeIdxMap) {
     int attrIdx = it.second;
-    const auto& attr_sps = _sps->attributeSets[attrIdx];
-    const auto& attr_aps = *_aps[attrIdx];
-    const auto& attr_enc = params->attr[attrIdx];
-    const auto& label = attr_sps.attributeLabel;
+    results.push_back(threadPool->submit([=]() {
+      std::unique_ptr<AttributeBrickOutput> output(new AttributeBrickOutput);
 
-    PayloadBuffer payload(PayloadType::kAttributeBrick);
+      // NB: an attribute encoder may not be shared between attributes
+      auto attrEncoder = makeAttributeEncoder(threadPool, lodCache);
+      encodeAttributeBrick(
+        params, attrIdx, numInputPoints, &attrEncoder, &output->payload,
+        &output->log);
 
-    pcc::chrono::Stopwatch<pcc::chrono::utime_inc_children_clock> clock_user;
-    clock_user.start();
+      return output;
+    }));
+  }
 
-    // todo(df): move elsewhere?
-    AttributeBrickHeader abh;
-    abh.attr_attr_parameter_set_id = attr_aps.aps_attr_parameter_set_id;
-    abh.attr_sps_attr_idx = attrIdx;
-    abh.attr_geom_slice_id = _sliceId;
-    abh.attr_qp_delta_luma = 0;
-    abh.attr_qp_delta_chroma = 0;
-    abh.attr_layer_qp_delta_luma = attr_enc.abh.attr_layer_qp_delta_luma;
-    abh.attr_layer_qp_delta_chroma = attr_enc.abh.attr_layer_qp_delta_chroma;
-
-    // NB: regionQpOrigin/regionQpSize use the STV axes, not XYZ.
-    if (false) {
-      abh.qpRegions.emplace_back();
-      auto& region = abh.qpRegions.back();
-      region.regionOrigin = 0;
-      region.regionSize = 0;
-      region.attr_region_qp_offset = {0, 0};
-      abh.attr_region_bits_minus1 = -1
-        + numBits(
-            std::max(region.regionOrigin.max(), region.regionSize.max()));
-    }
-    // Number of regions is constrained to at most 1.
-    assert(abh.qpRegions.size() <= 1);
-
-    // Convert cartesian positions to spherical for use in attribute coding.
-    // NB: this retains the original cartesian positions to restore afterwards
-    std::vector<pcc::point_t> altPositions;
-    if (attr_aps.spherical_coord_flag) {
-      altPositions.resize(pointCloud.getPointCount());
-
-      auto laserOrigin = _gps->geomAngularOrigin - _sliceOrigin;
-      auto bboxRpl = convertXyzToRpl(
-        laserOrigin, _gps->geom_angular_theta_laser.data(),
-        _gps->geom_angular_theta_laser.size(), &pointCloud[0],
-        &pointCloud[0] + pointCloud.getPointCount(), altPositions.data());
-
-      abh.attr_coord_conv_scale = normalisedAxesWeights(bboxRpl);
-      offsetAndScale(
-        bboxRpl.min, abh.attr_coord_conv_scale, altPositions.data(),
-        altPositions.data() + altPositions.size());
-
-      pointCloud.swapPoints(altPositions);
+  try {
+    for (auto& result : results) {
+      auto output = result.get();
+      *_log << output->log.str();
+      callback->onOutputBuffer(output->payload);
     }
+  }
+  catch (...) {
+    // the remaining attributes reference pointCloud: wait before unwinding
+    for (auto& result : results)
+      if (result.valid())
+        result.wait();
+    throw;
+  }
+}
+
+//----------------------------------------------------------------------------
+// The attribute brick header of attribute attrIdx in the current slice,
+// prior to any slice-dependent refinement (dist2, coordinate conversion).
+
+AttributeBrickHeader
+PCCTMC3Encoder3::makeAttributeBrickHeader(
+  const EncoderParams* params, int attrIdx) const
+{
+  const auto& attr_aps = *_aps[attrIdx];
+  const auto& attr_enc = params->attr[attrIdx];
+
+  // todo(df): move elsewhere?
+  AttributeBrickHeader abh;
+  abh.attr_attr_parameter_set_id = attr_aps.aps_attr_parameter_set_id;
+  abh.attr_sps_attr_idx = attrIdx;
+  abh.attr_geom_slice_id = _sliceId;
+  abh.attr_qp_delta_luma = 0;
+  abh.attr_qp_delta_chroma = 0;
+  abh.attr_layer_qp_delta_luma = attr_enc.abh.attr_layer_qp_delta_luma;
+  abh.attr_layer_qp_delta_chroma = attr_enc.abh.attr_layer_qp_delta_chroma;
+
+  // NB: regionQpOrigin/regionQpSize use the STV axes, not XYZ.
+  if (false) {
+    abh.qpRegions.emplace_back();
+    auto& region = abh.qpRegions.back();
+    region.regionOrigin = 0;
+    region.regionSize = 0;
+    region.attr_region_qp_offset = {0, 0};
+    abh.attr_region_bits_minus1 = -1
+      + numBits(std::max(region.regionOrigin.max(), region.regionSize.max()));
+  }
+  // Number of regions is constrained to at most 1.
+  assert(abh.qpRegions.size() <= 1);
+
+  return abh;
+}
+
+//----------------------------------------------------------------------------
+// Encode every attribute of the current slice in a single pass over their
+// shared LoDs.  Returns false, having output nothing, if the attributes
+// cannot be coded together.
+
+bool
+PCCTMC3Encoder3::encodeAttributeBricksFused(
+  const EncoderParams* params,
+  int numInputPoints,
+  std::unique_ptr<AttributeEncoderIntf>* attrEncoder,
+  PCCTMC3Encoder3::Callbacks* callback)
+{
+  for (const auto& it : params->attributeIdxMap)
+    if (!fusedCodingSupported(*_aps[it.second]))
+      return false;
+
+  pcc::chrono::Stopwatch<pcc::chrono::utime_inc_children_clock> clock_user;
+  clock_user.start();
+
+  const size_t numAttrs = params->attributeIdxMap.size();
+  std::vector<AttributeBrickHeader> abhs;
+  std::vector<PayloadBuffer> payloads(
+    numAttrs, PayloadBuffer(PayloadType::kAttributeBrick));
+  std::vector<AttributeBrickEncoding> attrs;
+  abhs.reserve(numAttrs);
+
+  for (const auto& it : params->attributeIdxMap) {
+    int attrIdx = it.second;
+    const auto& attr_aps = *_aps[attrIdx];
+    const auto& attr_enc = params->attr[attrIdx];
+
+    abhs.push_back(makeAttributeBrickHeader(params, attrIdx));
+    auto& abh = abhs.back();
 
     // calculate dist2 for this slice
     abh.attr_dist2_delta = 0;
     if (attr_aps.aps_slice_dist2_deltas_present_flag) {
-      // todo(df): this could be set in the sps and refined only if necessary
-      auto dist2 =
-        estimateDist2(pointCloud, 100, 128, attr_enc.dist2PercentileEstimate);
+      auto dist2 = estimateDist2(
+        pointCloud, 100, 128, attr_enc.dist2PercentileEstimate);
       abh.attr_dist2_delta = dist2 - attr_aps.dist2;
     }
 
-    // replace the attribute encoder if not compatible
-    if (!attrEncoder->isReusable(attr_aps, abh))
-      attrEncoder = makeAttributeEncoder();
+    attrs.push_back({&_sps->attributeSets[attrIdx], &attr_aps, &abh,
+                     &_ctxtMemAttrs.at(attrIdx), &payloads[attrs.size()]});
+  }
 
-    auto& ctxtMemAttr = _ctxtMemAttrs.at(abh.attr_sps_attr_idx);
-    attrEncoder->encode(
-      *_sps, attr_sps, attr_aps, abh, ctxtMemAttr, pointCloud, &payload);
+  // replace the attribute encoder if not compatible
+  if (!(*attrEncoder)->isReusable(*attrs[0].aps, abhs[0]))
+    *attrEncoder = makeAttributeEncoder(
+      getThreadPool(params->numThreads), getLodCache(params->lodCacheSize));
 
-    if (attr_aps.spherical_coord_flag)
-      pointCloud.swapPoints(altPositions);
+  if (!(*attrEncoder)->encodeFused(*_sps, attrs, pointCloud))
+    return false;
 
-    clock_user.stop();
+  clock_user.stop();
 
-    int coded_size = int(payload.size());
-    double bpp = double(8 * coded_size) / inputPointCloud.getPointCount();
-    std::cout << label << "s bitstream size " << coded_size << " B (" << bpp
-              << " bpp)\n";
+  std::ostringstream labels;
+  for (size_t i = 0; i < numAttrs; i++) {
+    const auto& label = attrs[i].desc->attributeLabel;
+    labels << (i ? "s+" : "") << label;
 
-    auto time_user = std::chrono::duration_cast<std::chrono::milliseconds>(
-      clock_user.count());
-    std::cout << label
-              << "s processing time (user): " << time_user.count() / 1000.0
-              << " s" << std::endl;
+    int coded_size = int(payloads[i].size());
+    double bpp = double(8 * coded_size) / numInputPoints;
+    *_log << label << "s bitstream size " << coded_size << " B (" << bpp
+          << " bpp)\n";
+  }
 
+  auto time_user = std::chrono::duration_cast<std::chrono::milliseconds>(
+    clock_user.count());
+  *_log << labels.str() << "s processing time (user): "
+        << time_user.count() / 1000.0 << " s" << std::endl;
+
+  for (const auto& payload : payloads)
     callback->onOutputBuffer(payload);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Encode a single attribute of pointCloud, replacing the attribute values
+// with their reconstruction.
+//
+// NB: pointCloud is not otherwise modified, so that distinct attributes may
+// be encoded concurrently.
+
+void
+PCCTMC3Encoder3::encodeAttributeBrick(
+  const EncoderParams* params,
+  int attrIdx,
+  int numInputPoints,
+  std::unique_ptr<AttributeEncoderIntf>* attrEncoder,
+  PayloadBuffer* payload,
+  std::ostream* log)
+{
+  const auto& attr_sps = _sps->attributeSets[attrIdx];
+  const auto& attr_aps = *_aps[attrIdx];
+  const auto& attr_enc = params->attr[attrIdx];
+  const auto& label = attr_sps.attributeLabel;
+
+  pcc::chrono::Stopwatch<pcc::chrono::utime_inc_children_clock> clock_user;
+  clock_user.start();
+
+  AttributeBrickHeader abh = makeAttributeBrickHeader(params, attrIdx);
+
+  bool isColour = attr_sps.attr_num_dimensions_minus1 == 2;
+  bool isReflectance = attr_sps.attr_num_dimensions_minus1 == 0;
+
+  // Convert cartesian positions to spherical for use in attribute coding.
+  // NB: the conversion is performed using a separate point set comprising
+  // only the current attribute, leaving the shared positions unmodified.
+  PCCPointSet3 sphericalCloud;
+  PCCPointSet3* attrCloud = &pointCloud;
+  if (attr_aps.spherical_coord_flag) {
+    const size_t numPoints = pointCloud.getPointCount();
+    std::vector<pcc::point_t> altPositions(numPoints);
+
+    auto laserOrigin = _gps->geomAngularOrigin - _sliceOrigin;
+    auto bboxRpl = convertXyzToRpl(
+      laserOrigin, _gps->geom_angular_theta_laser.data(),
+      _gps->geom_angular_theta_laser.size(), &pointCloud[0],
+      &pointCloud[0] + numPoints, altPositions.data());
+
+    abh.attr_coord_conv_scale = normalisedAxesWeights(bboxRpl);
+    offsetAndScale(
+      bboxRpl.min, abh.attr_coord_conv_scale, altPositions.data(),
+      altPositions.data() + altPositions.size());
+
+    sphericalCloud.addRemoveAttributes(isColour, isReflectance);
+    sphericalCloud.resize(numPoints);
+    sphericalCloud.swapPoints(altPositions);
+    for (size_t i = 0; i < numPoints; i++) {
+      if (isColour)
+        sphericalCloud.setColor(i, pointCloud.getColor(i));
+      if (isReflectance)
+        sphericalCloud.setReflectance(i, pointCloud.getReflectance(i));
+    }
+
+    attrCloud = &sphericalCloud;
   }
 
-  // Note the current slice id for loss detection with entropy continuation
-  _prevSliceId = _sliceId;
+  // calculate dist2 for this slice
+  abh.attr_dist2_delta = 0;
+  if (attr_aps.aps_slice_dist2_deltas_present_flag) {
+    // todo(df): this could be set in the sps and refined only if necessary
+    auto dist2 =
+      estimateDist2(*attrCloud, 100, 128, attr_enc.dist2PercentileEstimate);
+    abh.attr_dist2_delta = dist2 - attr_aps.dist2;
+  }
 
-  // prevent re-use of this sliceId:  the next slice (geometry + attributes)
-  // should be distinguishable from the current slice.
-  _sliceId++;
-  _firstSliceInFrame = false;
+  // replace the attribute encoder if not compatible
+  if (!(*attrEncoder)->isReusable(attr_aps, abh))
+    *attrEncoder = makeAttributeEncoder(
+      getThreadPool(params->numThreads), getLodCache(params->lodCacheSize));
+
+  auto& ctxtMemAttr = _ctxtMemAttrs.at(abh.attr_sps_attr_idx);
+  (*attrEncoder)
+    ->encode(*_sps, attr_sps, attr_aps, abh, ctxtMemAttr, *attrCloud, payload);
+
+  // Copy the reconstructed attribute values back to the shared point set
+  if (attrCloud != &pointCloud) {
+    for (size_t i = 0; i < pointCloud.getPointCount(); i++) {
+      if (isColour)
+        pointCloud.setColor(i, attrCloud->getColor(i));
+      if (isReflectance)
+        pointCloud.setReflectance(i, attrCloud->getReflectance(i));
+    }
+  }
 
-  appendReconstructedPoints(reconstructedCloud);
+  clock_user.stop();
+
+  int coded_size = int(payload->size());
+  double bpp = double(8 * coded_size) / numInputPoints;
+  *log << label << "s bitstream size " << coded_size << " B (" << bpp
+       << " bpp)\n";
+
+  auto time_user = std::chrono::duration_cast<std::chrono::milliseconds>(
+    clock_user.count());
+  *log << label << "s processing time (user): " << time_user.count() / 1000.0
+       << " s" << std::endl;
+}
+
+//----------------------------------------------------------------------------
+// Indicates if a slice continues the entropy state of the preceding slice.
+
+bool
+PCCTMC3Encoder3::continuesEntropyState(
+  const EncoderParams* params, bool firstSliceInFrame) const
+{
+  // Entropy continuation is not permitted in the first slice of a frame
+  if (!_sps->entropy_continuation_enabled_flag || firstSliceInFrame)
+    return false;
+
+  return !params->independentSlices;
 }
 
 //----------------------------------------------------------------------------
@@ -628,10 +1012,8 @@ PCCTMC3Encoder3::encodeGeometryBrick(
   gbh.geom_qp_offset_intvl_log2_delta =
     params->gbh.geom_qp_offset_intvl_log2_delta;
 
-  // Entropy continuation is not permitted in the first slice of a frame
-  gbh.entropy_continuation_flag = false;
-  if (_sps->entropy_continuation_enabled_flag)
-    gbh.entropy_continuation_flag = !_firstSliceInFrame;
+  gbh.entropy_continuation_flag =
+    continuesEntropyState(params, _firstSliceInFrame);
 
   // inform the geometry coder what the root node size is
   for (int k = 0; k < 3; k++) {
@@ -676,7 +1058,7 @@ PCCTMC3Encoder3::encodeGeometryBrick(
   if (_gps->predgeom_enabled_flag)
     encodePredictiveGeometry(
       params->predGeom, *_gps, gbh, pointCloud, *_ctxtMemPredGeom,
-      arithmeticEncoders[0].get());
+      arithmeticEncoders[0].get(), getThreadPool(params->numThreads));
   else if (!_gps->trisoup_enabled_flag)
     encodeGeometryOctree(
       params->geom, *_gps, gbh, pointCloud, *_ctxtMemOctreeGeom,
@@ -754,7 +1136,8 @@ PCCTMC3Encoder3::appendReconstructedPoints(PCCPointSet3* reconstructedCloud)
 // this->pointCloud for use by the encoding process.
 
 SrcMappedPointSet
-PCCTMC3Encoder3::quantization(const PCCPointSet3& src)
+PCCTMC3Encoder3::quantization(
+  const PCCPointSet3& src, ThreadPool* threadPool)
 {
   // Currently the sequence bounding box size must be set
   assert(_sps->seqBoundingBoxSize != Vec3<int>{0});
@@ -766,11 +1149,12 @@ PCCTMC3Encoder3::quantization(const PCCPointSet3& src)
   // When using predictive geometry, sub-sample the point cloud and let
   // the predictive geometry coder quantise internally.
   if (_gps->predgeom_enabled_flag && _gps->geom_unique_points_flag)
-    return samplePositionsUniq(_geomPreScale, _sps->seqBoundingBoxOrigin, src);
+    return samplePositionsUniq(
+      _geomPreScale, _sps->seqBoundingBoxOrigin, src, threadPool);
 
   if (_gps->geom_unique_points_flag)
     return quantizePositionsUniq(
-      _geomPreScale, _sps->seqBoundingBoxOrigin, clampBox, src);
+      _geomPreScale, _sps->seqBoundingBoxOrigin, clampBox, src, threadPool);
 
   SrcMappedPointSet dst;
   quantizePositions(
@@ -778,6 +1162,34 @@ PCCTMC3Encoder3::quantization(const PCCPointSet3& src)
   return dst;
 }
 
+//----------------------------------------------------------------------------
+
+ThreadPool*
+PCCTMC3Encoder3::getThreadPool(int numThreads)
+{
+  if (numThreads <= 1)
+    return nullptr;
+
+  if (!_threadPool || _threadPool->numThreads() != numThreads)
+    _threadPool.reset(new ThreadPool(numThreads));
+
+  return _threadPool.get();
+}
+
+//----------------------------------------------------------------------------
+
+AttributeLodCache*
+PCCTMC3Encoder3::getLodCache(int maxEntries)
+{
+  if (maxEntries <= 0)
+    return nullptr;
+
+  if (!_lodCache || _lodCache->maxEntries() != maxEntries)
+    _lodCache = std::make_shared<AttributeLodCache>(maxEntries);
+
+  return _lodCache.get();
+}
+
 //----------------------------------------------------------------------------
 // get the partial point cloud according to required point indexes
 
@@ -811,7 +1223,8 @@ PCCPointSet3
 getPartition(
   const PCCPointSet3& src,
   const SrcMappedPointSet& map,
-  const std::vector<int32_t>& indexes)
+  int pointBegin,
+  int pointEnd)
 {
   // Without the list, do nothing
   if (map.idxToSrcIdx.empty())
@@ -820,7 +1233,7 @@ getPartition(
   // work out the destination size.
   // loop over each linked list until an element points to itself
   int size = 0;
-  for (int idx : indexes) {
+  for (int idx = pointBegin; idx < pointEnd; idx++) {
     int prevIdx, srcIdx = map.idxToSrcIdx[idx];
     do {
       size++;
@@ -834,7 +1247,7 @@ getPartition(
   dst.resize(size);
 
   int dstIdx = 0;
-  for (int idx : indexes) {
+  for (int idx = pointBegin; idx < pointEnd; idx++) {
     int prevIdx, srcIdx = map.idxToSrcIdx[idx];
     do {
       dst[dstIdx] = src[srcIdx];
@@ -854,6 +1267,52 @@ getPartition(
   return dst;
 }
 
+//----------------------------------------------------------------------------
+// Reorder the points (and source mapping) such that the points of each
+// partition are contiguous, in partition order.  The point indexes of each
+// partition are replaced by the range [pointBegin, pointEnd).
+//
+// NB: each point must belong to exactly one partition.
+
+void
+sortPointsByPartition(
+  SrcMappedPointSet* points, std::vector<Partition>* partitions)
+{
+  auto& cloud = points->cloud;
+  auto& idxToSrcIdx = points->idxToSrcIdx;
+  const int numPoints = cloud.getPointCount();
+
+  // The current location of each point, and the point at each location
+  std::vector<int32_t> pointIdxToLoc(numPoints);
+  std::vector<int32_t> locToPointIdx(numPoints);
+  std::iota(pointIdxToLoc.begin(), pointIdxToLoc.end(), 0);
+  std::iota(locToPointIdx.begin(), locToPointIdx.end(), 0);
+
+  int dstIdx = 0;
+  for (auto& partition : *partitions) {
+    partition.pointBegin = dstIdx;
+    for (int pointIdx : partition.pointIndexes) {
+      int loc = pointIdxToLoc[pointIdx];
+      assert(loc >= dstIdx);
+
+      cloud.swapPoints(dstIdx, loc);
+      if (!idxToSrcIdx.empty())
+        std::swap(idxToSrcIdx[dstIdx], idxToSrcIdx[loc]);
+
+      int displacedIdx = locToPointIdx[dstIdx];
+      locToPointIdx[loc] = displacedIdx;
+      pointIdxToLoc[displacedIdx] = loc;
+      locToPointIdx[dstIdx] = pointIdx;
+      pointIdxToLoc[pointIdx] = dstIdx;
+      dstIdx++;
+    }
+    partition.pointEnd = dstIdx;
+    std::vector<int32_t>().swap(partition.pointIndexes);
+  }
+
+  assert(dstIdx == numPoints);
+}
+
 //============================================================================
 
 }  // namespace pcc
@@ -50,6 +50,7 @@ namespace pcc {
 
 struct GeometryOctreeContexts;
 struct PredGeomContexts;
+class ThreadPool;
 
 //============================================================================
 
@@ -66,7 +67,8 @@ void decodeGeometryOctree(
   const GeometryBrickHeader& gbh,
   PCCPointSet3& pointCloud,
   GeometryOctreeContexts& ctxtMem,
-  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoder);
+  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoder,
+  ThreadPool* threadPool = nullptr);
 
 void decodeGeometryOctreeScalable(
   const GeometryParameterSet& gps,
@@ -74,7 +76,8 @@ void decodeGeometryOctreeScalable(
   int minGeomNodeSizeLog2,
   PCCPointSet3& pointCloud,
   GeometryOctreeContexts& ctxtMem,
-  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoder);
+  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoder,
+  ThreadPool* threadPool = nullptr);
 
 //----------------------------------------------------------------------------
 
@@ -91,7 +94,8 @@ void decodeGeometryTrisoup(
   const GeometryBrickHeader& gbh,
   PCCPointSet3& pointCloud,
   GeometryOctreeContexts& ctxtMem,
-  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoder);
+  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoder,
+  ThreadPool* threadPool = nullptr);
 
 //----------------------------------------------------------------------------
 
@@ -101,7 +105,8 @@ void encodePredictiveGeometry(
   GeometryBrickHeader& gbh,
   PCCPointSet3& pointCloud,
   PredGeomContexts& ctxtMem,
-  EntropyEncoder* arithmeticEncoder);
+  EntropyEncoder* arithmeticEncoder,
+  ThreadPool* threadPool = nullptr);
 
 void decodePredictiveGeometry(
   const GeometryParameterSet& gps,
@@ -220,6 +220,36 @@ mapGeometryOccupancyInv(uint8_t occupancy, uint8_t neighPattern)
   return occupancy;
 }
 
+//============================================================================
+// Update the neighbour pattern flags for a node using the occupancy of its
+// siblings.
+
+void
+updateGeometryNeighStateSiblings(
+  PCCOctree3Node& child, int childIdx, uint8_t parentOccupancy)
+{
+  static const struct {
+    int childIdxBitPos;
+    int patternFlagUs;
+    int patternFlagThem;
+  } neighParamMap[] = {
+    {4, 1 << 1, 1 << 0},  // x
+    {2, 1 << 2, 1 << 3},  // y
+    {1, 1 << 4, 1 << 5},  // z
+  };
+
+  for (const auto& param : neighParamMap) {
+    if ((childIdx & param.childIdxBitPos) == 0) {
+      // $axis co-ordinate = 0
+      if (parentOccupancy & (1 << (childIdx + param.childIdxBitPos)))
+        child.neighPattern |= param.patternFlagThem;
+    } else {
+      if (parentOccupancy & (1 << (childIdx - param.childIdxBitPos)))
+        child.neighPattern |= param.patternFlagUs;
+    }
+  }
+}
+
 //============================================================================
 // Update the neighbour pattern flags for a node and the 'left' neighbour on
 // each axis.  This update should be applied to each newly inserted node.
@@ -236,10 +266,12 @@ updateGeometryNeighState(
   uint8_t neighPattern,
   uint8_t parentOccupancy)
 {
-  int64_t midx;
-  if (!siblingRestriction) {
-    midx = child.mortonIdx = mortonAddr(child.pos);
-  }
+  updateGeometryNeighStateSiblings(child, childIdx, parentOccupancy);
+
+  if (siblingRestriction)
+    return;
+
+  int64_t midx = child.mortonIdx = mortonAddr(child.pos);
 
   static const struct {
     int childIdxBitPos;
@@ -253,24 +285,13 @@ updateGeometryNeighState(
   };
 
   for (const auto& param : neighParamMap) {
-    // skip expensive check if parent's flags indicate adjacent neighbour
-    // is not present.
-    if ((childIdx & param.childIdxBitPos) == 0) {
-      // $axis co-ordinate = 0
-      if (parentOccupancy & (1 << (childIdx + param.childIdxBitPos)))
-        child.neighPattern |= param.patternFlagThem;
-
-      if (!(neighPattern & param.patternFlagUs))
-        continue;
-    } else {
-      if (parentOccupancy & (1 << (childIdx - param.childIdxBitPos)))
-        child.neighPattern |= param.patternFlagUs;
-
-      // no external search is required for $axis co-ordinate = 1
+    // no external search is required for $axis co-ordinate = 1
+    if (childIdx & param.childIdxBitPos)
       continue;
-    }
 
-    if (siblingRestriction)
+    // skip expensive check if parent's flags indicate adjacent neighbour
+    // is not present.
+    if (!(neighPattern & param.patternFlagUs))
       continue;
 
     // calculate the morton address of the 'left' neighbour,
@@ -575,6 +596,7 @@ OctreePlanarState::OctreePlanarState(OctreePlanarState&& rhs)
 OctreePlanarState&
 OctreePlanarState::operator=(const OctreePlanarState& rhs)
 {
+  _planarBufferEnabled = rhs._planarBufferEnabled;
   _planarBuffer = rhs._planarBuffer;
   _rate = rhs._rate;
   _localDensity = rhs._localDensity;
@@ -587,8 +609,9 @@ OctreePlanarState::operator=(const OctreePlanarState& rhs)
 OctreePlanarState&
 OctreePlanarState::operator=(OctreePlanarState&& rhs)
 {
+  _planarBufferEnabled = rhs._planarBufferEnabled;
   _planarBuffer = std::move(rhs._planarBuffer);
-  _rate = std::move(rhs._rateThreshold);
+  _rate = std::move(rhs._rate);
   _localDensity = std::move(rhs._localDensity);
   _rateThreshold = std::move(rhs._rateThreshold);
   return *this;
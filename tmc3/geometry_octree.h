@@ -50,6 +50,10 @@ namespace pcc {
 
 //============================================================================
 
+class ThreadPool;
+
+//============================================================================
+
 const int MAX_NUM_DM_LEAF_POINTS = 2;
 
 //============================================================================
@@ -107,6 +111,9 @@ struct OctreeNodePlanar {
 uint8_t mapGeometryOccupancy(uint8_t occupancy, uint8_t neighPattern);
 uint8_t mapGeometryOccupancyInv(uint8_t occupancy, uint8_t neighPattern);
 
+void updateGeometryNeighStateSiblings(
+  PCCOctree3Node& child, int childIdx, uint8_t parentOccupancy);
+
 void updateGeometryNeighState(
   bool siblingRestriction,
   const ringbuf<PCCOctree3Node>::iterator& bufEnd,
@@ -481,7 +488,8 @@ void decodeGeometryOctree(
   PCCPointSet3& pointCloud,
   GeometryOctreeContexts& ctxtMem,
   std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoders,
-  pcc::ringbuf<PCCOctree3Node>* nodesRemaining);
+  pcc::ringbuf<PCCOctree3Node>* nodesRemaining,
+  ThreadPool* threadPool = nullptr);
 
 //============================================================================
 
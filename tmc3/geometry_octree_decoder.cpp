@@ -35,12 +35,17 @@
 
 #include "geometry.h"
 
+#include <condition_variable>
+#include <future>
+#include <mutex>
+
 #include "DualLutCoder.h"
 #include "OctreeNeighMap.h"
 #include "geometry_octree.h"
 #include "geometry_intra_pred.h"
 #include "io_hls.h"
 #include "tables.h"
+#include "thread_pool.h"
 #include "quantization.h"
 
 namespace pcc {
@@ -1246,6 +1251,693 @@ invQuantPosition(int qp, Vec3<uint32_t> quantMasks, const Vec3<int32_t>& pos)
   return recon;
 }
 
+//============================================================================
+// Parameters of the octree decoding process common to all levels of a slice
+
+struct OctreeSliceParams {
+  const GeometryParameterSet* gps;
+
+  int idcmThreshold;
+  int sliceQp;
+
+  // Lidar angles for planar prediction
+  int numLasers;
+  const int* thetaLaser;
+  const int* zLaser;
+  int deltaAngle;
+
+  // Lidar position relative to slice origin
+  Vec3<int> headPos;
+};
+
+//----------------------------------------------------------------------------
+// Parameters of the octree decoding process for a single level
+
+struct OctreeLevelParams {
+  Vec3<int> nodeSizeLog2;
+  Vec3<int> childSizeLog2;
+  Vec3<int> planarDepth;
+
+  // represents the largest dimension of the current node
+  int nodeMaxDimLog2;
+
+  // if one dimension is not split, atlasShift[k] = 0
+  int atlasShift;
+  int occupancySkipLevel;
+
+  int numLvlsUntilQpOffset;
+  int idcmQp;
+  Vec3<uint32_t> posQuantBitMasks;
+};
+
+//============================================================================
+// The nodes of the current octree level, held in the same fifo as the
+// nodes of the next level.
+
+class OctreeFifoLevel {
+public:
+  OctreeFifoLevel(pcc::ringbuf<PCCOctree3Node>& fifo)
+    : _fifo(fifo), _fifoCurrLvlEnd(fifo.end())
+  {}
+
+  PCCOctree3Node* front()
+  {
+    return _fifo.begin() != _fifoCurrLvlEnd ? &_fifo.front() : nullptr;
+  }
+
+  void pop_front() { _fifo.pop_front(); }
+
+  void updateOccupancyAtlas(
+    const Vec3<int32_t>& pos,
+    int atlasShift,
+    MortonMap3D* occupancyAtlas,
+    Vec3<int32_t>* atlasOrigin)
+  {
+    updateGeometryOccupancyAtlas(
+      pos, atlasShift, _fifo, _fifoCurrLvlEnd, occupancyAtlas, atlasOrigin);
+  }
+
+  // Append a node to the next level
+  PCCOctree3Node& emplace_back()
+  {
+    _fifo.emplace_back();
+    return _fifo.back();
+  }
+
+private:
+  pcc::ringbuf<PCCOctree3Node>& _fifo;
+  pcc::ringbuf<PCCOctree3Node>::iterator _fifoCurrLvlEnd;
+};
+
+//============================================================================
+// The nodes of an octree level that are produced by one thread and
+// consumed, as they are produced, by another.
+//
+// NB: nodes are not removed from the queue; references remain valid.
+
+class OctreeNodeQueue {
+public:
+  struct iterator;
+
+  OctreeNodeQueue(size_t maxNodes) : _chunks((maxNodes >> kChunkSizeLog2) + 1)
+  {}
+
+  // Append a node (producer)
+  PCCOctree3Node& emplace_back()
+  {
+    // the nodes appended so far are complete
+    if (_numWritten - _numPublished >= kPublishInterval)
+      publish(false);
+
+    assert((_numWritten >> kChunkSizeLog2) < _chunks.size());
+    auto& chunk = _chunks[_numWritten >> kChunkSizeLog2];
+    if (!chunk)
+      chunk.reset(new PCCOctree3Node[kChunkSize]);
+
+    auto& node = chunk[_numWritten++ & (kChunkSize - 1)];
+    node = PCCOctree3Node();
+    return node;
+  }
+
+  // Indicate that no more nodes will be appended (producer)
+  void close() { publish(true); }
+
+  // Wait until more than @count nodes are available, or the queue is
+  // closed.  Returns the number of available nodes (consumer).
+  size_t waitForNodes(size_t count)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cv.wait(lock, [&] { return _numPublished > count || _closed; });
+    return _numPublished;
+  }
+
+  PCCOctree3Node& operator[](size_t idx)
+  {
+    return _chunks[idx >> kChunkSizeLog2][idx & (kChunkSize - 1)];
+  }
+
+  // NB: only valid once the queue is closed
+  size_t size() const { return _numWritten; }
+
+private:
+  void publish(bool close)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _numPublished = _numWritten;
+      _closed |= close;
+    }
+    _cv.notify_one();
+  }
+
+  static const int kChunkSizeLog2 = 12;
+  static const size_t kChunkSize = size_t(1) << kChunkSizeLog2;
+  static const size_t kPublishInterval = 256;
+
+  std::vector<std::unique_ptr<PCCOctree3Node[]>> _chunks;
+
+  // Only accessed by the producer
+  size_t _numWritten = 0;
+
+  // Guarded by _mutex
+  size_t _numPublished = 0;
+  bool _closed = false;
+
+  std::mutex _mutex;
+  std::condition_variable _cv;
+};
+
+//----------------------------------------------------------------------------
+
+struct OctreeNodeQueue::iterator {
+  OctreeNodeQueue* queue;
+  size_t idx;
+
+  PCCOctree3Node* operator->() const { return &(*queue)[idx]; }
+  iterator& operator++() { return ++idx, *this; }
+  bool operator!=(const iterator& other) const { return idx != other.idx; }
+};
+
+//----------------------------------------------------------------------------
+// The nodes of the current octree level, read from a queue that is filled
+// by the thread decoding the previous level.
+
+class OctreeQueueLevel {
+public:
+  OctreeQueueLevel(OctreeNodeQueue& queue) : _queue(queue) {}
+
+  PCCOctree3Node* front()
+  {
+    if (_pos == _numAvailable)
+      _numAvailable = _queue.waitForNodes(_pos);
+    return _pos < _numAvailable ? &_queue[_pos] : nullptr;
+  }
+
+  void pop_front() { _pos++; }
+
+  void updateOccupancyAtlas(
+    const Vec3<int32_t>& pos,
+    int atlasShift,
+    MortonMap3D* occupancyAtlas,
+    Vec3<int32_t>* atlasOrigin)
+  {
+    const int shift = occupancyAtlas->cubeSizeLog2();
+    const auto currentOrigin = pos >> shift;
+    if (*atlasOrigin == currentOrigin)
+      return;
+
+    // wait until every node within the atlas is available
+    size_t end = _pos;
+    while (true) {
+      while (end < _numAvailable && currentOrigin == _queue[end].pos >> shift)
+        end++;
+
+      if (end < _numAvailable)
+        break;
+
+      size_t numAvailable = _queue.waitForNodes(_numAvailable);
+      if (numAvailable == _numAvailable)
+        break;
+      _numAvailable = numAvailable;
+    }
+
+    updateGeometryOccupancyAtlas(
+      pos, atlasShift, OctreeNodeQueue::iterator{&_queue, _pos},
+      OctreeNodeQueue::iterator{&_queue, end}, occupancyAtlas, atlasOrigin);
+  }
+
+private:
+  OctreeNodeQueue& _queue;
+  size_t _pos = 0;
+  size_t _numAvailable = 0;
+};
+
+//============================================================================
+// Decoded points, written to consecutive positions of a point cloud that
+// has been sized to hold every point of the slice.
+
+class OctreeCloudOutput {
+public:
+  OctreeCloudOutput(PCCPointSet3& cloud, size_t& count)
+    : _cloud(cloud), _count(count)
+  {}
+
+  size_t size() const { return _count; }
+  point_t& operator[](size_t idx) { return _cloud[idx]; }
+
+  void push_back(const point_t& point) { _cloud[_count++] = point; }
+
+  // An iterator to write points following the last, which are appended
+  // by a subsequent call to extend().
+  point_t* inserter() { return &_cloud[_count]; }
+  void extend(int numPoints) { _count += numPoints; }
+
+private:
+  PCCPointSet3& _cloud;
+  size_t& _count;
+};
+
+//----------------------------------------------------------------------------
+// Decoded points, appended to a buffer that grows as required.
+
+class OctreeBufferOutput {
+public:
+  size_t size() const { return _points.size(); }
+  point_t& operator[](size_t idx) { return _points[idx]; }
+  const std::vector<point_t>& points() const { return _points; }
+
+  void push_back(const point_t& point) { _points.push_back(point); }
+
+  std::back_insert_iterator<std::vector<point_t>> inserter()
+  {
+    return std::back_inserter(_points);
+  }
+
+  void extend(int) {}
+
+private:
+  std::vector<point_t> _points;
+};
+
+//============================================================================
+// Decode a single level of the octree, consuming each node of @nodes.
+// Child nodes are appended to @childNodes and decoded points are appended
+// to @points.
+//
+// Returns the number of child nodes.
+
+template<typename NodeInput, typename NodeOutput, typename PointOutput>
+int
+decodeGeometryOctreeLevel(
+  const OctreeSliceParams& slice,
+  const OctreeLevelParams& lvl,
+  GeometryOctreeDecoder& decoder,
+  MortonMap3D& occupancyAtlas,
+  int& nodesBeforePlanarUpdate,
+  NodeInput& nodes,
+  NodeOutput& childNodes,
+  PointOutput& points)
+{
+  const auto& gps = *slice.gps;
+  const auto& idcmThreshold = slice.idcmThreshold;
+  const auto& sliceQp = slice.sliceQp;
+  const auto& numLasers = slice.numLasers;
+  const auto& thetaLaser = slice.thetaLaser;
+  const auto& zLaser = slice.zLaser;
+  const auto& deltaAngle = slice.deltaAngle;
+  const auto& headPos = slice.headPos;
+
+  const auto& nodeSizeLog2 = lvl.nodeSizeLog2;
+  const auto& childSizeLog2 = lvl.childSizeLog2;
+  const auto& nodeMaxDimLog2 = lvl.nodeMaxDimLog2;
+  const auto& atlasShift = lvl.atlasShift;
+  const auto& occupancySkipLevel = lvl.occupancySkipLevel;
+  const auto& numLvlsUntilQpOffset = lvl.numLvlsUntilQpOffset;
+  const auto& idcmQp = lvl.idcmQp;
+  const auto& posQuantBitMasks = lvl.posQuantBitMasks;
+
+  int numNodesNextLvl = 0;
+  Vec3<int32_t> occupancyAtlasOrigin = 0xffffffff;
+
+  decoder.beginOctreeLevel(lvl.planarDepth);
+
+  // process all nodes within a single level
+  for (PCCOctree3Node* node; (node = nodes.front()); nodes.pop_front()) {
+    PCCOctree3Node& node0 = *node;
+
+    if (numLvlsUntilQpOffset == 0) {
+      node0.qp = sliceQp;
+      node0.qp += decoder.decodeQpOffset() << gps.geom_qp_multiplier_log2;
+    }
+
+    int shiftBits = QuantizerGeom::qpShift(node0.qp);
+    auto effectiveNodeSizeLog2 = nodeSizeLog2 - shiftBits;
+    auto effectiveChildSizeLog2 = childSizeLog2 - shiftBits;
+
+    // make quantisation work with qtbt and planar.
+    auto occupancySkip = occupancySkipLevel;
+    if (shiftBits != 0) {
+      for (int k = 0; k < 3; k++) {
+        if (effectiveChildSizeLog2[k] < 0)
+          occupancySkip |= (4 >> k);
+      }
+    }
+
+    int occupancyAdjacencyGt0 = 0;
+    int occupancyAdjacencyGt1 = 0;
+    int occupancyAdjacencyUnocc = 0;
+
+    if (gps.neighbour_avail_boundary_log2) {
+      nodes.updateOccupancyAtlas(
+        node0.pos, atlasShift, &occupancyAtlas, &occupancyAtlasOrigin);
+
+      GeometryNeighPattern gnp = makeGeometryNeighPattern(
+        gps.adjacent_child_contextualization_enabled_flag, node0.pos,
+        atlasShift, occupancyAtlas);
+
+      node0.neighPattern = gnp.neighPattern;
+      occupancyAdjacencyGt0 = gnp.adjacencyGt0;
+      occupancyAdjacencyGt1 = gnp.adjacencyGt1;
+      occupancyAdjacencyUnocc = gnp.adjacencyUnocc;
+    }
+
+    int contextAngle = -1;
+    int contextAnglePhiX = -1;
+    int contextAnglePhiY = -1;
+    if (gps.geom_angular_mode_enabled_flag) {
+      contextAngle = determineContextAngleForPlanar(
+        node0, headPos, nodeSizeLog2, zLaser, thetaLaser, numLasers,
+        deltaAngle, decoder._phiZi, decoder._phiBuffer.data(),
+        &contextAnglePhiX, &contextAnglePhiY);
+    }
+
+    OctreeNodePlanar planar;
+    if (!isLeafNode(effectiveNodeSizeLog2) || node0.idcmEligible) {
+      // planar eligibility
+      bool planarEligible[3] = {false, false, false};
+      if (gps.geom_planar_mode_enabled_flag) {
+        // update the plane rate depending on the occupancy and local density
+        auto occupancy = node0.siblingOccupancy;
+        auto numOccupied = node0.numSiblingsPlus1;
+        if (!nodesBeforePlanarUpdate--) {
+          decoder._planar.updateRate(occupancy, numOccupied);
+          nodesBeforePlanarUpdate = numOccupied - 1;
+        }
+        decoder._planar.isEligible(planarEligible);
+        if (gps.geom_angular_mode_enabled_flag) {
+          if (contextAngle != -1)
+            planarEligible[2] = true;
+          planarEligible[0] = (contextAnglePhiX != -1);
+          planarEligible[1] = (contextAnglePhiY != -1);
+        }
+
+        for (int k = 0; k < 3; k++)
+          planarEligible[k] &= (~occupancySkip >> (2 - k)) & 1;
+      }
+
+      int planarProb[3] = {127, 127, 127};
+      // determine planarity if eligible
+      if (planarEligible[0] || planarEligible[1] || planarEligible[2])
+        decoder.determinePlanarMode(
+          planarEligible, node0, planar, node0.neighPattern, planarProb,
+          contextAngle, contextAnglePhiX, contextAnglePhiY);
+
+      node0.idcmEligible &=
+        planarProb[0] * planarProb[1] * planarProb[2] <= idcmThreshold;
+    }
+
+    if (node0.idcmEligible) {
+      bool isDirectMode = decoder.decodeIsIdcm();
+      if (isDirectMode) {
+        auto idcmSize = effectiveNodeSizeLog2;
+        if (idcmQp) {
+          node0.qp = idcmQp;
+          idcmSize = nodeSizeLog2 - QuantizerGeom::qpShift(idcmQp);
+        }
+
+        size_t firstPoint = points.size();
+        int numPoints = decoder.decodeDirectPosition(
+          gps.geom_unique_points_flag, gps.joint_2pt_idcm_enabled_flag,
+          idcmSize, node0, planar, points.inserter(),
+          gps.geom_angular_mode_enabled_flag, headPos, zLaser, thetaLaser,
+          numLasers);
+        points.extend(numPoints);
+
+        for (int j = 0; j < numPoints; j++) {
+          auto& point = points[firstPoint + j];
+          for (int k = 0; k < 3; k++) {
+            int shift = std::max(0, idcmSize[k]);
+            point[k] += node0.posQ[k] << shift;
+          }
+
+          point = invQuantPosition(node0.qp, posQuantBitMasks, point);
+        }
+
+        // NB: no further siblings to decode by definition of IDCM
+        if (gps.inferred_direct_coding_mode <= 1)
+          assert(node0.numSiblingsPlus1 == 1);
+
+        continue;
+      }
+    }
+
+    int occupancyIsPredicted = 0;
+    int occupancyPrediction = 0;
+
+    // generate intra prediction
+    if (
+      nodeMaxDimLog2 < gps.intra_pred_max_node_size_log2
+      && gps.neighbour_avail_boundary_log2 > 0) {
+      predictGeometryOccupancyIntra(
+        occupancyAtlas, node0.pos, atlasShift, &occupancyIsPredicted,
+        &occupancyPrediction);
+    }
+
+    uint8_t occupancy = 1;
+    if (!isLeafNode(effectiveNodeSizeLog2)) {
+      assert(occupancySkip != 7);
+
+      // planar mode for current node
+      // mask to be used for the occupancy coding
+      // (bit =1 => occupancy bit not coded due to not belonging to the plane)
+      int mask_planar[3] = {0, 0, 0};
+      maskPlanar(planar, mask_planar, occupancySkip);
+
+      occupancy = decoder.decodeOccupancy(
+        node0.neighPattern, occupancyIsPredicted, occupancyPrediction,
+        occupancyAdjacencyGt0, occupancyAdjacencyGt1,
+        occupancyAdjacencyUnocc, mask_planar[0], mask_planar[1],
+        mask_planar[2], planar.planarPossible & 1, planar.planarPossible & 2,
+        planar.planarPossible & 4);
+    }
+
+    assert(occupancy > 0);
+
+    // update atlas for advanced neighbours
+    if (gps.neighbour_avail_boundary_log2) {
+      updateGeometryOccupancyAtlasOccChild(
+        node0.pos, occupancy, &occupancyAtlas);
+    }
+
+    // population count of occupancy for IDCM
+    int numOccupied = popcnt(occupancy);
+
+    // nodeSizeLog2 > 1: for each child:
+    //  - determine elegibility for IDCM
+    //  - directly decode point positions if IDCM allowed and selected
+    //  - otherwise, insert split children into fifo while updating neighbour state
+    for (int i = 0; i < 8; i++) {
+      uint32_t mask = 1 << i;
+      if (!(occupancy & mask)) {
+        // child is empty: skip
+        continue;
+      }
+
+      int x = !!(i & 4);
+      int y = !!(i & 2);
+      int z = !!(i & 1);
+
+      // point counts for leaf nodes are coded immediately upon
+      // encountering the leaf node.
+      if (isLeafNode(effectiveChildSizeLog2)) {
+        int numPoints = 1;
+
+        if (!gps.geom_unique_points_flag) {
+          numPoints = decoder.decodePositionLeafNumPoints();
+        }
+
+        // the final bits from the leaf:
+        Vec3<int32_t> point{(node0.posQ[0] << !(occupancySkip & 4)) + x,
+                            (node0.posQ[1] << !(occupancySkip & 2)) + y,
+                            (node0.posQ[2] << !(occupancySkip & 1)) + z};
+
+        point = invQuantPosition(node0.qp, posQuantBitMasks, point);
+
+        for (int i = 0; i < numPoints; ++i)
+          points.push_back(point);
+
+        // do not recurse into leaf nodes
+        continue;
+      }
+
+      // create & enqueue new child.
+      auto& child = childNodes.emplace_back();
+
+      child.qp = node0.qp;
+      // only shift position if an occupancy bit was coded for the axis
+      child.pos[0] = (node0.pos[0] << !(occupancySkipLevel & 4)) + x;
+      child.pos[1] = (node0.pos[1] << !(occupancySkipLevel & 2)) + y;
+      child.pos[2] = (node0.pos[2] << !(occupancySkipLevel & 1)) + z;
+      child.posQ[0] = (node0.posQ[0] << !(occupancySkip & 4)) + x;
+      child.posQ[1] = (node0.posQ[1] << !(occupancySkip & 2)) + y;
+      child.posQ[2] = (node0.posQ[2] << !(occupancySkip & 1)) + z;
+      child.numSiblingsPlus1 = numOccupied;
+      child.siblingOccupancy = occupancy;
+      child.laserIndex = node0.laserIndex;
+
+      child.idcmEligible = isDirectModeEligible(
+        gps.inferred_direct_coding_mode, nodeMaxDimLog2, node0, child);
+
+      numNodesNextLvl++;
+
+      if (!gps.neighbour_avail_boundary_log2)
+        updateGeometryNeighStateSiblings(child, i, occupancy);
+    }
+  }
+
+
+  return numNodesNextLvl;
+}
+
+//============================================================================
+// The levels of the octree that are coded in separate bitstreams may be
+// decoded concurrently, unless the decoding of a level depends upon the
+// final state of the previous level:
+//  - with in-tree quantisation, a level may finish part way through the
+//    planar rate update interval of a group of siblings.
+//  - the occupancy atlas retains the child occupancy of nodes of the
+//    previous level that is used in place of that of directly coded nodes.
+
+static bool
+canDecodeOctreeLevelsConcurrently(const GeometryParameterSet& gps)
+{
+  if (gps.geom_scaling_enabled_flag)
+    return false;
+
+  if (
+    gps.neighbour_avail_boundary_log2
+    && gps.adjacent_child_contextualization_enabled_flag
+    && gps.inferred_direct_coding_mode > 1)
+    return false;
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+static void
+initOccupancyAtlas(const GeometryParameterSet& gps, MortonMap3D* atlas)
+{
+  if (!gps.neighbour_avail_boundary_log2)
+    return;
+
+  atlas->resize(gps.neighbour_avail_boundary_log2);
+  atlas->clear(
+    gps.adjacent_child_contextualization_enabled_flag
+    && gps.inferred_direct_coding_mode > 1);
+}
+
+//----------------------------------------------------------------------------
+// Decode the last levels of the octree, starting at @firstDepth, where
+// each level after the first is coded in a separate bitstream.
+//
+// Each level after the first is decoded by a separate thread that consumes
+// the nodes of the previous level as they are produced.  The calling
+// thread decodes the first level using @decoder, the state of which is
+// replaced by that at the end of the last level.  The nodes remaining
+// after the last level are returned in @fifo.
+
+static void
+decodeGeometryOctreeLevelsConcurrently(
+  const OctreeSliceParams& slice,
+  const std::vector<OctreeLevelParams>& levels,
+  int firstDepth,
+  GeometryOctreeDecoder& decoder,
+  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoders,
+  MortonMap3D& occupancyAtlas,
+  int& nodesBeforePlanarUpdate,
+  pcc::ringbuf<PCCOctree3Node>& fifo,
+  OctreeCloudOutput& points,
+  ThreadPool* threadPool)
+{
+  const int numStages = int(levels.size()) - 1 - firstDepth;
+
+  // The per-level state of each concurrently decoded level
+  struct Stage {
+    Stage(const GeometryOctreeDecoder& decoder) : decoder(decoder) {}
+
+    GeometryOctreeDecoder decoder;
+    MortonMap3D occupancyAtlas;
+    OctreeBufferOutput points;
+
+    // Since each group of siblings is processed in its entirety, the
+    // planar rate update at the start of every level is unconditional.
+    int nodesBeforePlanarUpdate = 0;
+  };
+
+  // the input nodes of each stage, followed by the nodes remaining after
+  // the last level
+  std::vector<std::unique_ptr<OctreeNodeQueue>> queues;
+  for (int i = 0; i <= numStages; i++)
+    queues.emplace_back(new OctreeNodeQueue(fifo.capacity()));
+
+  // Each stage starts with the state saved prior to the first level
+  std::vector<std::unique_ptr<Stage>> stages;
+  for (int i = 0; i < numStages; i++) {
+    stages.emplace_back(new Stage(decoder));
+    auto& stage = *stages.back();
+    stage.decoder._arithmeticDecoder = arithmeticDecoders[i + 1].get();
+    initOccupancyAtlas(*slice.gps, &stage.occupancyAtlas);
+  }
+
+  // NB: each stage waits only for the nodes of the previous stage, which
+  //     is submitted to the pool before it, or decoded by this thread.
+  std::vector<std::future<void>> done;
+
+  for (int i = 0; i < numStages; i++) {
+    done.push_back(threadPool->submit([&, i]() {
+      auto& stage = *stages[i];
+      OctreeQueueLevel nodes(*queues[i]);
+      auto& childNodes = *queues[i + 1];
+
+      try {
+        decodeGeometryOctreeLevel(
+          slice, levels[firstDepth + 1 + i], stage.decoder,
+          stage.occupancyAtlas, stage.nodesBeforePlanarUpdate, nodes,
+          childNodes, stage.points);
+      }
+      catch (...) {
+        childNodes.close();
+        throw;
+      }
+      childNodes.close();
+    }));
+  }
+
+  try {
+    OctreeFifoLevel nodes(fifo);
+    decodeGeometryOctreeLevel(
+      slice, levels[firstDepth], decoder, occupancyAtlas,
+      nodesBeforePlanarUpdate, nodes, *queues[0], points);
+  }
+  catch (...) {
+    queues[0]->close();
+
+    // the stages reference local state: wait before unwinding
+    for (auto& stageDone : done)
+      stageDone.wait();
+    throw;
+  }
+  queues[0]->close();
+
+  for (auto& stageDone : done)
+    stageDone.wait();
+  for (auto& stageDone : done)
+    stageDone.get();
+
+  // output the points of each level in decoding order
+  for (const auto& stage : stages) {
+    for (const auto& point : stage->points.points())
+      points.push_back(point);
+  }
+
+  decoder = stages.back()->decoder;
+
+  auto& remainingNodes = *queues.back();
+  for (size_t i = 0; i < remainingNodes.size(); i++)
+    fifo.push_back(remainingNodes[i]);
+}
+
 //-------------------------------------------------------------------------
 
 void
@@ -1256,7 +1948,8 @@ decodeGeometryOctree(
   PCCPointSet3& pointCloud,
   GeometryOctreeContexts& ctxtMem,
   std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoders,
-  pcc::ringbuf<PCCOctree3Node>* nodesRemaining)
+  pcc::ringbuf<PCCOctree3Node>* nodesRemaining,
+  ThreadPool* threadPool)
 {
   // init main fifo
   //  -- worst case size is the last level containing every input poit
@@ -1284,20 +1977,24 @@ decodeGeometryOctree(
   node00.idcmEligible = 0;
 
   size_t processedPointCount = 0;
-  std::vector<uint32_t> values;
+  OctreeCloudOutput points(pointCloud, processedPointCount);
 
-  const int idcmThreshold = gps.geom_planar_mode_enabled_flag
+  OctreeSliceParams slice;
+  slice.gps = &gps;
+  slice.idcmThreshold = gps.geom_planar_mode_enabled_flag
     ? gps.geom_planar_idcm_threshold * 127 * 127
     : 127 * 127 * 127;
+  slice.sliceQp = gbh.sliceQp(gps);
 
   // Lidar angles for planar prediction
   const int numLasers = gps.geom_angular_num_lidar_lasers();
   const int* thetaLaser = gps.geom_angular_theta_laser.data();
-  const int* zLaser = gps.geom_angular_z_laser.data();
-  const int* numPhi = gps.geom_angular_num_phi_per_turn.data();
+  slice.numLasers = numLasers;
+  slice.thetaLaser = thetaLaser;
+  slice.zLaser = gps.geom_angular_z_laser.data();
 
   // Lidar position relative to slice origin
-  auto headPos = gps.geomAngularOrigin - gbh.geomBoxOrigin;
+  slice.headPos = gps.geomAngularOrigin - gbh.geomBoxOrigin;
 
   int deltaAngle = 128 << 18;
   for (int i = 0; i < numLasers - 1; i++) {
@@ -1306,21 +2003,10 @@ decodeGeometryOctree(
       deltaAngle = d;
     }
   }
+  slice.deltaAngle = deltaAngle;
 
   MortonMap3D occupancyAtlas;
-  if (gps.neighbour_avail_boundary_log2) {
-    occupancyAtlas.resize(gps.neighbour_avail_boundary_log2);
-    occupancyAtlas.clear(
-      gps.adjacent_child_contextualization_enabled_flag
-      && gps.inferred_direct_coding_mode > 1);
-  }
-
-  Vec3<uint32_t> posQuantBitMasks = 0xffffffff;
-  int idcmQp = 0;
-  int sliceQp = gbh.sliceQp(gps);
-  int numLvlsUntilQpOffset = 0;
-  if (gps.geom_scaling_enabled_flag)
-    numLvlsUntilQpOffset = gbh.geom_octree_qp_offset_depth + 1;
+  initOccupancyAtlas(gps, &occupancyAtlas);
 
   // generate the list of the node size for each level in the tree
   //  - starts with the smallest node and works up
@@ -1332,8 +2018,6 @@ decodeGeometryOctree(
   std::reverse(lvlNodeSizeLog2.begin(), lvlNodeSizeLog2.end());
   auto nodeSizeLog2 = lvlNodeSizeLog2[0];
 
-  // represents the largest dimension of the current node
-  int nodeMaxDimLog2;
   gbh.maxRootNodeDimLog2 = nodeSizeLog2.max();
 
   // the termination depth of the octree phase
@@ -1343,35 +2027,30 @@ decodeGeometryOctree(
   // append a dummy entry to the list so that depth+2 access is always valid
   lvlNodeSizeLog2.emplace_back(lvlNodeSizeLog2.back());
 
-  // NB: this needs to be after the root node size is determined to
-  //     allocate the planar buffer
-  auto arithmeticDecoderIt = arithmeticDecoders.begin();
-  GeometryOctreeDecoder decoder(gps, gbh, ctxtMem, arithmeticDecoderIt->get());
-
-  // saved state for use with parallel bistream coding.
-  // the saved state is restored at the start of each parallel octree level
-  std::unique_ptr<GeometryOctreeDecoder> savedState;
-
-  // The number of nodes to wait before updating the planar rate.
-  // This is to match the prior behaviour where planar is updated once
-  // per coded occupancy.
-  int nodesBeforePlanarUpdate = 1;
+  // derive the per-level parameters
+  Vec3<uint32_t> posQuantBitMasks = 0xffffffff;
+  int idcmQp = 0;
+  int numLvlsUntilQpOffset = 0;
+  if (gps.geom_scaling_enabled_flag)
+    numLvlsUntilQpOffset = gbh.geom_octree_qp_offset_depth + 1;
 
+  std::vector<OctreeLevelParams> levels(std::max(0, maxDepth));
   for (int depth = 0; depth < maxDepth; depth++) {
-    // setup at the start of each level
-    auto fifoCurrLvlEnd = fifo.end();
-    int numNodesNextLvl = 0;
-    Vec3<int32_t> occupancyAtlasOrigin = 0xffffffff;
+    auto& lvl = levels[depth];
 
     // derive per-level node size related parameters
     auto parentNodeSizeLog2 = nodeSizeLog2;
     nodeSizeLog2 = lvlNodeSizeLog2[depth];
     auto childSizeLog2 = lvlNodeSizeLog2[depth + 1];
-    nodeMaxDimLog2 = nodeSizeLog2.max();
+
+    lvl.nodeSizeLog2 = nodeSizeLog2;
+    lvl.childSizeLog2 = childSizeLog2;
+    lvl.nodeMaxDimLog2 = nodeSizeLog2.max();
+    lvl.planarDepth = lvlNodeSizeLog2[0] - nodeSizeLog2;
 
     // if one dimension is not split, atlasShift[k] = 0
-    int atlasShift = 7 & ~nonSplitQtBtAxes(parentNodeSizeLog2, nodeSizeLog2);
-    int occupancySkipLevel = nonSplitQtBtAxes(nodeSizeLog2, childSizeLog2);
+    lvl.atlasShift = 7 & ~nonSplitQtBtAxes(parentNodeSizeLog2, nodeSizeLog2);
+    lvl.occupancySkipLevel = nonSplitQtBtAxes(nodeSizeLog2, childSizeLog2);
 
     // Idcm quantisation applies to child nodes before per node qps
     if (--numLvlsUntilQpOffset > 0) {
@@ -1403,250 +2082,56 @@ decodeGeometryOctree(
         posQuantBitMasks[k] = (1 << nodeSizeLog2[k]) - 1;
     }
 
+    lvl.numLvlsUntilQpOffset = numLvlsUntilQpOffset;
+    lvl.idcmQp = idcmQp;
+    lvl.posQuantBitMasks = posQuantBitMasks;
+  }
+
+  // NB: this needs to be after the root node size is determined to
+  //     allocate the planar buffer
+  auto arithmeticDecoderIt = arithmeticDecoders.begin();
+  GeometryOctreeDecoder decoder(gps, gbh, ctxtMem, arithmeticDecoderIt->get());
+
+  // saved state for use with parallel bistream coding.
+  // the saved state is restored at the start of each parallel octree level
+  std::unique_ptr<GeometryOctreeDecoder> savedState;
+
+  // The number of nodes to wait before updating the planar rate.
+  // This is to match the prior behaviour where planar is updated once
+  // per coded occupancy.
+  int nodesBeforePlanarUpdate = 1;
+
+  for (int depth = 0; depth < maxDepth; depth++) {
     // save context state for parallel coding
     if (depth == maxDepth - 1 - gbh.geom_stream_cnt_minus1)
-      if (gbh.geom_stream_cnt_minus1)
+      if (gbh.geom_stream_cnt_minus1) {
         savedState.reset(new GeometryOctreeDecoder(decoder));
 
+        // decode the remaining levels concurrently
+        if (threadPool && canDecodeOctreeLevelsConcurrently(gps)) {
+          decodeGeometryOctreeLevelsConcurrently(
+            slice, levels, depth, decoder, arithmeticDecoders,
+            occupancyAtlas, nodesBeforePlanarUpdate, fifo, points,
+            threadPool);
+          break;
+        }
+      }
+
     // load context state for parallel coding starting one level later
     if (depth > maxDepth - 1 - gbh.geom_stream_cnt_minus1) {
       decoder = *savedState;
       decoder._arithmeticDecoder = (++arithmeticDecoderIt)->get();
     }
 
-    auto planarDepth = lvlNodeSizeLog2[0] - nodeSizeLog2;
-    decoder.beginOctreeLevel(planarDepth);
-
-    // process all nodes within a single level
-    for (; fifo.begin() != fifoCurrLvlEnd; fifo.pop_front()) {
-      PCCOctree3Node& node0 = fifo.front();
-
-      if (numLvlsUntilQpOffset == 0) {
-        node0.qp = sliceQp;
-        node0.qp += decoder.decodeQpOffset() << gps.geom_qp_multiplier_log2;
-      }
-
-      int shiftBits = QuantizerGeom::qpShift(node0.qp);
-      auto effectiveNodeSizeLog2 = nodeSizeLog2 - shiftBits;
-      auto effectiveChildSizeLog2 = childSizeLog2 - shiftBits;
-
-      // make quantisation work with qtbt and planar.
-      auto occupancySkip = occupancySkipLevel;
-      if (shiftBits != 0) {
-        for (int k = 0; k < 3; k++) {
-          if (effectiveChildSizeLog2[k] < 0)
-            occupancySkip |= (4 >> k);
-        }
-      }
-
-      int occupancyAdjacencyGt0 = 0;
-      int occupancyAdjacencyGt1 = 0;
-      int occupancyAdjacencyUnocc = 0;
-
-      if (gps.neighbour_avail_boundary_log2) {
-        updateGeometryOccupancyAtlas(
-          node0.pos, atlasShift, fifo, fifoCurrLvlEnd, &occupancyAtlas,
-          &occupancyAtlasOrigin);
-
-        GeometryNeighPattern gnp = makeGeometryNeighPattern(
-          gps.adjacent_child_contextualization_enabled_flag, node0.pos,
-          atlasShift, occupancyAtlas);
-
-        node0.neighPattern = gnp.neighPattern;
-        occupancyAdjacencyGt0 = gnp.adjacencyGt0;
-        occupancyAdjacencyGt1 = gnp.adjacencyGt1;
-        occupancyAdjacencyUnocc = gnp.adjacencyUnocc;
-      }
-
-      int contextAngle = -1;
-      int contextAnglePhiX = -1;
-      int contextAnglePhiY = -1;
-      if (gps.geom_angular_mode_enabled_flag) {
-        contextAngle = determineContextAngleForPlanar(
-          node0, headPos, nodeSizeLog2, zLaser, thetaLaser, numLasers,
-          deltaAngle, decoder._phiZi, decoder._phiBuffer.data(),
-          &contextAnglePhiX, &contextAnglePhiY);
-      }
-
-      OctreeNodePlanar planar;
-      if (!isLeafNode(effectiveNodeSizeLog2) || node0.idcmEligible) {
-        // planar eligibility
-        bool planarEligible[3] = {false, false, false};
-        if (gps.geom_planar_mode_enabled_flag) {
-          // update the plane rate depending on the occupancy and local density
-          auto occupancy = node0.siblingOccupancy;
-          auto numOccupied = node0.numSiblingsPlus1;
-          if (!nodesBeforePlanarUpdate--) {
-            decoder._planar.updateRate(occupancy, numOccupied);
-            nodesBeforePlanarUpdate = numOccupied - 1;
-          }
-          decoder._planar.isEligible(planarEligible);
-          if (gps.geom_angular_mode_enabled_flag) {
-            if (contextAngle != -1)
-              planarEligible[2] = true;
-            planarEligible[0] = (contextAnglePhiX != -1);
-            planarEligible[1] = (contextAnglePhiY != -1);
-          }
-
-          for (int k = 0; k < 3; k++)
-            planarEligible[k] &= (~occupancySkip >> (2 - k)) & 1;
-        }
-
-        int planarProb[3] = {127, 127, 127};
-        // determine planarity if eligible
-        if (planarEligible[0] || planarEligible[1] || planarEligible[2])
-          decoder.determinePlanarMode(
-            planarEligible, node0, planar, node0.neighPattern, planarProb,
-            contextAngle, contextAnglePhiX, contextAnglePhiY);
-
-        node0.idcmEligible &=
-          planarProb[0] * planarProb[1] * planarProb[2] <= idcmThreshold;
-      }
-
-      if (node0.idcmEligible) {
-        bool isDirectMode = decoder.decodeIsIdcm();
-        if (isDirectMode) {
-          auto idcmSize = effectiveNodeSizeLog2;
-          if (idcmQp) {
-            node0.qp = idcmQp;
-            idcmSize = nodeSizeLog2 - QuantizerGeom::qpShift(idcmQp);
-          }
-
-          int numPoints = decoder.decodeDirectPosition(
-            gps.geom_unique_points_flag, gps.joint_2pt_idcm_enabled_flag,
-            idcmSize, node0, planar, &pointCloud[processedPointCount],
-            gps.geom_angular_mode_enabled_flag, headPos, zLaser, thetaLaser,
-            numLasers);
-
-          for (int j = 0; j < numPoints; j++) {
-            auto& point = pointCloud[processedPointCount++];
-            for (int k = 0; k < 3; k++) {
-              int shift = std::max(0, idcmSize[k]);
-              point[k] += node0.posQ[k] << shift;
-            }
-
-            point = invQuantPosition(node0.qp, posQuantBitMasks, point);
-          }
-
-          // NB: no further siblings to decode by definition of IDCM
-          if (gps.inferred_direct_coding_mode <= 1)
-            assert(node0.numSiblingsPlus1 == 1);
-
-          continue;
-        }
-      }
-
-      int occupancyIsPredicted = 0;
-      int occupancyPrediction = 0;
-
-      // generate intra prediction
-      if (
-        nodeMaxDimLog2 < gps.intra_pred_max_node_size_log2
-        && gps.neighbour_avail_boundary_log2 > 0) {
-        predictGeometryOccupancyIntra(
-          occupancyAtlas, node0.pos, atlasShift, &occupancyIsPredicted,
-          &occupancyPrediction);
-      }
-
-      uint8_t occupancy = 1;
-      if (!isLeafNode(effectiveNodeSizeLog2)) {
-        assert(occupancySkip != 7);
-
-        // planar mode for current node
-        // mask to be used for the occupancy coding
-        // (bit =1 => occupancy bit not coded due to not belonging to the plane)
-        int mask_planar[3] = {0, 0, 0};
-        maskPlanar(planar, mask_planar, occupancySkip);
-
-        occupancy = decoder.decodeOccupancy(
-          node0.neighPattern, occupancyIsPredicted, occupancyPrediction,
-          occupancyAdjacencyGt0, occupancyAdjacencyGt1,
-          occupancyAdjacencyUnocc, mask_planar[0], mask_planar[1],
-          mask_planar[2], planar.planarPossible & 1, planar.planarPossible & 2,
-          planar.planarPossible & 4);
-      }
-
-      assert(occupancy > 0);
-
-      // update atlas for advanced neighbours
-      if (gps.neighbour_avail_boundary_log2) {
-        updateGeometryOccupancyAtlasOccChild(
-          node0.pos, occupancy, &occupancyAtlas);
-      }
-
-      // population count of occupancy for IDCM
-      int numOccupied = popcnt(occupancy);
-
-      // nodeSizeLog2 > 1: for each child:
-      //  - determine elegibility for IDCM
-      //  - directly decode point positions if IDCM allowed and selected
-      //  - otherwise, insert split children into fifo while updating neighbour state
-      for (int i = 0; i < 8; i++) {
-        uint32_t mask = 1 << i;
-        if (!(occupancy & mask)) {
-          // child is empty: skip
-          continue;
-        }
-
-        int x = !!(i & 4);
-        int y = !!(i & 2);
-        int z = !!(i & 1);
-
-        // point counts for leaf nodes are coded immediately upon
-        // encountering the leaf node.
-        if (isLeafNode(effectiveChildSizeLog2)) {
-          int numPoints = 1;
-
-          if (!gps.geom_unique_points_flag) {
-            numPoints = decoder.decodePositionLeafNumPoints();
-          }
-
-          // the final bits from the leaf:
-          Vec3<int32_t> point{(node0.posQ[0] << !(occupancySkip & 4)) + x,
-                              (node0.posQ[1] << !(occupancySkip & 2)) + y,
-                              (node0.posQ[2] << !(occupancySkip & 1)) + z};
-
-          point = invQuantPosition(node0.qp, posQuantBitMasks, point);
-
-          for (int i = 0; i < numPoints; ++i)
-            pointCloud[processedPointCount++] = point;
-
-          // do not recurse into leaf nodes
-          continue;
-        }
-
-        // create & enqueue new child.
-        fifo.emplace_back();
-        auto& child = fifo.back();
-
-        child.qp = node0.qp;
-        // only shift position if an occupancy bit was coded for the axis
-        child.pos[0] = (node0.pos[0] << !(occupancySkipLevel & 4)) + x;
-        child.pos[1] = (node0.pos[1] << !(occupancySkipLevel & 2)) + y;
-        child.pos[2] = (node0.pos[2] << !(occupancySkipLevel & 1)) + z;
-        child.posQ[0] = (node0.posQ[0] << !(occupancySkip & 4)) + x;
-        child.posQ[1] = (node0.posQ[1] << !(occupancySkip & 2)) + y;
-        child.posQ[2] = (node0.posQ[2] << !(occupancySkip & 1)) + z;
-        child.numSiblingsPlus1 = numOccupied;
-        child.siblingOccupancy = occupancy;
-        child.laserIndex = node0.laserIndex;
-
-        child.idcmEligible = isDirectModeEligible(
-          gps.inferred_direct_coding_mode, nodeMaxDimLog2, node0, child);
-
-        numNodesNextLvl++;
-
-        if (!gps.neighbour_avail_boundary_log2) {
-          updateGeometryNeighState(
-            true, fifo.end(), numNodesNextLvl, child, i, node0.neighPattern,
-            occupancy);
-        }
-      }
-    }
+    OctreeFifoLevel nodes(fifo);
+    int numNodesNextLvl = decodeGeometryOctreeLevel(
+      slice, levels[depth], decoder, occupancyAtlas, nodesBeforePlanarUpdate,
+      nodes, nodes, points);
 
     // Check that one level hasn't produced too many nodes
     // todo(df): this check is too weak to spot overflowing the fifo
     assert(numNodesNextLvl <= ringBufferSize);
+    (void)numNodesNextLvl;
   }
 
   // save the context state for re-use by a future slice if required
@@ -1678,10 +2163,12 @@ decodeGeometryOctree(
   const GeometryBrickHeader& gbh,
   PCCPointSet3& pointCloud,
   GeometryOctreeContexts& ctxtMem,
-  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoders)
+  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoders,
+  ThreadPool* threadPool)
 {
   decodeGeometryOctree(
-    gps, gbh, 0, pointCloud, ctxtMem, arithmeticDecoders, nullptr);
+    gps, gbh, 0, pointCloud, ctxtMem, arithmeticDecoders, nullptr,
+    threadPool);
 }
 
 //-------------------------------------------------------------------------
@@ -1693,12 +2180,13 @@ decodeGeometryOctreeScalable(
   int minGeomNodeSizeLog2,
   PCCPointSet3& pointCloud,
   GeometryOctreeContexts& ctxtMem,
-  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoders)
+  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoders,
+  ThreadPool* threadPool)
 {
   pcc::ringbuf<PCCOctree3Node> nodes;
   decodeGeometryOctree(
     gps, gbh, minGeomNodeSizeLog2, pointCloud, ctxtMem, arithmeticDecoders,
-    &nodes);
+    &nodes, threadPool);
 
   if (minGeomNodeSizeLog2 > 0) {
     size_t size =
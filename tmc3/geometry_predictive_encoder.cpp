@@ -37,6 +37,7 @@
 #include "geometry.h"
 #include "pointset_processing.h"
 #include "quantization.h"
+#include "thread_pool.h"
 
 #include "PCCMisc.h"
 
@@ -683,17 +684,65 @@ generateGeomPredictionTreeAngular(
 //============================================================================
 
 static void
-mortonSort(PCCPointSet3& cloud, int begin, int end, int depth)
+mortonSort(
+  PCCPointSet3& cloud, int begin, int end, int depth, ThreadPool* threadPool)
 {
-  radixSort8(
-    depth, PCCPointSet3::iterator(&cloud, begin),
-    PCCPointSet3::iterator(&cloud, end),
-    [=](int depth, const PCCPointSet3::Proxy& proxy) {
-      const auto& point = *proxy;
-      int mask = 1 << depth;
-      return !!(point[2] & mask) | (!!(point[1] & mask) << 1)
-        | (!!(point[0] & mask) << 2);
+  // NB: mortonAddr() is limited to 21 bits per axis
+  if (depth > 20) {
+    radixSort8(
+      depth, PCCPointSet3::iterator(&cloud, begin),
+      PCCPointSet3::iterator(&cloud, end),
+      [=](int depth, const PCCPointSet3::Proxy& proxy) {
+        const auto& point = *proxy;
+        int mask = 1 << depth;
+        return !!(point[2] & mask) | (!!(point[1] & mask) << 1)
+          | (!!(point[0] & mask) << 2);
+      });
+    return;
+  }
+
+  // The points are sorted using a compact copy of their morton codes, with
+  // the point cloud reordered once the final order is known.  The order is
+  // identical to that of radixSort8 applied to the point cloud directly.
+  struct MortonIndex {
+    int64_t code;
+    int32_t idx;
+  };
+
+  std::vector<MortonIndex> points(end - begin);
+  for (int i = begin; i < end; i++)
+    points[i - begin] = {mortonAddr(cloud[i]), i};
+
+  auto mortonRadix = [](int depth, const MortonIndex& point) {
+    return int(point.code >> (3 * depth)) & 7;
+  };
+
+  // The first pass partitions the points by the most significant bit of
+  // each axis.  Each partition is then sorted independently.
+  std::array<int, 8> counts = {};
+  countingSort(
+    points.begin(), points.end(), counts,
+    [=](const MortonIndex& point) { return mortonRadix(depth, point); });
+
+  if (depth > 0) {
+    std::array<int, 9> offsets;
+    offsets[0] = 0;
+    for (int i = 0; i < 8; i++)
+      offsets[i + 1] = offsets[i] + counts[i];
+
+    parallelFor(threadPool, 8, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; i++) {
+        radixSort8(
+          depth - 1, std::next(points.begin(), offsets[i]),
+          std::next(points.begin(), offsets[i + 1]), mortonRadix);
+      }
     });
+  }
+
+  std::vector<int32_t> order(points.size());
+  for (size_t i = 0; i < points.size(); i++)
+    order[i] = points[i].idx;
+  cloud.permute(begin, order);
 }
 
 //============================================================================
@@ -705,7 +754,8 @@ encodePredictiveGeometry(
   GeometryBrickHeader& gbh,
   PCCPointSet3& cloud,
   PredGeomContexts& ctxtMem,
-  EntropyEncoder* arithmeticEncoder)
+  EntropyEncoder* arithmeticEncoder,
+  ThreadPool* threadPool)
 {
   auto numPoints = cloud.getPointCount();
 
@@ -764,7 +814,7 @@ encodePredictiveGeometry(
     // first, put the points in this tree into a sorted order
     // this can significantly improve the constructed tree
     if (opt.sortMode == PredGeomEncOpts::kSortMorton)
-      mortonSort(cloud, i, iEnd, gbh.maxRootNodeDimLog2);
+      mortonSort(cloud, i, iEnd, gbh.maxRootNodeDimLog2, threadPool);
     else if (opt.sortMode == PredGeomEncOpts::kSortAzimuth)
       sortByAzimuth(cloud, i, iEnd, opt.azimuthSortRecipBinWidth, origin);
     else if (opt.sortMode == PredGeomEncOpts::kSortRadius)
@@ -93,13 +93,15 @@ decodeGeometryTrisoup(
   const GeometryBrickHeader& gbh,
   PCCPointSet3& pointCloud,
   GeometryOctreeContexts& ctxtMemOctree,
-  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoders)
+  std::vector<std::unique_ptr<EntropyDecoder>>& arithmeticDecoders,
+  ThreadPool* threadPool)
 {
   // trisoup uses octree coding until reaching the triangulation level.
   // todo(df): pass trisoup node size rather than 0?
   pcc::ringbuf<PCCOctree3Node> nodes;
   decodeGeometryOctree(
-    gps, gbh, 0, pointCloud, ctxtMemOctree, arithmeticDecoders, &nodes);
+    gps, gbh, 0, pointCloud, ctxtMemOctree, arithmeticDecoders, &nodes,
+    threadPool);
 
   // resume decoding with the last decoder
   auto arithmeticDecoder = arithmeticDecoders.back().get();
@@ -420,7 +420,7 @@ write(const SequenceParameterSet& sps)
 //----------------------------------------------------------------------------
 
 SequenceParameterSet
-parseSps(const PayloadBuffer& buf)
+parseSps(const PayloadView& buf)
 {
   SequenceParameterSet sps;
   assert(buf.type == PayloadType::kSequenceParameterSet);
@@ -654,7 +654,7 @@ write(const SequenceParameterSet& sps, const GeometryParameterSet& gps)
 //----------------------------------------------------------------------------
 
 GeometryParameterSet
-parseGps(const PayloadBuffer& buf)
+parseGps(const PayloadView& buf)
 {
   GeometryParameterSet gps;
   assert(buf.type == PayloadType::kGeometryParameterSet);
@@ -873,7 +873,7 @@ write(const SequenceParameterSet& sps, const AttributeParameterSet& aps)
 //----------------------------------------------------------------------------
 
 AttributeParameterSet
-parseAps(const PayloadBuffer& buf)
+parseAps(const PayloadView& buf)
 {
   AttributeParameterSet aps;
   assert(buf.type == PayloadType::kAttributeParameterSet);
@@ -1062,7 +1062,7 @@ GeometryBrickHeader
 parseGbh(
   const SequenceParameterSet& sps,
   const GeometryParameterSet& gps,
-  const PayloadBuffer& buf,
+  const PayloadView& buf,
   int* bytesRead)
 {
   GeometryBrickHeader gbh;
@@ -1160,7 +1160,7 @@ parseGbh(
 //----------------------------------------------------------------------------
 
 GeometryBrickHeader
-parseGbhIds(const PayloadBuffer& buf)
+parseGbhIds(const PayloadView& buf)
 {
   GeometryBrickHeader gbh;
   assert(buf.type == PayloadType::kGeometryBrick);
@@ -1205,7 +1205,7 @@ GeometryBrickFooter
 parseGbf(
   const GeometryParameterSet& gps,
   const GeometryBrickHeader& gbh,
-  const PayloadBuffer& buf)
+  const PayloadView& buf)
 {
   GeometryBrickFooter gbf;
   assert(buf.type == PayloadType::kGeometryBrick);
@@ -1302,7 +1302,7 @@ write(
 //----------------------------------------------------------------------------
 
 AttributeBrickHeader
-parseAbhIds(const PayloadBuffer& buf)
+parseAbhIds(const PayloadView& buf)
 {
   AttributeBrickHeader abh;
   assert(buf.type == PayloadType::kAttributeBrick);
@@ -1324,7 +1324,7 @@ AttributeBrickHeader
 parseAbh(
   const SequenceParameterSet& sps,
   const AttributeParameterSet& aps,
-  const PayloadBuffer& buf,
+  const PayloadView& buf,
   int* bytesRead)
 {
   AttributeBrickHeader abh;
@@ -1404,7 +1404,7 @@ parseAbh(
 
 ConstantAttributeDataUnit
 parseConstantAttribute(
-  const SequenceParameterSet& sps, const PayloadBuffer& buf)
+  const SequenceParameterSet& sps, const PayloadView& buf)
 {
   ConstantAttributeDataUnit cadu;
   assert(buf.type == PayloadType::kConstantAttribute);
@@ -1485,7 +1485,7 @@ write(const SequenceParameterSet& sps, const TileInventory& inventory)
 //----------------------------------------------------------------------------
 
 TileInventory
-parseTileInventory(const PayloadBuffer& buf)
+parseTileInventory(const PayloadView& buf)
 {
   TileInventory inventory;
   assert(buf.type == PayloadType::kTileInventory);
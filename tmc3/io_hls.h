@@ -60,10 +60,10 @@ write(const SequenceParameterSet& sps, const TileInventory& inventory);
 //     This is not done during parsing to emphasise that there is no parsing
 //     dependency on the SPS.
 
-SequenceParameterSet parseSps(const PayloadBuffer& buf);
-GeometryParameterSet parseGps(const PayloadBuffer& buf);
-AttributeParameterSet parseAps(const PayloadBuffer& buf);
-TileInventory parseTileInventory(const PayloadBuffer& buf);
+SequenceParameterSet parseSps(const PayloadView& buf);
+GeometryParameterSet parseGps(const PayloadView& buf);
+AttributeParameterSet parseAps(const PayloadView& buf);
+TileInventory parseTileInventory(const PayloadView& buf);
 
 //----------------------------------------------------------------------------
 
@@ -83,17 +83,17 @@ void write(
 GeometryBrickHeader parseGbh(
   const SequenceParameterSet& sps,
   const GeometryParameterSet& gps,
-  const PayloadBuffer& buf,
+  const PayloadView& buf,
   int* bytesRead);
 
 AttributeBrickHeader parseAbh(
   const SequenceParameterSet& sps,
   const AttributeParameterSet& aps,
-  const PayloadBuffer& buf,
+  const PayloadView& buf,
   int* bytesRead);
 
 ConstantAttributeDataUnit parseConstantAttribute(
-  const SequenceParameterSet& sps, const PayloadBuffer& buf);
+  const SequenceParameterSet& sps, const PayloadView& buf);
 
 void write(
   const GeometryParameterSet& gps,
@@ -104,19 +104,19 @@ void write(
 GeometryBrickFooter parseGbf(
   const GeometryParameterSet& gps,
   const GeometryBrickHeader& gbh,
-  const PayloadBuffer& buf);
+  const PayloadView& buf);
 
 /**
  * Parse @buf, decoding only the parameter set, slice, tile.
  * NB: the returned header is intentionally incomplete.
  */
-GeometryBrickHeader parseGbhIds(const PayloadBuffer& buf);
+GeometryBrickHeader parseGbhIds(const PayloadView& buf);
 
 /**
  * Parse @buf, decoding only the parameter set and slice ids.
  * NB: the returned header is intentionally incomplete.
  */
-AttributeBrickHeader parseAbhIds(const PayloadBuffer& buf);
+AttributeBrickHeader parseAbhIds(const PayloadView& buf);
 
 //----------------------------------------------------------------------------
 
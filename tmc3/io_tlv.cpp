@@ -80,4 +80,42 @@ readTlv(std::istream& is, PayloadBuffer* buf)
 
 //============================================================================
 
+bool
+TlvReader::readTlv(PayloadView* buf)
+{
+  const size_t kHeaderLen = 5;
+  if (_size - _pos < kHeaderLen)
+    return false;
+
+  auto ptr = reinterpret_cast<const uint8_t*>(_data + _pos);
+  auto type = PayloadType(ptr[0]);
+
+  uint32_t length = 0;
+  length = (length << 8) | ptr[1];
+  length = (length << 8) | ptr[2];
+  length = (length << 8) | ptr[3];
+  length = (length << 8) | ptr[4];
+
+  if (_size - _pos - kHeaderLen < length)
+    return false;
+
+  *buf = PayloadView(type, _data + _pos + kHeaderLen, length);
+  _pos += kHeaderLen + length;
+  return true;
+}
+
+//============================================================================
+
+bool
+TlvFileReader::open(const char* path)
+{
+  bool ok = _file.open(path);
+  _data = _file.data();
+  _size = _file.size();
+  _pos = 0;
+  return ok;
+}
+
+//============================================================================
+
 }  // namespace pcc
\ No newline at end of file
@@ -36,6 +36,7 @@
 #pragma once
 
 #include "PayloadBuffer.h"
+#include "osspecific.h"
 
 #include <istream>
 #include <ostream>
@@ -48,6 +49,44 @@ std::ostream& writeTlv(const PayloadBuffer& buf, std::ostream& os);
 
 std::istream& readTlv(std::istream& is, PayloadBuffer* buf);
 
+//============================================================================
+// Reads TLV encapsulated data units from a bitstream held in memory.  The
+// data units are not copied, the returned views reference the bitstream.
+
+class TlvReader {
+public:
+  TlvReader() = default;
+  TlvReader(const char* data, size_t size) : _data(data), _size(size) {}
+
+  // Obtain a view of the next data unit.  Returns false at the end of the
+  // bitstream or if the data unit is truncated.
+  bool readTlv(PayloadView* buf);
+
+  // Total size of the bitstream
+  size_t size() const { return _size; }
+
+protected:
+  const char* _data = nullptr;
+  size_t _size = 0;
+
+  // Offset of the next data unit
+  size_t _pos = 0;
+};
+
+//----------------------------------------------------------------------------
+// Reads TLV encapsulated data units from a memory mapped bitstream file.
+//
+// NB: views remain valid until the reader is closed or destroyed.
+
+class TlvFileReader : public TlvReader {
+public:
+  // Map the bitstream at path.  Returns false if the file cannot be read.
+  bool open(const char* path);
+
+private:
+  MappedFile _file;
+};
+
 //============================================================================
 
 }  // namespace pcc
\ No newline at end of file
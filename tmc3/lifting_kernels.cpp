@@ -0,0 +1,488 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2020, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "lifting_kernels.h"
+
+#include <cassert>
+
+#if __AVX2__
+#  include <immintrin.h>
+#elif __SSE4_1__
+#  include <smmintrin.h>
+#endif
+
+namespace pcc {
+
+//============================================================================
+
+static_assert(
+  sizeof(Vec3<int64_t>) == 3 * sizeof(int64_t),
+  "Vec3<int64_t> must be three contiguous int64_t");
+
+namespace {
+  const size_t kStride = PredictorStore::kStride;
+  const uint32_t kIndexMask = PredictorStore::kIndexMask;
+}
+
+//============================================================================
+// Vector helpers.  Each operates on 64-bit lanes and matches the result of
+// the corresponding scalar operation on int64_t.
+
+#if __AVX2__
+
+namespace {
+  // The lower 64 bits of a * w, where w < 2^32.
+  inline __m256i mul64x32(__m256i a, __m256i w)
+  {
+    __m256i lo = _mm256_mul_epu32(a, w);
+    __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), w);
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+  }
+
+  // All ones if a < 0, otherwise zero.
+  inline __m256i sign64(__m256i a)
+  {
+    return _mm256_shuffle_epi32(
+      _mm256_srai_epi32(a, 31), _MM_SHUFFLE(3, 3, 1, 1));
+  }
+
+  // a >> shift, with sign extension.
+  inline __m256i sra64(__m256i a, int shift)
+  {
+    __m256i sign = sign64(a);
+    __m128i count = _mm_cvtsi32_si128(shift);
+    a = _mm256_srl_epi64(_mm256_xor_si256(a, sign), count);
+    return _mm256_xor_si256(a, sign);
+  }
+
+  // divExp2RoundHalfInf(a, shift) of each lane, for shift > 0.
+  inline __m256i vDivExp2RoundHalfInf(__m256i a, int shift)
+  {
+    __m256i sign = sign64(a);
+    __m256i mag = _mm256_sub_epi64(_mm256_xor_si256(a, sign), sign);
+    mag = _mm256_add_epi64(mag, _mm256_set1_epi64x(1ll << (shift - 1)));
+    mag = _mm256_srl_epi64(mag, _mm_cvtsi32_si128(shift));
+    return _mm256_sub_epi64(_mm256_xor_si256(mag, sign), sign);
+  }
+
+  // Mask of the lanes occupied by a Vec3<int64_t>
+  inline __m256i vec3Mask() { return _mm256_setr_epi64x(-1, -1, -1, 0); }
+
+  inline __m256i load(const Vec3<int64_t>& v)
+  {
+    return _mm256_maskload_epi64(
+      reinterpret_cast<const long long*>(&v), vec3Mask());
+  }
+
+  inline void store(Vec3<int64_t>& v, __m256i a)
+  {
+    _mm256_maskstore_epi64(reinterpret_cast<long long*>(&v), vec3Mask(), a);
+  }
+}  // namespace
+
+#elif __SSE4_1__
+
+namespace {
+  // The lower 64 bits of a * w, where w < 2^32.
+  inline __m128i mul64x32(__m128i a, __m128i w)
+  {
+    __m128i lo = _mm_mul_epu32(a, w);
+    __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), w);
+    return _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+  }
+
+  // All ones if a < 0, otherwise zero.
+  inline __m128i sign64(__m128i a)
+  {
+    return _mm_shuffle_epi32(_mm_srai_epi32(a, 31), _MM_SHUFFLE(3, 3, 1, 1));
+  }
+
+  // a >> shift, with sign extension.
+  inline __m128i sra64(__m128i a, int shift)
+  {
+    __m128i sign = sign64(a);
+    __m128i count = _mm_cvtsi32_si128(shift);
+    a = _mm_srl_epi64(_mm_xor_si128(a, sign), count);
+    return _mm_xor_si128(a, sign);
+  }
+
+  // divExp2RoundHalfInf(a, shift) of each lane, for shift > 0.
+  inline __m128i vDivExp2RoundHalfInf(__m128i a, int shift)
+  {
+    __m128i sign = sign64(a);
+    __m128i mag = _mm_sub_epi64(_mm_xor_si128(a, sign), sign);
+    mag = _mm_add_epi64(mag, _mm_set1_epi64x(1ll << (shift - 1)));
+    mag = _mm_srl_epi64(mag, _mm_cvtsi32_si128(shift));
+    return _mm_sub_epi64(_mm_xor_si128(mag, sign), sign);
+  }
+
+  // A Vec3<int64_t> is held as two vectors: {x, y} and {z, 0}
+  inline void load(const Vec3<int64_t>& v, __m128i* xy, __m128i* z)
+  {
+    *xy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&v[0]));
+    *z = _mm_cvtsi64_si128(v[2]);
+  }
+
+  inline void store(Vec3<int64_t>& v, __m128i xy, __m128i z)
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&v[0]), xy);
+    v[2] = _mm_cvtsi128_si64(z);
+  }
+}  // namespace
+
+#endif
+
+//============================================================================
+// Scalar implementations, also used for any remainder of a vector loop.
+
+namespace {
+  template<typename T>
+  void liftPredictScalar(
+    const PredictorStore& predictors,
+    size_t startIndex,
+    size_t endIndex,
+    size_t beginIndex,
+    bool direct,
+    T* attributes)
+  {
+    // NB: startIndex is only used to check the neighbour indexes
+    (void)startIndex;
+
+    const uint32_t* predictorIndex = predictors.predictorIndex.data();
+    const uint32_t* weight = predictors.weight.data();
+    for (size_t i = beginIndex; i < endIndex; ++i) {
+      T predicted(T(0));
+      for (size_t n = i * kStride; n < (i + 1) * kStride; ++n) {
+        const uint32_t neighIndex = predictorIndex[n] & kIndexMask;
+        assert(neighIndex < startIndex);
+        predicted += weight[n] * attributes[neighIndex];
+      }
+      predicted = divExp2RoundHalfInf(predicted, kFixedPointWeightShift);
+      if (direct) {
+        attributes[i] -= predicted;
+      } else {
+        attributes[i] += predicted;
+      }
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  // Accumulate the updates of the attributes [0, startIndex).
+
+  template<typename T>
+  void liftUpdateAccumulate(
+    const PredictorStore& predictors,
+    const uint64_t* quantizationWeights,
+    size_t startIndex,
+    size_t endIndex,
+    const T* attributes,
+    std::vector<uint64_t>& updateWeights,
+    std::vector<T>& updates)
+  {
+    updateWeights.assign(startIndex, uint64_t(0));
+    updates.assign(startIndex, T(0));
+
+    const uint32_t* predictorIndex = predictors.predictorIndex.data();
+    const uint32_t* weight = predictors.weight.data();
+    for (size_t i = startIndex; i < endIndex; ++i) {
+      const uint64_t currentQuantWeight = quantizationWeights[i];
+      for (size_t n = i * kStride; n < (i + 1) * kStride; ++n) {
+        const auto neighWeight = divExp2RoundHalfInf(
+          weight[n] * currentQuantWeight, kFixedPointWeightShift);
+        const uint32_t neighIndex = predictorIndex[n] & kIndexMask;
+        assert(neighIndex < startIndex);
+        updateWeights[neighIndex] += neighWeight;
+        updates[neighIndex] += neighWeight * attributes[i];
+      }
+    }
+  }
+
+  //--------------------------------------------------------------------------
+
+  template<typename T>
+  void liftUpdateApplyScalar(
+    const std::vector<uint64_t>& updateWeights,
+    const std::vector<T>& updates,
+    size_t beginIndex,
+    bool direct,
+    T* attributes)
+  {
+    for (size_t i = beginIndex; i < updates.size(); ++i) {
+      const uint32_t sumWeights = updateWeights[i];
+      if (!sumWeights)
+        continue;
+
+      const auto update = divApprox(updates[i], sumWeights, 0);
+      if (direct) {
+        attributes[i] += update;
+      } else {
+        attributes[i] -= update;
+      }
+    }
+  }
+}  // namespace
+
+//============================================================================
+
+void
+liftPredict(
+  const PredictorStore& predictors,
+  size_t startIndex,
+  size_t endIndex,
+  bool direct,
+  int64_t* attributes)
+{
+  size_t i = startIndex;
+
+#if __AVX2__
+  // Four predictors at a time, gathering the k-th neighbour of each
+  const int stride = int(kStride);
+  const __m128i offsets = _mm_setr_epi32(0, stride, 2 * stride, 3 * stride);
+  const __m128i indexMask = _mm_set1_epi32(kIndexMask);
+  const auto* predictorIndex =
+    reinterpret_cast<const int*>(predictors.predictorIndex.data());
+  const auto* weight = reinterpret_cast<const int*>(predictors.weight.data());
+  const auto* base = reinterpret_cast<const long long*>(attributes);
+
+  for (; i + 4 <= endIndex; i += 4) {
+    __m256i predicted = _mm256_setzero_si256();
+    for (size_t k = 0; k < kStride; ++k) {
+      const size_t n = i * kStride + k;
+      __m128i idx = _mm_i32gather_epi32(predictorIndex + n, offsets, 4);
+      idx = _mm_and_si128(idx, indexMask);
+      __m128i w = _mm_i32gather_epi32(weight + n, offsets, 4);
+      __m256i neigh = _mm256_i32gather_epi64(base, idx, 8);
+      predicted = _mm256_add_epi64(
+        predicted, mul64x32(neigh, _mm256_cvtepu32_epi64(w)));
+    }
+    predicted = vDivExp2RoundHalfInf(predicted, kFixedPointWeightShift);
+
+    auto* ptr = reinterpret_cast<__m256i*>(attributes + i);
+    __m256i attr = _mm256_loadu_si256(ptr);
+    if (direct)
+      attr = _mm256_sub_epi64(attr, predicted);
+    else
+      attr = _mm256_add_epi64(attr, predicted);
+    _mm256_storeu_si256(ptr, attr);
+  }
+#elif __SSE4_1__
+  // Two predictors at a time
+  const uint32_t* predictorIndex = predictors.predictorIndex.data();
+  const uint32_t* weight = predictors.weight.data();
+
+  for (; i + 2 <= endIndex; i += 2) {
+    __m128i predicted = _mm_setzero_si128();
+    for (size_t k = 0; k < kStride; ++k) {
+      const size_t n0 = i * kStride + k;
+      const size_t n1 = n0 + kStride;
+      const uint32_t neighIndex0 = predictorIndex[n0] & kIndexMask;
+      const uint32_t neighIndex1 = predictorIndex[n1] & kIndexMask;
+      __m128i neigh = _mm_cvtsi64_si128(attributes[neighIndex0]);
+      neigh = _mm_insert_epi64(neigh, attributes[neighIndex1], 1);
+      __m128i w = _mm_set_epi64x(weight[n1], weight[n0]);
+      predicted = _mm_add_epi64(predicted, mul64x32(neigh, w));
+    }
+    predicted = vDivExp2RoundHalfInf(predicted, kFixedPointWeightShift);
+
+    auto* ptr = reinterpret_cast<__m128i*>(attributes + i);
+    __m128i attr = _mm_loadu_si128(ptr);
+    if (direct)
+      attr = _mm_sub_epi64(attr, predicted);
+    else
+      attr = _mm_add_epi64(attr, predicted);
+    _mm_storeu_si128(ptr, attr);
+  }
+#endif
+
+  liftPredictScalar(predictors, startIndex, endIndex, i, direct, attributes);
+}
+
+//----------------------------------------------------------------------------
+
+void
+liftPredict(
+  const PredictorStore& predictors,
+  size_t startIndex,
+  size_t endIndex,
+  bool direct,
+  Vec3<int64_t>* attributes)
+{
+  size_t i = startIndex;
+
+#if __AVX2__
+  // The components of each attribute are processed together
+  const uint32_t* predictorIndex = predictors.predictorIndex.data();
+  const uint32_t* weight = predictors.weight.data();
+
+  for (; i < endIndex; ++i) {
+    __m256i predicted = _mm256_setzero_si256();
+    for (size_t n = i * kStride; n < (i + 1) * kStride; ++n) {
+      const uint32_t neighIndex = predictorIndex[n] & kIndexMask;
+      assert(neighIndex < startIndex);
+      __m256i neigh = load(attributes[neighIndex]);
+      __m256i w = _mm256_set1_epi64x(weight[n]);
+      predicted = _mm256_add_epi64(predicted, mul64x32(neigh, w));
+    }
+    predicted = vDivExp2RoundHalfInf(predicted, kFixedPointWeightShift);
+
+    __m256i attr = load(attributes[i]);
+    if (direct)
+      attr = _mm256_sub_epi64(attr, predicted);
+    else
+      attr = _mm256_add_epi64(attr, predicted);
+    store(attributes[i], attr);
+  }
+#elif __SSE4_1__
+  const uint32_t* predictorIndex = predictors.predictorIndex.data();
+  const uint32_t* weight = predictors.weight.data();
+
+  for (; i < endIndex; ++i) {
+    __m128i predictedXy = _mm_setzero_si128();
+    __m128i predictedZ = _mm_setzero_si128();
+    for (size_t n = i * kStride; n < (i + 1) * kStride; ++n) {
+      const uint32_t neighIndex = predictorIndex[n] & kIndexMask;
+      assert(neighIndex < startIndex);
+      __m128i neighXy, neighZ;
+      load(attributes[neighIndex], &neighXy, &neighZ);
+      __m128i w = _mm_set1_epi64x(weight[n]);
+      predictedXy = _mm_add_epi64(predictedXy, mul64x32(neighXy, w));
+      predictedZ = _mm_add_epi64(predictedZ, mul64x32(neighZ, w));
+    }
+    predictedXy = vDivExp2RoundHalfInf(predictedXy, kFixedPointWeightShift);
+    predictedZ = vDivExp2RoundHalfInf(predictedZ, kFixedPointWeightShift);
+
+    __m128i attrXy, attrZ;
+    load(attributes[i], &attrXy, &attrZ);
+    if (direct) {
+      attrXy = _mm_sub_epi64(attrXy, predictedXy);
+      attrZ = _mm_sub_epi64(attrZ, predictedZ);
+    } else {
+      attrXy = _mm_add_epi64(attrXy, predictedXy);
+      attrZ = _mm_add_epi64(attrZ, predictedZ);
+    }
+    store(attributes[i], attrXy, attrZ);
+  }
+#endif
+
+  liftPredictScalar(predictors, startIndex, endIndex, i, direct, attributes);
+}
+
+//----------------------------------------------------------------------------
+
+void
+liftUpdate(
+  const PredictorStore& predictors,
+  const uint64_t* quantizationWeights,
+  size_t startIndex,
+  size_t endIndex,
+  bool direct,
+  int64_t* attributes)
+{
+  std::vector<uint64_t> updateWeights;
+  std::vector<int64_t> updates;
+  liftUpdateAccumulate(
+    predictors, quantizationWeights, startIndex, endIndex, attributes,
+    updateWeights, updates);
+
+  liftUpdateApplyScalar(updateWeights, updates, 0, direct, attributes);
+}
+
+//----------------------------------------------------------------------------
+
+void
+liftUpdate(
+  const PredictorStore& predictors,
+  const uint64_t* quantizationWeights,
+  size_t startIndex,
+  size_t endIndex,
+  bool direct,
+  Vec3<int64_t>* attributes)
+{
+  std::vector<uint64_t> updateWeights;
+  std::vector<Vec3<int64_t>> updates;
+  liftUpdateAccumulate(
+    predictors, quantizationWeights, startIndex, endIndex, attributes,
+    updateWeights, updates);
+
+  size_t i = 0;
+
+#if __AVX2__ || __SSE4_1__
+  // NB: the reciprocal of the weight sum is common to each component,
+  //     and is less than 2^32.
+  for (; i < startIndex; ++i) {
+    const uint32_t sumWeights = updateWeights[i];
+    if (!sumWeights)
+      continue;
+
+    int32_t log2InvScale;
+    const int64_t invSumWeights =
+      divInvDivisorApprox(sumWeights, log2InvScale);
+
+#  if __AVX2__
+    __m256i w = _mm256_set1_epi64x(invSumWeights);
+    __m256i update = sra64(mul64x32(load(updates[i]), w), log2InvScale);
+    __m256i attr = load(attributes[i]);
+    if (direct)
+      attr = _mm256_add_epi64(attr, update);
+    else
+      attr = _mm256_sub_epi64(attr, update);
+    store(attributes[i], attr);
+#  else
+    __m128i w = _mm_set1_epi64x(invSumWeights);
+    __m128i updateXy, updateZ;
+    load(updates[i], &updateXy, &updateZ);
+    updateXy = sra64(mul64x32(updateXy, w), log2InvScale);
+    updateZ = sra64(mul64x32(updateZ, w), log2InvScale);
+
+    __m128i attrXy, attrZ;
+    load(attributes[i], &attrXy, &attrZ);
+    if (direct) {
+      attrXy = _mm_add_epi64(attrXy, updateXy);
+      attrZ = _mm_add_epi64(attrZ, updateZ);
+    } else {
+      attrXy = _mm_sub_epi64(attrXy, updateXy);
+      attrZ = _mm_sub_epi64(attrZ, updateZ);
+    }
+    store(attributes[i], attrXy, attrZ);
+#  endif
+  }
+#endif
+
+  liftUpdateApplyScalar(updateWeights, updates, i, direct, attributes);
+}
+
+//============================================================================
+
+}  // namespace pcc
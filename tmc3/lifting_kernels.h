@@ -0,0 +1,92 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2020, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PCCMath.h"
+#include "predictor_store.h"
+
+namespace pcc {
+
+//============================================================================
+// Lifting transform kernels.  The implementation is selected at compile time
+// (see LIFTING_SIMD in tmc3/CMakeLists.txt) and is bit-exact with the
+// integer arithmetic of the scalar implementation.
+
+// Prediction step for the predictors [startIndex, endIndex), whose
+// neighbours all precede startIndex.  Each attribute is reduced (direct)
+// or increased by the weighted average of its neighbours.
+void liftPredict(
+  const PredictorStore& predictors,
+  size_t startIndex,
+  size_t endIndex,
+  bool direct,
+  int64_t* attributes);
+
+void liftPredict(
+  const PredictorStore& predictors,
+  size_t startIndex,
+  size_t endIndex,
+  bool direct,
+  Vec3<int64_t>* attributes);
+
+//----------------------------------------------------------------------------
+// Update step for the predictors [startIndex, endIndex).  Each attribute
+// in [0, startIndex) is increased (direct) or reduced by the weighted
+// average of the attributes that it predicts.
+
+void liftUpdate(
+  const PredictorStore& predictors,
+  const uint64_t* quantizationWeights,
+  size_t startIndex,
+  size_t endIndex,
+  bool direct,
+  int64_t* attributes);
+
+void liftUpdate(
+  const PredictorStore& predictors,
+  const uint64_t* quantizationWeights,
+  size_t startIndex,
+  size_t endIndex,
+  bool direct,
+  Vec3<int64_t>* attributes);
+
+//============================================================================
+
+}  // namespace pcc
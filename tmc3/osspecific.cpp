@@ -35,9 +35,13 @@
 
 #include "osspecific.h"
 
+#include <fstream>
+
 #if _POSIX_C_SOURCE
 #  include <fcntl.h>
+#  include <sys/mman.h>
 #  include <sys/stat.h>
+#  include <unistd.h>
 #endif
 
 #if _WIN32
@@ -61,3 +65,85 @@ pcc::mkdir(const char* path)
   return ::mkdir(path, 0775);
 }
 #endif
+
+//============================================================================
+
+#if _POSIX_C_SOURCE
+bool
+pcc::MappedFile::open(const char* path)
+{
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    return false;
+  }
+
+  // NB: an empty file cannot be mapped
+  _size = st.st_size;
+  if (_size) {
+    void* addr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      ::close(fd);
+      _size = 0;
+      return false;
+    }
+    _data = static_cast<const char*>(addr);
+    _mapped = true;
+  }
+
+  // NB: the mapping remains valid after the file is closed
+  ::close(fd);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+void
+pcc::MappedFile::close()
+{
+  if (_mapped)
+    munmap(const_cast<char*>(_data), _size);
+
+  _mapped = false;
+  _data = nullptr;
+  _size = 0;
+  _buffer = std::vector<char>();
+}
+#else
+bool
+pcc::MappedFile::open(const char* path)
+{
+  close();
+
+  std::ifstream fin(path, std::ios::binary | std::ios::ate);
+  if (!fin)
+    return false;
+
+  _buffer.resize(size_t(fin.tellg()));
+  fin.seekg(0);
+  if (!fin.read(_buffer.data(), _buffer.size())) {
+    _buffer = std::vector<char>();
+    return false;
+  }
+
+  _data = _buffer.data();
+  _size = _buffer.size();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+void
+pcc::MappedFile::close()
+{
+  _data = nullptr;
+  _size = 0;
+  _buffer = std::vector<char>();
+}
+#endif
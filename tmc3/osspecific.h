@@ -35,9 +35,42 @@
 
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
 namespace pcc {
 
 // Create a directory at the given path.
 int mkdir(const char* path);
 
+//============================================================================
+// Read-only access to the contents of a file.  Where supported, the file is
+// mapped into memory, otherwise its contents are read into a buffer.
+
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() { close(); }
+
+  // Map the file at path, replacing any existing mapping.
+  // Returns false if the file cannot be read.
+  bool open(const char* path);
+  void close();
+
+  const char* data() const { return _data; }
+  size_t size() const { return _size; }
+
+private:
+  const char* _data = nullptr;
+  size_t _size = 0;
+
+  // Indicates that _data is a mapping that must be released
+  bool _mapped = false;
+
+  // Storage for the file contents when the file is not mapped
+  std::vector<char> _buffer;
+};
+
 } /* namespace pcc */
\ No newline at end of file
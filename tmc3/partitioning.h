@@ -103,6 +103,11 @@ struct Partition {
 
   // Point indexes of the source point cloud that form this partition.
   std::vector<int32_t> pointIndexes;
+
+  // Once the source point cloud is ordered by partition, the partition
+  // comprises the points [pointBegin, pointEnd).
+  int pointBegin;
+  int pointEnd;
 };
 
 //----------------------------------------------------------------------------
@@ -37,9 +37,18 @@
 
 #include "PCCMisc.h"
 #include "PCCPointSet.h"
+#include "osspecific.h"
+#include "thread_pool.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <numeric>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace pcc {
@@ -85,6 +94,367 @@ getTokens(
 
 //============================================================================
 
+namespace {
+  enum AttributeType
+  {
+    ATTRIBUTE_TYPE_FLOAT64 = 0,
+    ATTRIBUTE_TYPE_FLOAT32 = 1,
+    ATTRIBUTE_TYPE_UINT64 = 2,
+    ATTRIBUTE_TYPE_UINT32 = 3,
+    ATTRIBUTE_TYPE_UINT16 = 4,
+    ATTRIBUTE_TYPE_UINT8 = 5,
+    ATTRIBUTE_TYPE_INT64 = 6,
+    ATTRIBUTE_TYPE_INT32 = 7,
+    ATTRIBUTE_TYPE_INT16 = 8,
+    ATTRIBUTE_TYPE_INT8 = 9,
+  };
+
+  struct AttributeInfo {
+    std::string name;
+    AttributeType type;
+    size_t byteCount;
+
+    // Offset of the property within a binary record
+    size_t offset;
+  };
+}  // namespace
+
+//============================================================================
+// Decode count values of type Src from a binary column with a stride of
+// srcStride bytes, storing each converted value to every dstStride-th
+// element of dst.
+
+template<typename Src, typename Dst>
+static void
+decodeColumn(
+  const char* src, size_t srcStride, Dst* dst, size_t dstStride, size_t count)
+{
+  for (size_t i = 0; i < count; i++, src += srcStride, dst += dstStride) {
+    Src val;
+    std::memcpy(&val, src, sizeof(Src));
+    *dst = Dst(val);
+  }
+}
+
+//----------------------------------------------------------------------------
+
+template<typename Dst>
+static void
+decodeColumn(
+  AttributeType type,
+  const char* src,
+  size_t srcStride,
+  Dst* dst,
+  size_t dstStride,
+  size_t count)
+{
+  switch (type) {
+  case ATTRIBUTE_TYPE_FLOAT64:
+    decodeColumn<double>(src, srcStride, dst, dstStride, count);
+    break;
+  case ATTRIBUTE_TYPE_FLOAT32:
+    decodeColumn<float>(src, srcStride, dst, dstStride, count);
+    break;
+  case ATTRIBUTE_TYPE_UINT64:
+    decodeColumn<uint64_t>(src, srcStride, dst, dstStride, count);
+    break;
+  case ATTRIBUTE_TYPE_UINT32:
+    decodeColumn<uint32_t>(src, srcStride, dst, dstStride, count);
+    break;
+  case ATTRIBUTE_TYPE_UINT16:
+    decodeColumn<uint16_t>(src, srcStride, dst, dstStride, count);
+    break;
+  case ATTRIBUTE_TYPE_UINT8:
+    decodeColumn<uint8_t>(src, srcStride, dst, dstStride, count);
+    break;
+  case ATTRIBUTE_TYPE_INT64:
+    decodeColumn<int64_t>(src, srcStride, dst, dstStride, count);
+    break;
+  case ATTRIBUTE_TYPE_INT32:
+    decodeColumn<int32_t>(src, srcStride, dst, dstStride, count);
+    break;
+  case ATTRIBUTE_TYPE_INT16:
+    decodeColumn<int16_t>(src, srcStride, dst, dstStride, count);
+    break;
+  case ATTRIBUTE_TYPE_INT8:
+    decodeColumn<int8_t>(src, srcStride, dst, dstStride, count);
+    break;
+  }
+}
+
+//============================================================================
+// Helpers for parsing ascii ply records.  Each record is a single line of
+// values delimited by the separators " \t\r".
+
+typedef std::pair<const char*, const char*> Token;
+
+static bool
+isSeparator(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+//----------------------------------------------------------------------------
+// The start of the line following the line containing ptr, or end.
+
+static const char*
+nextLine(const char* ptr, const char* end)
+{
+  auto lineEnd = static_cast<const char*>(std::memchr(ptr, '\n', end - ptr));
+  return lineEnd ? lineEnd + 1 : end;
+}
+
+//----------------------------------------------------------------------------
+// Find up to maxTokens tokens in the line starting at ptr, returning the
+// number of tokens found.  ptr is advanced to the start of the next line.
+
+static size_t
+findTokens(const char*& ptr, const char* end, Token* tokens, size_t maxTokens)
+{
+  size_t numTokens = 0;
+  while (numTokens < maxTokens) {
+    while (ptr != end && isSeparator(*ptr))
+      ptr++;
+    if (ptr == end || *ptr == '\n')
+      break;
+
+    const char* tokenBegin = ptr;
+    while (ptr != end && !isSeparator(*ptr) && *ptr != '\n')
+      ptr++;
+    tokens[numTokens++] = Token(tokenBegin, ptr);
+  }
+
+  ptr = nextLine(ptr, end);
+  return numTokens;
+}
+
+//----------------------------------------------------------------------------
+// The number of lines in [ptr, end) that contain at least one token.
+
+static size_t
+countRecords(const char* ptr, const char* end)
+{
+  size_t count = 0;
+  while (ptr != end) {
+    while (ptr != end && isSeparator(*ptr))
+      ptr++;
+    if (ptr == end)
+      break;
+
+    count += *ptr != '\n';
+    ptr = nextLine(ptr, end);
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------------
+// Equivalent to atoi() applied to token.
+
+static int
+parseInt(Token token)
+{
+  const char* ptr = token.first;
+  bool negative = false;
+  if (ptr != token.second && (*ptr == '-' || *ptr == '+'))
+    negative = *ptr++ == '-';
+
+  unsigned value = 0;
+  for (; ptr != token.second && unsigned(*ptr - '0') < 10; ptr++)
+    value = value * 10 + unsigned(*ptr - '0');
+
+  return int(negative ? 0u - value : value);
+}
+
+//----------------------------------------------------------------------------
+// Equivalent to int32_t(atof()) applied to token.
+//
+// Plain decimal values are truncated directly, unless the fractional part
+// may round up to the next integer when converted to a double.  Anything
+// else is converted using strtod().
+
+static int32_t
+parsePosition(Token token)
+{
+  const char* ptr = token.first;
+  bool negative = false;
+  if (ptr != token.second && (*ptr == '-' || *ptr == '+'))
+    negative = *ptr++ == '-';
+
+  int numDigits = 0;
+  int64_t intPart = 0;
+  for (; ptr != token.second && unsigned(*ptr - '0') < 10; ptr++) {
+    intPart = intPart * 10 + (*ptr - '0');
+    numDigits++;
+  }
+
+  // NB: a fraction starting with six nines may round up
+  int numFracDigits = 0;
+  int numLeadingNines = 0;
+  if (ptr != token.second && *ptr == '.') {
+    for (ptr++; ptr != token.second && unsigned(*ptr - '0') < 10; ptr++) {
+      if (numFracDigits++ == numLeadingNines && *ptr == '9')
+        numLeadingNines++;
+    }
+  }
+
+  bool isPlainDecimal = ptr == token.second && numDigits + numFracDigits
+    && numDigits < 10 && numLeadingNines < 6;
+
+  if (isPlainDecimal)
+    return int32_t(negative ? -intPart : intPart);
+
+  std::string str(token.first, token.second);
+  return int32_t(strtod(str.c_str(), nullptr));
+}
+
+//============================================================================
+// Helpers for formatting ply records.
+
+// Write the decimal representation of value to out, returning the end.
+
+static char*
+formatUint(uint64_t value, char* out)
+{
+  char digits[20];
+  int numDigits = 0;
+  do {
+    digits[numDigits++] = char('0' + value % 10);
+    value /= 10;
+  } while (value);
+
+  while (numDigits)
+    *out++ = digits[--numDigits];
+  return out;
+}
+
+//----------------------------------------------------------------------------
+// Write value to out as formatted by printf("%.5f"), returning the end.
+// NB: out must have space for the longest such representation.
+//
+// Values that are multiples of 1/32 are formatted directly, since their
+// fractional part has an exact five digit decimal representation.
+
+static char*
+formatFixed5(double value, char* out)
+{
+  double scaled = value * 32;
+  bool isMultiple = std::fabs(scaled) < double(int64_t(1) << 52)
+    && scaled == double(int64_t(scaled));
+
+  if (isMultiple) {
+    int64_t fixed = int64_t(scaled);
+    if (std::signbit(value))
+      *out++ = '-';
+
+    uint64_t magnitude = fixed < 0 ? 0 - uint64_t(fixed) : uint64_t(fixed);
+    out = formatUint(magnitude >> 5, out);
+
+    // NB: 1/32 = 0.03125
+    uint32_t fraction = uint32_t(magnitude & 31) * 3125;
+    *out++ = '.';
+    for (int i = 4; i >= 0; i--, fraction /= 10)
+      out[i] = char('0' + fraction % 10);
+    return out + 5;
+  }
+
+  return out + sprintf(out, "%.5f", value);
+}
+
+//----------------------------------------------------------------------------
+// Format the points [begin, end) of cloud as ascii ply records in buf.
+
+static void
+formatAscii(
+  const PCCPointSet3& cloud,
+  double positionScale,
+  Vec3<double> positionOffset,
+  size_t begin,
+  size_t end,
+  std::vector<char>* buf)
+{
+  buf->clear();
+
+  // NB: enough for three maximal doubles and the attribute values
+  char line[1024];
+  for (size_t i = begin; i < end; i++) {
+    Vec3<double> position = cloud[i] * positionScale + positionOffset;
+
+    char* ptr = line;
+    for (int k = 0; k < 3; k++) {
+      if (k)
+        *ptr++ = ' ';
+      ptr = formatFixed5(position[k], ptr);
+    }
+
+    if (cloud.hasColors()) {
+      const auto& color = cloud.getColor(i);
+      for (int k = 0; k < 3; k++) {
+        *ptr++ = ' ';
+        ptr = formatUint(color[k], ptr);
+      }
+    }
+
+    if (cloud.hasReflectances()) {
+      *ptr++ = ' ';
+      ptr = formatUint(cloud.getReflectance(i), ptr);
+    }
+
+    if (cloud.hasFrameIndex()) {
+      *ptr++ = ' ';
+      ptr = formatUint(cloud.getFrameIndex(i), ptr);
+    }
+
+    *ptr++ = '\n';
+    buf->insert(buf->end(), line, ptr);
+  }
+}
+
+//----------------------------------------------------------------------------
+// Pack the points [begin, end) of cloud as binary ply records in buf.
+
+static void
+formatBinary(
+  const PCCPointSet3& cloud,
+  double positionScale,
+  Vec3<double> positionOffset,
+  size_t begin,
+  size_t end,
+  std::vector<char>* buf)
+{
+  size_t recordSize = 3 * sizeof(double);
+  if (cloud.hasColors())
+    recordSize += 3 * sizeof(uint8_t);
+  if (cloud.hasReflectances())
+    recordSize += sizeof(uint16_t);
+  if (cloud.hasFrameIndex())
+    recordSize += sizeof(uint8_t);
+
+  buf->resize((end - begin) * recordSize);
+  char* ptr = buf->data();
+  for (size_t i = begin; i < end; i++) {
+    Vec3<double> position = cloud[i] * positionScale + positionOffset;
+    std::memcpy(ptr, &position, 3 * sizeof(double));
+    ptr += 3 * sizeof(double);
+
+    if (cloud.hasColors()) {
+      const auto& color = cloud.getColor(i);
+      for (int k = 0; k < 3; k++)
+        *ptr++ = char(uint8_t(color[k]));
+    }
+
+    if (cloud.hasReflectances()) {
+      uint16_t reflectance = cloud.getReflectance(i);
+      std::memcpy(ptr, &reflectance, sizeof(uint16_t));
+      ptr += sizeof(uint16_t);
+    }
+
+    if (cloud.hasFrameIndex())
+      *ptr++ = char(cloud.getFrameIndex(i));
+  }
+}
+
+//============================================================================
+
 bool
 ply::write(
   const PCCPointSet3& cloud,
@@ -92,7 +462,8 @@ ply::write(
   double positionScale,
   Vec3<double> positionOffset,
   const std::string& fileName,
-  bool asAscii)
+  bool asAscii,
+  ThreadPool* threadPool)
 {
   std::ofstream fout(fileName, std::ofstream::out);
   if (!fout.is_open()) {
@@ -137,50 +508,44 @@ ply::write(
   fout << "element face 0" << std::endl;
   fout << "property list uint8 int32 vertex_index" << std::endl;
   fout << "end_header" << std::endl;
-  if (asAscii) {
-    //      fout << std::setprecision(std::numeric_limits<double>::max_digits10);
-    fout << std::fixed << std::setprecision(5);
-    for (size_t i = 0; i < pointCount; ++i) {
-      Vec3<double> position = cloud[i] * positionScale + positionOffset;
-      fout << position.x() << " " << position.y() << " " << position.z();
-      if (cloud.hasColors()) {
-        const Vec3<attr_t>& color = cloud.getColor(i);
-        fout << " " << static_cast<int>(color[0]) << " "
-             << static_cast<int>(color[1]) << " "
-             << static_cast<int>(color[2]);
-      }
-      if (cloud.hasReflectances()) {
-        fout << " " << static_cast<int>(cloud.getReflectance(i));
-      }
-      if (cloud.hasFrameIndex()) {
-        fout << " " << static_cast<int>(cloud.getFrameIndex(i));
-      }
-      fout << std::endl;
-    }
-  } else {
+
+  if (!asAscii) {
     fout.clear();
     fout.close();
     fout.open(fileName, std::ofstream::binary | std::ofstream::app);
-    for (size_t i = 0; i < pointCount; ++i) {
-      Vec3<double> position = cloud[i] * positionScale + positionOffset;
-      fout.write(
-        reinterpret_cast<const char* const>(&position), sizeof(double) * 3);
-      if (cloud.hasColors()) {
-        const Vec3<attr_t>& c = cloud.getColor(i);
-        Vec3<uint8_t> val8b{uint8_t(c[0]), uint8_t(c[1]), uint8_t(c[2])};
-        fout.write(reinterpret_cast<const char*>(&val8b), sizeof(uint8_t) * 3);
-      }
-      if (cloud.hasReflectances()) {
-        const attr_t& reflectance = cloud.getReflectance(i);
-        fout.write(
-          reinterpret_cast<const char*>(&reflectance), sizeof(uint16_t));
-      }
-      if (cloud.hasFrameIndex()) {
-        const uint16_t& findex = cloud.getFrameIndex(i);
-        fout.write(reinterpret_cast<const char*>(&findex), sizeof(uint16_t));
+  }
+
+  // The points are formatted in chunks, concurrently if a thread pool is
+  // provided, with each chunk written using a single call.
+  const size_t kChunkSize = 1 << 16;
+  size_t numBuffers = threadPool ? threadPool->numThreads() : 1;
+  std::vector<std::vector<char>> buffers(numBuffers);
+
+  for (size_t first = 0; first < pointCount;) {
+    size_t numChunks = std::min(
+      numBuffers, (pointCount - first + kChunkSize - 1) / kChunkSize);
+
+    parallelFor(threadPool, numChunks, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        size_t chunkBegin = first + i * kChunkSize;
+        size_t chunkEnd = std::min(chunkBegin + kChunkSize, pointCount);
+        if (asAscii)
+          formatAscii(
+            cloud, positionScale, positionOffset, chunkBegin, chunkEnd,
+            &buffers[i]);
+        else
+          formatBinary(
+            cloud, positionScale, positionOffset, chunkBegin, chunkEnd,
+            &buffers[i]);
       }
-    }
+    });
+
+    for (size_t i = 0; i < numChunks; i++)
+      fout.write(buffers[i].data(), buffers[i].size());
+
+    first += numChunks * kChunkSize;
   }
+
   fout.close();
   return true;
 }
@@ -191,31 +556,13 @@ bool
 ply::read(
   const std::string& fileName,
   const PropertyNameMap& attributeNames,
-  PCCPointSet3& cloud)
+  PCCPointSet3& cloud,
+  ThreadPool* threadPool)
 {
   std::ifstream ifs(fileName, std::ifstream::in | std::ifstream::binary);
   if (!ifs.is_open()) {
     return false;
   }
-  enum AttributeType
-  {
-    ATTRIBUTE_TYPE_FLOAT64 = 0,
-    ATTRIBUTE_TYPE_FLOAT32 = 1,
-    ATTRIBUTE_TYPE_UINT64 = 2,
-    ATTRIBUTE_TYPE_UINT32 = 3,
-    ATTRIBUTE_TYPE_UINT16 = 4,
-    ATTRIBUTE_TYPE_UINT8 = 5,
-    ATTRIBUTE_TYPE_INT64 = 6,
-    ATTRIBUTE_TYPE_INT32 = 7,
-    ATTRIBUTE_TYPE_INT16 = 8,
-    ATTRIBUTE_TYPE_INT8 = 9,
-  };
-  struct AttributeInfo {
-    std::string name;
-    AttributeType type;
-    size_t byteCount;
-  };
-
   std::vector<AttributeInfo> attributesInfo;
   attributesInfo.reserve(16);
   const size_t MAX_BUFFER_SIZE = 4096;
@@ -271,7 +618,7 @@ ply::read(
       attributesInfo.resize(attributeIndex + 1);
       AttributeInfo& attributeInfo = attributesInfo[attributeIndex];
       attributeInfo.name = propertyName;
-      if (propertyType == "float64") {
+      if (propertyType == "double" || propertyType == "float64") {
         attributeInfo.type = ATTRIBUTE_TYPE_FLOAT64;
         attributeInfo.byteCount = 8;
       } else if (propertyType == "float" || propertyType == "float32") {
@@ -280,10 +627,10 @@ ply::read(
       } else if (propertyType == "uint64") {
         attributeInfo.type = ATTRIBUTE_TYPE_UINT64;
         attributeInfo.byteCount = 8;
-      } else if (propertyType == "uint32") {
+      } else if (propertyType == "uint" || propertyType == "uint32") {
         attributeInfo.type = ATTRIBUTE_TYPE_UINT32;
         attributeInfo.byteCount = 4;
-      } else if (propertyType == "uint16") {
+      } else if (propertyType == "ushort" || propertyType == "uint16") {
         attributeInfo.type = ATTRIBUTE_TYPE_UINT16;
         attributeInfo.byteCount = 2;
       } else if (propertyType == "uchar" || propertyType == "uint8") {
@@ -292,10 +639,10 @@ ply::read(
       } else if (propertyType == "int64") {
         attributeInfo.type = ATTRIBUTE_TYPE_INT64;
         attributeInfo.byteCount = 8;
-      } else if (propertyType == "int32") {
+      } else if (propertyType == "int" || propertyType == "int32") {
         attributeInfo.type = ATTRIBUTE_TYPE_INT32;
         attributeInfo.byteCount = 4;
-      } else if (propertyType == "int16") {
+      } else if (propertyType == "short" || propertyType == "int16") {
         attributeInfo.type = ATTRIBUTE_TYPE_INT16;
         attributeInfo.byteCount = 2;
       } else if (propertyType == "char" || propertyType == "int8") {
@@ -381,110 +728,143 @@ ply::read(
   else
     cloud.removeFrameIndex();
 
+  // The point records follow the header
+  // NB: the header may end at the end of the file
+  ifs.clear();
+  size_t dataOffset = ifs.tellg();
+  ifs.close();
+
+  MappedFile file;
+  if (!file.open(fileName.c_str())) {
+    std::cout << "Error: can't read file!" << std::endl;
+    return false;
+  }
+
   cloud.resize(pointCount);
   if (isAscii) {
-    size_t pointCounter = 0;
-    while (!ifs.eof() && pointCounter < pointCount) {
-      ifs.getline(tmp, MAX_BUFFER_SIZE);
-      getTokens(tmp, sep, tokens);
-      if (tokens.empty()) {
-        continue;
-      }
-      if (tokens.size() < attributeCount) {
-        return false;
-      }
-      auto& position = cloud[pointCounter];
-      position[0] = atof(tokens[indexX].c_str());
-      position[1] = atof(tokens[indexY].c_str());
-      position[2] = atof(tokens[indexZ].c_str());
-      if (cloud.hasColors()) {
-        auto& color = cloud.getColor(pointCounter);
-        color[0] = atoi(tokens[indexG].c_str());
-        color[1] = atoi(tokens[indexB].c_str());
-        color[2] = atoi(tokens[indexR].c_str());
-      }
-      if (cloud.hasReflectances()) {
-        cloud.getReflectance(pointCounter) =
-          uint16_t(atoi(tokens[indexReflectance].c_str()));
-      }
-      if (cloud.hasFrameIndex()) {
-        cloud.getFrameIndex(pointCounter) =
-          uint8_t(atoi(tokens[indexFrame].c_str()));
-      }
-      ++pointCounter;
+    // The records are split into line aligned chunks.  Once the index of
+    // the first record in each chunk is known, they are parsed in parallel.
+    const char* data = file.data() + dataOffset;
+    const char* dataEnd = file.data() + file.size();
+    size_t numChunks = threadPool ? threadPool->numThreads() : 1;
+
+    std::vector<const char*> chunks(numChunks + 1, dataEnd);
+    chunks[0] = data;
+    for (size_t i = 1; i < numChunks; i++) {
+      const char* ptr = data + (dataEnd - data) * i / numChunks;
+      chunks[i] = nextLine(std::max(ptr, chunks[i - 1]), dataEnd);
     }
-  } else {
-    for (size_t pointCounter = 0; pointCounter < pointCount && !ifs.eof();
-         ++pointCounter) {
-      auto& position = cloud[pointCounter];
-      for (size_t a = 0; a < attributeCount && !ifs.eof(); ++a) {
-        const auto& attributeInfo = attributesInfo[a];
-        if (a == indexX) {
-          if (attributeInfo.byteCount == 4) {
-            float x;
-            ifs.read(reinterpret_cast<char*>(&x), sizeof(float));
-            position[0] = x;
-          } else {
-            double x;
-            ifs.read(reinterpret_cast<char*>(&x), sizeof(double));
-            position[0] = x;
-          }
-        } else if (a == indexY) {
-          if (attributeInfo.byteCount == 4) {
-            float y;
-            ifs.read(reinterpret_cast<char*>(&y), sizeof(float));
-            position[1] = y;
-          } else {
-            double y;
-            ifs.read(reinterpret_cast<char*>(&y), sizeof(double));
-            position[1] = y;
+
+    std::vector<size_t> firstRecord(numChunks + 1, 0);
+    parallelFor(threadPool, numChunks, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
+        firstRecord[i + 1] = countRecords(chunks[i], chunks[i + 1]);
+    });
+    std::partial_sum(
+      firstRecord.begin(), firstRecord.end(), firstRecord.begin());
+
+    // NB: a vector<bool> cannot be written concurrently
+    std::vector<int> chunkValid(numChunks, true);
+    parallelFor(threadPool, numChunks, [&](size_t begin, size_t end) {
+      std::vector<Token> tokens(attributeCount);
+      for (size_t i = begin; i < end; i++) {
+        size_t pointIdx = firstRecord[i];
+        const char* line = chunks[i];
+        while (line != chunks[i + 1] && pointIdx < pointCount) {
+          size_t numTokens =
+            findTokens(line, chunks[i + 1], tokens.data(), attributeCount);
+
+          if (!numTokens)
+            continue;
+
+          if (numTokens < attributeCount) {
+            chunkValid[i] = false;
+            break;
           }
-        } else if (a == indexZ) {
-          if (attributeInfo.byteCount == 4) {
-            float z;
-            ifs.read(reinterpret_cast<char*>(&z), sizeof(float));
-            position[2] = z;
-          } else {
-            double z;
-            ifs.read(reinterpret_cast<char*>(&z), sizeof(double));
-            position[2] = z;
+
+          auto& position = cloud[pointIdx];
+          position[0] = parsePosition(tokens[indexX]);
+          position[1] = parsePosition(tokens[indexY]);
+          position[2] = parsePosition(tokens[indexZ]);
+          if (withColors) {
+            auto& color = cloud.getColor(pointIdx);
+            color[0] = parseInt(tokens[indexG]);
+            color[1] = parseInt(tokens[indexB]);
+            color[2] = parseInt(tokens[indexR]);
           }
-        } else if (a == indexR && attributeInfo.byteCount == 1) {
-          uint8_t val8b;
-          ifs.read(reinterpret_cast<char*>(&val8b), sizeof(uint8_t));
-          cloud.getColor(pointCounter)[2] = val8b;
-        } else if (a == indexG && attributeInfo.byteCount == 1) {
-          uint8_t val8b;
-          ifs.read(reinterpret_cast<char*>(&val8b), sizeof(uint8_t));
-          cloud.getColor(pointCounter)[0] = val8b;
-        } else if (a == indexB && attributeInfo.byteCount == 1) {
-          uint8_t val8b;
-          ifs.read(reinterpret_cast<char*>(&val8b), sizeof(uint8_t));
-          cloud.getColor(pointCounter)[1] = val8b;
-        } else if (a == indexReflectance && attributeInfo.byteCount <= 2) {
-          if (attributeInfo.byteCount == 1) {
-            uint8_t reflectance;
-            ifs.read(reinterpret_cast<char*>(&reflectance), sizeof(uint8_t));
-            cloud.getReflectance(pointCounter) = reflectance;
-          } else {
-            auto& reflectance = cloud.getReflectance(pointCounter);
-            ifs.read(reinterpret_cast<char*>(&reflectance), sizeof(uint16_t));
+          if (withReflectances) {
+            cloud.getReflectance(pointIdx) =
+              uint16_t(parseInt(tokens[indexReflectance]));
           }
-        } else if (a == indexFrame && attributeInfo.byteCount <= 2) {
-          if (attributeInfo.byteCount == 1) {
-            auto& findex = cloud.getFrameIndex(pointCounter);
-            ifs.read(reinterpret_cast<char*>(&findex), sizeof(uint8_t));
-          } else {
-            uint16_t findex;
-            ifs.read(reinterpret_cast<char*>(&findex), sizeof(uint16_t));
-            cloud.getFrameIndex(pointCounter) = uint8_t(findex);
+          if (withFrameIndex) {
+            cloud.getFrameIndex(pointIdx) =
+              uint8_t(parseInt(tokens[indexFrame]));
           }
-        } else {
-          char buffer[128];
-          ifs.read(buffer, attributeInfo.byteCount);
+          pointIdx++;
         }
       }
+    });
+
+    for (auto valid : chunkValid)
+      if (!valid)
+        return false;
+  } else {
+    size_t recordSize = 0;
+    for (auto& attributeInfo : attributesInfo) {
+      attributeInfo.offset = recordSize;
+      recordSize += attributeInfo.byteCount;
+    }
+
+    if (file.size() < dataOffset + pointCount * recordSize) {
+      std::cout << "Error: corrupted file!" << std::endl;
+      return false;
     }
+
+    // Each property is decoded in turn for a range of points.
+    // NB: the components of each position or colour are decoded separately
+    static_assert(sizeof(point_t) == 3 * sizeof(int32_t), "Vec3 padding");
+    static_assert(sizeof(Vec3<attr_t>) == 3 * sizeof(attr_t), "Vec3 padding");
+
+    const char* records = file.data() + dataOffset;
+    const size_t indexPos[3] = {indexX, indexY, indexZ};
+    const size_t indexGbr[3] = {indexG, indexB, indexR};
+    parallelFor(threadPool, pointCount, [&](size_t begin, size_t end) {
+      if (begin == end)
+        return;
+
+      const char* src = records + begin * recordSize;
+      size_t count = end - begin;
+
+      for (int k = 0; k < 3; k++) {
+        const auto& info = attributesInfo[indexPos[k]];
+        decodeColumn(
+          info.type, src + info.offset, recordSize, &cloud[begin][k], 3,
+          count);
+      }
+
+      if (withColors) {
+        for (int k = 0; k < 3; k++) {
+          const auto& info = attributesInfo[indexGbr[k]];
+          decodeColumn(
+            info.type, src + info.offset, recordSize,
+            &cloud.getColor(begin)[k], 3, count);
+        }
+      }
+
+      if (withReflectances) {
+        const auto& info = attributesInfo[indexReflectance];
+        decodeColumn(
+          info.type, src + info.offset, recordSize,
+          &cloud.getReflectance(begin), 1, count);
+      }
+
+      if (withFrameIndex) {
+        const auto& info = attributesInfo[indexFrame];
+        decodeColumn(
+          info.type, src + info.offset, recordSize,
+          &cloud.getFrameIndex(begin), 1, count);
+      }
+    });
   }
   return true;
 }
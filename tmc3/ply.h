@@ -41,6 +41,9 @@
 #include "PCCPointSet.h"
 
 namespace pcc {
+
+class ThreadPool;
+
 namespace ply {
 
   //============================================================================
@@ -66,18 +69,25 @@ namespace ply {
   // @param positionOffset  offset for positions (after scaling).
   // @param fileName  output filename.
   // @param asAscii  PLY writing format (true => ascii, false => binary).
+  // @param threadPool  if not null, workers used to format the points.
   bool write(
     const PCCPointSet3& pointCloud,
     const PropertyNameMap& propertyNames,
     double positionScale,
     Vec3<double> positionOffset,
     const std::string& fileName,
-    bool asAscii);
+    bool asAscii,
+    ThreadPool* threadPool = nullptr);
 
+  ///
+  // Read a PLY file called @a fileName into @a cloud.
+  //
+  // @param threadPool  if not null, workers used to decode binary files.
   bool read(
     const std::string& fileName,
     const PropertyNameMap& propertyNames,
-    PCCPointSet3& cloud);
+    PCCPointSet3& cloud,
+    ThreadPool* threadPool = nullptr);
 
   //============================================================================
 
@@ -38,43 +38,103 @@
 #include "colourspace.h"
 #include "hls.h"
 #include "KDTreeVectorOfVectorsAdaptor.h"
+#include "thread_pool.h"
 
+#include <cmath>
 #include <cstddef>
 #include <set>
 #include <vector>
 #include <utility>
-#include <map>
+#include <mutex>
 
 namespace pcc {
 
+//============================================================================
+// A hash of a quantised position used to find duplicate points.
+
+static inline uint64_t
+hashPosition(const Vec3<int32_t>& pos)
+{
+  uint64_t hash = uint32_t(pos[0]) * 0x9E3779B97F4A7C15ull;
+  hash ^= uint32_t(pos[1]) * 0xC2B2AE3D27D4EB4Full;
+  hash ^= uint32_t(pos[2]) * 0x165667B19E3779F9ull;
+  return hash ^ (hash >> 29);
+}
+
 //============================================================================
 
 template<typename UniqueFn, typename QFn>
 SrcMappedPointSet
-reducePointSet(const PCCPointSet3& src, UniqueFn uniqueFn, QFn qFn)
+reducePointSet(
+  const PCCPointSet3& src, UniqueFn uniqueFn, QFn qFn, ThreadPool* threadPool)
 {
   SrcMappedPointSet dst;
   int numSrcPoints = src.getPointCount();
 
-  // Build a map of duplicate points
-  int numDstPoints = 0;
-  if (1) {
-    std::map<Vec3<int32_t>, int> qPosToSrcIdx;
-    dst.srcIdxDupList.resize(numSrcPoints);
-    for (int i = numSrcPoints - 1; i >= 0; i--) {
-      // Attempt to insert quantised position
-      auto res = qPosToSrcIdx.insert({uniqueFn(src[i]), i});
-
-      // Append to linked list of same positions.
-      // Index of the src point (i) or the index of the previous point with
-      // the same quantised position
-      dst.srcIdxDupList[res.first->second] ^= 0x80000000;
-      dst.srcIdxDupList[i] = res.first->second | 0x80000000;
-      res.first->second = i;
+  // Positions used to identify duplicate points
+  std::vector<Vec3<int32_t>> uniquePos(numSrcPoints);
+  std::vector<uint64_t> uniquePosHash(numSrcPoints);
+  parallelFor(threadPool, numSrcPoints, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      uniquePos[i] = uniqueFn(src[i]);
+      uniquePosHash[i] = hashPosition(uniquePos[i]);
     }
+  });
 
-    numDstPoints = qPosToSrcIdx.size();
-  }
+  // Link each point to the next point with the same position.
+  // Duplicate points are found using open addressing hash tables that
+  // record the last point with each position.  The points are partitioned
+  // by hash so that each table may be built concurrently.
+  //
+  // NB: the first point of each list is indicated by the sign bit.
+  dst.srcIdxDupList.resize(numSrcPoints);
+  int numPartitions = threadPool ? threadPool->numThreads() : 1;
+
+  auto partitionOf = [&](int i) {
+    return int((uniquePosHash[i] >> 32) % numPartitions);
+  };
+
+  auto linkDuplicates = [&](int partition) {
+    int numPoints = 0;
+    for (int i = 0; i < numSrcPoints; i++)
+      numPoints += partitionOf(i) == partition;
+
+    size_t tableSize = 1;
+    while (tableSize < 2 * size_t(numPoints))
+      tableSize <<= 1;
+
+    std::vector<int> lastSrcIdx(tableSize, -1);
+    for (int i = 0; i < numSrcPoints; i++) {
+      if (partitionOf(i) != partition)
+        continue;
+
+      size_t slot = uniquePosHash[i] & (tableSize - 1);
+      for (; lastSrcIdx[slot] >= 0; slot = (slot + 1) & (tableSize - 1)) {
+        if (uniquePos[lastSrcIdx[slot]] == uniquePos[i])
+          break;
+      }
+
+      int prevIdx = lastSrcIdx[slot];
+      lastSrcIdx[slot] = i;
+
+      if (prevIdx < 0) {
+        dst.srcIdxDupList[i] = i | 0x80000000;
+      } else {
+        dst.srcIdxDupList[i] = i;
+        dst.srcIdxDupList[prevIdx] &= 0x80000000;
+        dst.srcIdxDupList[prevIdx] |= i;
+      }
+    }
+  };
+
+  parallelFor(threadPool, numPartitions, [&](size_t begin, size_t end) {
+    for (size_t partition = begin; partition < end; partition++)
+      linkDuplicates(partition);
+  });
+
+  int numDstPoints = 0;
+  for (int i = 0; i < numSrcPoints; ++i)
+    numDstPoints += dst.srcIdxDupList[i] < 0;
 
   // Number of quantised points is now known
   dst.cloud.resize(numDstPoints);
@@ -106,7 +166,10 @@ reducePointSet(const PCCPointSet3& src, UniqueFn uniqueFn, QFn qFn)
 
 SrcMappedPointSet
 samplePositionsUniq(
-  const float scaleFactor, const Vec3<int> offset, const PCCPointSet3& src)
+  const float scaleFactor,
+  const Vec3<int> offset,
+  const PCCPointSet3& src,
+  ThreadPool* threadPool)
 {
   return reducePointSet(
     src,
@@ -115,7 +178,7 @@ samplePositionsUniq(
         point[k] = std::round(point[k] * scaleFactor);
       return point;
     },
-    [=](Vec3<int> point) { return point - offset; });
+    [=](Vec3<int> point) { return point - offset; }, threadPool);
 }
 
 //============================================================================
@@ -130,7 +193,8 @@ quantizePositionsUniq(
   const float scaleFactor,
   const Vec3<int> offset,
   const Box3<int> clamp,
-  const PCCPointSet3& src)
+  const PCCPointSet3& src,
+  ThreadPool* threadPool)
 {
   auto qFn = [=](Vec3<int> point) {
     for (int k = 0; k < 3; k++) {
@@ -140,7 +204,7 @@ quantizePositionsUniq(
     return point;
   };
 
-  return reducePointSet(src, qFn, qFn);
+  return reducePointSet(src, qFn, qFn, threadPool);
 }
 
 //============================================================================
@@ -208,6 +272,208 @@ clampVolume(Box3<double> bbox, PCCPointSet3* cloud)
   }
 }
 
+//============================================================================
+
+RecolourContext::RecolourContext(
+  const RecolourParams& cfg,
+  const PCCPointSet3& source,
+  double sourceToTargetScaleFactor,
+  point_t targetToSourceOffset,
+  const PCCPointSet3& target,
+  ThreadPool* threadPool)
+  : _sourcePointCount(source.getPointCount())
+  , _targetPointCount(target.getPointCount())
+  , _maxNeighboursFwd(cfg.numNeighboursFwd)
+  , _neighboursBwdOffset(_targetPointCount + 1)
+{
+  if (!_sourcePointCount || !_targetPointCount)
+    return;
+
+  double targetToSourceScaleFactor = 1.0 / sourceToTargetScaleFactor;
+
+  double maxGeometryDist2Fwd = cfg.maxGeometryDist2Fwd < 512
+    ? cfg.maxGeometryDist2Fwd
+    : std::numeric_limits<double>::max();
+  double maxGeometryDist2Bwd = cfg.maxGeometryDist2Bwd < 512
+    ? cfg.maxGeometryDist2Bwd
+    : std::numeric_limits<double>::max();
+
+  // Forward direction
+  // NB: once the furthest neighbour of a point exceeds maxGeometryDist2Fwd,
+  //     only the nearest neighbour is used for it and all later points.
+  KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeSource(
+    3, source, 10);
+  const int num_resultsFwd = cfg.numNeighboursFwd;
+  _neighboursFwd.resize(_targetPointCount * num_resultsFwd);
+  _numNeighboursFwd.resize(_targetPointCount);
+
+  size_t firstReducedFwd = _targetPointCount;
+  std::mutex firstReducedFwdMutex;
+
+  auto searchFwd = [&](size_t begin, size_t end) {
+    nanoflann::KNNResultSet<double> resultSetFwd(num_resultsFwd);
+    std::vector<size_t> indicesFwd(num_resultsFwd);
+    std::vector<double> sqrDistFwd(num_resultsFwd);
+    size_t firstReduced = _targetPointCount;
+
+    for (size_t index = begin; index < end; ++index) {
+      Vec3<double> posInSrc =
+        (target[index] + targetToSourceOffset) * targetToSourceScaleFactor;
+
+      resultSetFwd.init(&indicesFwd[0], &sqrDistFwd[0]);
+      kdtreeSource.index->findNeighbors(
+        resultSetFwd, &posInSrc[0], nanoflann::SearchParams(10));
+      int numNeighbours = int(resultSetFwd.size());
+
+      if (firstReduced > index && numNeighbours != 1) {
+        if (sqrDistFwd[numNeighbours - 1] > maxGeometryDist2Fwd)
+          firstReduced = index;
+      }
+
+      Neighbour* neighbours = &_neighboursFwd[index * num_resultsFwd];
+      for (int i = 0; i < numNeighbours; ++i)
+        neighbours[i] = Neighbour{sqrDistFwd[i], indicesFwd[i]};
+
+      _numNeighboursFwd[index] = firstReduced > index ? numNeighbours : 1;
+    }
+
+    std::lock_guard<std::mutex> lock(firstReducedFwdMutex);
+    firstReducedFwd = std::min(firstReducedFwd, firstReduced);
+  };
+
+  parallelFor(threadPool, _targetPointCount, searchFwd);
+
+  for (size_t index = firstReducedFwd + 1; index < _targetPointCount; ++index)
+    _numNeighboursFwd[index] = std::min(_numNeighboursFwd[index], 1);
+
+  // Backward direction
+  // The target points neighbouring each source point are found
+  // concurrently, then inverted in source point order.
+  KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeTarget(
+    3, target, 10);
+  const int num_resultsBwd = cfg.numNeighboursBwd;
+  std::vector<Neighbour> neighboursBwd(_sourcePointCount * num_resultsBwd);
+  std::vector<int> numNeighboursBwd(_sourcePointCount);
+
+  auto searchBwd = [&](size_t begin, size_t end) {
+    nanoflann::KNNResultSet<double> resultSetBwd(num_resultsBwd);
+    std::vector<size_t> indicesBwd(num_resultsBwd);
+    std::vector<double> sqrDistBwd(num_resultsBwd);
+
+    for (size_t index = begin; index < end; ++index) {
+      Vec3<double> posInTgt =
+        source[index] * sourceToTargetScaleFactor - targetToSourceOffset;
+
+      resultSetBwd.init(&indicesBwd[0], &sqrDistBwd[0]);
+      kdtreeTarget.index->findNeighbors(
+        resultSetBwd, &posInTgt[0], nanoflann::SearchParams(10));
+      int numNeighbours = int(resultSetBwd.size());
+
+      Neighbour* neighbours = &neighboursBwd[index * num_resultsBwd];
+      int count = 0;
+      for (int i = 0; i < numNeighbours; ++i) {
+        if (sqrDistBwd[i] <= maxGeometryDist2Bwd)
+          neighbours[count++] = Neighbour{sqrDistBwd[i], indicesBwd[i]};
+      }
+      numNeighboursBwd[index] = count;
+    }
+  };
+
+  parallelFor(threadPool, _sourcePointCount, searchBwd);
+
+  for (size_t index = 0; index < _sourcePointCount; ++index) {
+    const Neighbour* neighbours = &neighboursBwd[index * num_resultsBwd];
+    for (int i = 0; i < numNeighboursBwd[index]; ++i)
+      _neighboursBwdOffset[neighbours[i].idx + 1]++;
+  }
+
+  for (size_t index = 0; index < _targetPointCount; ++index)
+    _neighboursBwdOffset[index + 1] += _neighboursBwdOffset[index];
+
+  _neighboursBwd.resize(_neighboursBwdOffset.back());
+  std::vector<size_t> nextNeighbourBwd(
+    _neighboursBwdOffset.begin(), _neighboursBwdOffset.end() - 1);
+
+  for (size_t index = 0; index < _sourcePointCount; ++index) {
+    const Neighbour* neighbours = &neighboursBwd[index * num_resultsBwd];
+    for (int i = 0; i < numNeighboursBwd[index]; ++i) {
+      auto& dst = _neighboursBwd[nextNeighbourBwd[neighbours[i].idx]++];
+      dst = Neighbour{neighbours[i].dist2, index};
+    }
+  }
+
+  auto sortBwd = [&](size_t begin, size_t end) {
+    for (size_t index = begin; index < end; ++index) {
+      std::sort(
+        &_neighboursBwd[0] + _neighboursBwdOffset[index],
+        &_neighboursBwd[0] + _neighboursBwdOffset[index + 1],
+        [](const Neighbour& a, const Neighbour& b) {
+          return a.dist2 < b.dist2;
+        });
+    }
+  };
+
+  parallelFor(threadPool, _targetPointCount, sortBwd);
+}
+
+//============================================================================
+// The squared distance between two attribute values.
+
+static int64_t
+attributeDist2(attr_t a, attr_t b)
+{
+  int64_t d = int64_t(a) - int64_t(b);
+  return d * d;
+}
+
+static int64_t
+attributeDist2(const Vec3<attr_t>& a, const Vec3<attr_t>& b)
+{
+  int64_t dist2 = 0;
+  for (int k = 0; k < 3; ++k)
+    dist2 += attributeDist2(a[k], b[k]);
+  return dist2;
+}
+
+//----------------------------------------------------------------------------
+// Converts a squared attribute distance threshold to an integer limit, such
+// that a squared distance d2 exceeds the threshold if d2 > limit.
+//
+// NB: the largest squared distance between a set of attribute values is at
+//     least std::numeric_limits<double>::min(), and a threshold below that
+//     is always exceeded.
+
+static int64_t
+attributeDist2Limit(double maxAttributeDist2)
+{
+  if (maxAttributeDist2 < std::numeric_limits<double>::min())
+    return -1;
+
+  if (maxAttributeDist2 >= double(std::numeric_limits<int64_t>::max()))
+    return std::numeric_limits<int64_t>::max();
+
+  return int64_t(std::floor(maxAttributeDist2));
+}
+
+//----------------------------------------------------------------------------
+// Determines the largest n <= count (count > 0) such that the squared
+// distance dist2(i, j) between each pair of the first n attribute values
+// does not exceed limit.  The result is at least one.
+
+template<typename Dist2Fn>
+static int
+numSimilarAttributes(int count, int64_t limit, Dist2Fn dist2)
+{
+  for (int n = 1; n < count; ++n) {
+    for (int i = 0; i < n; ++i) {
+      if (dist2(i, n) > limit)
+        return n;
+    }
+  }
+
+  return count;
+}
+
 //============================================================================
 // Determine colour attribute values from a reference/source point cloud.
 // For each point of the target p_t:
@@ -233,23 +499,19 @@ bool
 recolourColour(
   const AttributeDescription& attrDesc,
   const RecolourParams& params,
+  const RecolourContext& ctxt,
   const PCCPointSet3& source,
-  double sourceToTargetScaleFactor,
-  point_t targetToSourceOffset,
-  PCCPointSet3& target)
+  PCCPointSet3& target,
+  ThreadPool* threadPool)
 {
-  double targetToSourceScaleFactor = 1.0 / sourceToTargetScaleFactor;
-
   const size_t pointCountSource = source.getPointCount();
   const size_t pointCountTarget = target.getPointCount();
   if (!pointCountSource || !pointCountTarget || !source.hasColors()) {
     return false;
   }
 
-  KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeTarget(
-    3, target, 10);
-  KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeSource(
-    3, source, 10);
+  assert(ctxt.sourcePointCount() == pointCountSource);
+  assert(ctxt.targetPointCount() == pointCountTarget);
 
   target.addColors();
   std::vector<Vec3<attr_t>> refinedColors1;
@@ -259,317 +521,237 @@ recolourColour(
                        double((1 << attrDesc.bitdepthSecondary) - 1),
                        double((1 << attrDesc.bitdepthSecondary) - 1)};
 
-  double maxGeometryDist2Fwd = params.maxGeometryDist2Fwd < 512
-    ? params.maxGeometryDist2Fwd
-    : std::numeric_limits<double>::max();
-  double maxGeometryDist2Bwd = params.maxGeometryDist2Bwd < 512
-    ? params.maxGeometryDist2Bwd
-    : std::numeric_limits<double>::max();
-  double maxAttributeDist2Fwd = params.maxAttributeDist2Fwd < 512
-    ? params.maxAttributeDist2Fwd
-    : std::numeric_limits<double>::max();
-  double maxAttributeDist2Bwd = params.maxAttributeDist2Bwd < 512
-    ? params.maxAttributeDist2Bwd
-    : std::numeric_limits<double>::max();
+  // NB: attribute distances are compared as integers
+  const int64_t maxAttributeDist2Fwd =
+    attributeDist2Limit(params.maxAttributeDist2Fwd < 512
+      ? params.maxAttributeDist2Fwd
+      : std::numeric_limits<double>::max());
+  const int64_t maxAttributeDist2Bwd =
+    attributeDist2Limit(params.maxAttributeDist2Bwd < 512
+      ? params.maxAttributeDist2Bwd
+      : std::numeric_limits<double>::max());
 
   // Forward direction
-  const int num_resultsFwd = params.numNeighboursFwd;
-  nanoflann::KNNResultSet<double> resultSetFwd(num_resultsFwd);
-  std::vector<size_t> indicesFwd(num_resultsFwd);
-  std::vector<double> sqrDistFwd(num_resultsFwd);
-  for (size_t index = 0; index < pointCountTarget; ++index) {
-    resultSetFwd.init(&indicesFwd[0], &sqrDistFwd[0]);
-
-    Vec3<double> posInSrc =
-      (target[index] + targetToSourceOffset) * targetToSourceScaleFactor;
-
-    kdtreeSource.index->findNeighbors(
-      resultSetFwd, &posInSrc[0], nanoflann::SearchParams(10));
-
-    while (1) {
-      if (indicesFwd.size() == 1)
-        break;
-
-      if (sqrDistFwd[int(resultSetFwd.size()) - 1] <= maxGeometryDist2Fwd)
-        break;
+  auto recolourFwd = [&](size_t begin, size_t end) {
+    std::vector<Vec3<attr_t>> colors(ctxt.maxNeighboursFwd());
+
+    // NB: the colour differences are computed modulo 2^16, in each order,
+    //     as per the arithmetic of Vec3<attr_t>.
+    auto colourDist2 = [&](int i, int j) {
+      int64_t dist2ij = 0;
+      int64_t dist2ji = 0;
+      for (int k = 0; k < 3; ++k) {
+        int64_t dij = attr_t(colors[i][k] - colors[j][k]);
+        int64_t dji = attr_t(colors[j][k] - colors[i][k]);
+        dist2ij += dij * dij;
+        dist2ji += dji * dji;
+      }
+      return std::max(dist2ij, dist2ji);
+    };
 
-      sqrDistFwd.pop_back();
-      indicesFwd.pop_back();
-    }
+    for (size_t index = begin; index < end; ++index) {
+      const auto* neighboursFwd = ctxt.neighboursFwd(index);
+      const int numNeighbours = ctxt.numNeighboursFwd(index);
 
-    bool isDone = false;
-    if (params.skipAvgIfIdenticalSourcePointPresentFwd) {
-      if (sqrDistFwd[0] < 0.0001) {
-        refinedColors1[index] = source.getColor(indicesFwd[0]);
-        isDone = true;
+      if (params.skipAvgIfIdenticalSourcePointPresentFwd) {
+        if (neighboursFwd[0].dist2 < 0.0001) {
+          refinedColors1[index] = source.getColor(neighboursFwd[0].idx);
+          continue;
+        }
       }
-    }
 
-    if (isDone)
-      continue;
+      for (int i = 0; i < numNeighbours; ++i)
+        colors[i] = source.getColor(neighboursFwd[i].idx);
 
-    int nNN = indicesFwd.size();
-    while (nNN > 0 && !isDone) {
+      int nNN =
+        numSimilarAttributes(numNeighbours, maxAttributeDist2Fwd, colourDist2);
       if (nNN == 1) {
-        refinedColors1[index] = source.getColor(indicesFwd[0]);
-        isDone = true;
-        break;
+        refinedColors1[index] = colors[0];
+        continue;
       }
 
-      std::vector<Vec3<attr_t>> colors;
-      colors.resize(0);
-      colors.resize(nNN);
-      for (int i = 0; i < nNN; ++i) {
-        for (int k = 0; k < 3; ++k) {
-          colors[i][k] = double(source.getColor(indicesFwd[i])[k]);
-        }
-      }
-      double maxAttributeDist2 = std::numeric_limits<double>::min();
-      for (int i = 0; i < nNN; ++i) {
-        for (int j = 0; j < nNN; ++j) {
-          const double dist2 = (colors[i] - colors[j]).getNorm2<double>();
-          if (dist2 > maxAttributeDist2) {
-            maxAttributeDist2 = dist2;
+      Vec3<double> refinedColor(0.0);
+      if (params.useDistWeightedAvgFwd) {
+        double sumWeights{0.0};
+        for (int i = 0; i < nNN; ++i) {
+          const double weight =
+            1 / (neighboursFwd[i].dist2 + params.distOffsetFwd);
+          for (int k = 0; k < 3; ++k) {
+            refinedColor[k] += colors[i][k] * weight;
           }
+          sumWeights += weight;
         }
-      }
-      if (maxAttributeDist2 > maxAttributeDist2Fwd) {
-        --nNN;
+        refinedColor /= sumWeights;
       } else {
-        Vec3<double> refinedColor(0.0);
-        if (params.useDistWeightedAvgFwd) {
-          double sumWeights{0.0};
-          for (int i = 0; i < nNN; ++i) {
-            const double weight = 1 / (sqrDistFwd[i] + params.distOffsetFwd);
-            for (int k = 0; k < 3; ++k) {
-              refinedColor[k] += source.getColor(indicesFwd[i])[k] * weight;
-            }
-            sumWeights += weight;
-          }
-          refinedColor /= sumWeights;
-        } else {
-          for (int i = 0; i < nNN; ++i) {
-            for (int k = 0; k < 3; ++k) {
-              refinedColor[k] += source.getColor(indicesFwd[i])[k];
-            }
+        for (int i = 0; i < nNN; ++i) {
+          for (int k = 0; k < 3; ++k) {
+            refinedColor[k] += colors[i][k];
           }
-          refinedColor /= nNN;
-        }
-        for (int k = 0; k < 3; ++k) {
-          refinedColors1[index][k] =
-            attr_t(PCCClip(round(refinedColor[k]), 0.0, clipMax[k]));
         }
-        isDone = true;
+        refinedColor /= nNN;
+      }
+      for (int k = 0; k < 3; ++k) {
+        refinedColors1[index][k] =
+          attr_t(PCCClip(round(refinedColor[k]), 0.0, clipMax[k]));
       }
     }
-  }
+  };
 
-  // Backward direction
-  const size_t num_resultsBwd = params.numNeighboursBwd;
-  std::vector<size_t> indicesBwd(num_resultsBwd);
-  std::vector<double> sqrDistBwd(num_resultsBwd);
-  nanoflann::KNNResultSet<double> resultSetBwd(num_resultsBwd);
+  parallelFor(threadPool, pointCountTarget, recolourFwd);
 
+  // Backward direction
   struct DistColor {
     double dist;
     Vec3<attr_t> color;
   };
-  std::vector<std::vector<DistColor>> refinedColorsDists2;
-  refinedColorsDists2.resize(pointCountTarget);
 
-  for (size_t index = 0; index < pointCountSource; ++index) {
-    const Vec3<attr_t> color = source.getColor(index);
-    resultSetBwd.init(&indicesBwd[0], &sqrDistBwd[0]);
+  auto recolourTarget = [&](size_t begin, size_t end) {
+    std::vector<DistColor> colorsDists2;
 
-    Vec3<double> posInTgt =
-      source[index] * sourceToTargetScaleFactor - targetToSourceOffset;
+    auto colourDist2 = [&](int i, int j) {
+      return attributeDist2(colorsDists2[i].color, colorsDists2[j].color);
+    };
 
-    kdtreeTarget.index->findNeighbors(
-      resultSetBwd, &posInTgt[0], nanoflann::SearchParams(10));
+    for (size_t index = begin; index < end; ++index) {
+      colorsDists2.clear();
+      auto it = ctxt.neighboursBwdBegin(index);
+      for (; it != ctxt.neighboursBwdEnd(index); ++it)
+        colorsDists2.push_back(DistColor{it->dist2, source.getColor(it->idx)});
 
-    for (int i = 0; i < num_resultsBwd; ++i) {
-      if (sqrDistBwd[i] <= maxGeometryDist2Bwd) {
-        refinedColorsDists2[indicesBwd[i]].push_back(
-          DistColor{sqrDistBwd[i], color});
+      const Vec3<attr_t> color1 = refinedColors1[index];
+      if (colorsDists2.empty()) {
+        target.setColor(index, color1);
+        continue;
       }
-    }
-  }
 
-  for (size_t index = 0; index < pointCountTarget; ++index) {
-    std::sort(
-      refinedColorsDists2[index].begin(), refinedColorsDists2[index].end(),
-      [](DistColor& dc1, DistColor& dc2) { return dc1.dist < dc2.dist; });
-  }
+      const Vec3<double> centroid1(color1[0], color1[1], color1[2]);
+      Vec3<double> centroid2(0.0);
 
-  for (size_t index = 0; index < pointCountTarget; ++index) {
-    const Vec3<attr_t> color1 = refinedColors1[index];
-    auto& colorsDists2 = refinedColorsDists2[index];
-    if (colorsDists2.empty()) {
-      target.setColor(index, color1);
-      continue;
-    }
+      int nNN = colorsDists2.size();
+      if (params.skipAvgIfIdenticalSourcePointPresentBwd) {
+        if (colorsDists2[0].dist < 0.0001)
+          nNN = 1;
+      }
 
-    bool isDone = false;
-    const Vec3<double> centroid1(color1[0], color1[1], color1[2]);
-    Vec3<double> centroid2(0.0);
-    if (params.skipAvgIfIdenticalSourcePointPresentBwd) {
-      if (colorsDists2[0].dist < 0.0001) {
-        auto temp = colorsDists2[0];
-        colorsDists2.clear();
-        colorsDists2.push_back(temp);
+      if (nNN > 1)
+        nNN = numSimilarAttributes(nNN, maxAttributeDist2Bwd, colourDist2);
+      colorsDists2.resize(nNN);
+
+      if (nNN == 1) {
         for (int k = 0; k < 3; ++k) {
           centroid2[k] = colorsDists2[0].color[k];
         }
-        isDone = true;
-      }
-    }
-
-    if (!isDone) {
-      int nNN = colorsDists2.size();
-      while (nNN > 0 && !isDone) {
-        nNN = colorsDists2.size();
-        if (nNN == 1) {
-          auto temp = colorsDists2[0];
-          colorsDists2.clear();
-          colorsDists2.push_back(temp);
+      } else if (params.useDistWeightedAvgBwd) {
+        double sumWeights{0.0};
+        for (int i = 0; i < colorsDists2.size(); ++i) {
+          const double weight =
+            1 / (sqrt(colorsDists2[i].dist) + params.distOffsetBwd);
+          for (size_t k = 0; k < 3; ++k) {
+            centroid2[k] += (colorsDists2[i].color[k] * weight);
+          }
+          sumWeights += weight;
+        }
+        centroid2 /= sumWeights;
+      } else {
+        for (auto& coldist : colorsDists2) {
           for (int k = 0; k < 3; ++k) {
-            centroid2[k] = colorsDists2[0].color[k];
+            centroid2[k] += coldist.color[k];
           }
-          isDone = true;
         }
-        if (!isDone) {
-          std::vector<Vec3<double>> colors;
-          colors.resize(0);
-          colors.resize(nNN);
-          for (int i = 0; i < nNN; ++i) {
-            for (int k = 0; k < 3; ++k) {
-              colors[i][k] = double(colorsDists2[i].color[k]);
+        centroid2 /= colorsDists2.size();
+      }
+
+      double H = double(colorsDists2.size());
+      double D2 = 0.0;
+      for (const auto color2dist : colorsDists2) {
+        auto color2 = color2dist.color;
+        for (size_t k = 0; k < 3; ++k) {
+          const double d2 = centroid2[k] - color2[k];
+          D2 += d2 * d2;
+        }
+      }
+      const double r = double(pointCountTarget) / double(pointCountSource);
+      const double delta2 = (centroid2 - centroid1).getNorm2<double>();
+      const double eps = 0.000001;
+
+      const bool fixWeight = 1;  // m42538
+      if (!(fixWeight || delta2 > eps)) {
+        // centroid2 == centroid1
+        target.setColor(index, color1);
+      } else {
+        // centroid2 != centroid1
+        double w = 0.0;
+
+        if (!fixWeight) {
+          const double alpha = D2 / delta2;
+          const double a = H * r - 1.0;
+          const double c = alpha * r - 1.0;
+          if (fabs(a) < eps) {
+            w = -0.5 * c;
+          } else {
+            const double delta = 1.0 - a * c;
+            if (delta >= 0.0) {
+              w = (-1.0 + sqrt(delta)) / a;
             }
           }
-          double maxAttributeDist2 = std::numeric_limits<double>::min();
-          for (int i = 0; i < nNN; ++i) {
-            for (int j = 0; j < nNN; ++j) {
-              const double dist2 = (colors[i] - colors[j]).getNorm2<double>();
-              if (dist2 > maxAttributeDist2) {
-                maxAttributeDist2 = dist2;
+        }
+        const double oneMinusW = 1.0 - w;
+        Vec3<double> color0;
+        for (size_t k = 0; k < 3; ++k) {
+          color0[k] = PCCClip(
+            round(w * centroid1[k] + oneMinusW * centroid2[k]), 0.0,
+            clipMax[k]);
+        }
+        const double rSource = 1.0 / double(pointCountSource);
+        const double rTarget = 1.0 / double(pointCountTarget);
+        double minError = std::numeric_limits<double>::max();
+        Vec3<double> bestColor(color0);
+        Vec3<double> color;
+        for (int32_t s1 = -params.searchRange; s1 <= params.searchRange;
+             ++s1) {
+          color[0] = PCCClip(color0[0] + s1, 0.0, clipMax[0]);
+          for (int32_t s2 = -params.searchRange; s2 <= params.searchRange;
+               ++s2) {
+            color[1] = PCCClip(color0[1] + s2, 0.0, clipMax[1]);
+            for (int32_t s3 = -params.searchRange; s3 <= params.searchRange;
+                 ++s3) {
+              color[2] = PCCClip(color0[2] + s3, 0.0, clipMax[2]);
+
+              double e1 = 0.0;
+              for (size_t k = 0; k < 3; ++k) {
+                const double d = color[k] - color1[k];
+                e1 += d * d;
               }
-            }
-          }
-          if (maxAttributeDist2 <= maxAttributeDist2Bwd) {
-            for (size_t k = 0; k < 3; ++k) {
-              centroid2[k] = 0;
-            }
-            if (params.useDistWeightedAvgBwd) {
-              double sumWeights{0.0};
-              for (int i = 0; i < colorsDists2.size(); ++i) {
-                const double weight =
-                  1 / (sqrt(colorsDists2[i].dist) + params.distOffsetBwd);
+              e1 *= rTarget;
+
+              double e2 = 0.0;
+              for (const auto color2dist : colorsDists2) {
+                auto color2 = color2dist.color;
                 for (size_t k = 0; k < 3; ++k) {
-                  centroid2[k] += (colorsDists2[i].color[k] * weight);
+                  const double d = color[k] - color2[k];
+                  e2 += d * d;
                 }
-                sumWeights += weight;
               }
-              centroid2 /= sumWeights;
-            } else {
-              for (auto& coldist : colorsDists2) {
-                for (int k = 0; k < 3; ++k) {
-                  centroid2[k] += coldist.color[k];
-                }
+              e2 *= rSource;
+
+              const double error = std::max(e1, e2);
+              if (error < minError) {
+                minError = error;
+                bestColor = color;
               }
-              centroid2 /= colorsDists2.size();
             }
-            isDone = true;
-          } else {
-            colorsDists2.pop_back();
           }
         }
+        target.setColor(
+          index,
+          Vec3<attr_t>(
+            attr_t(bestColor[0]), attr_t(bestColor[1]), attr_t(bestColor[2])));
       }
     }
-    double H = double(colorsDists2.size());
-    double D2 = 0.0;
-    for (const auto color2dist : colorsDists2) {
-      auto color2 = color2dist.color;
-      for (size_t k = 0; k < 3; ++k) {
-        const double d2 = centroid2[k] - color2[k];
-        D2 += d2 * d2;
-      }
-    }
-    const double r = double(pointCountTarget) / double(pointCountSource);
-    const double delta2 = (centroid2 - centroid1).getNorm2<double>();
-    const double eps = 0.000001;
-
-    const bool fixWeight = 1;  // m42538
-    if (!(fixWeight || delta2 > eps)) {
-      // centroid2 == centroid1
-      target.setColor(index, color1);
-    } else {
-      // centroid2 != centroid1
-      double w = 0.0;
-
-      if (!fixWeight) {
-        const double alpha = D2 / delta2;
-        const double a = H * r - 1.0;
-        const double c = alpha * r - 1.0;
-        if (fabs(a) < eps) {
-          w = -0.5 * c;
-        } else {
-          const double delta = 1.0 - a * c;
-          if (delta >= 0.0) {
-            w = (-1.0 + sqrt(delta)) / a;
-          }
-        }
-      }
-      const double oneMinusW = 1.0 - w;
-      Vec3<double> color0;
-      for (size_t k = 0; k < 3; ++k) {
-        color0[k] = PCCClip(
-          round(w * centroid1[k] + oneMinusW * centroid2[k]), 0.0, clipMax[k]);
-      }
-      const double rSource = 1.0 / double(pointCountSource);
-      const double rTarget = 1.0 / double(pointCountTarget);
-      double minError = std::numeric_limits<double>::max();
-      Vec3<double> bestColor(color0);
-      Vec3<double> color;
-      for (int32_t s1 = -params.searchRange; s1 <= params.searchRange; ++s1) {
-        color[0] = PCCClip(color0[0] + s1, 0.0, clipMax[0]);
-        for (int32_t s2 = -params.searchRange; s2 <= params.searchRange;
-             ++s2) {
-          color[1] = PCCClip(color0[1] + s2, 0.0, clipMax[1]);
-          for (int32_t s3 = -params.searchRange; s3 <= params.searchRange;
-               ++s3) {
-            color[2] = PCCClip(color0[2] + s3, 0.0, clipMax[2]);
-
-            double e1 = 0.0;
-            for (size_t k = 0; k < 3; ++k) {
-              const double d = color[k] - color1[k];
-              e1 += d * d;
-            }
-            e1 *= rTarget;
+  };
 
-            double e2 = 0.0;
-            for (const auto color2dist : colorsDists2) {
-              auto color2 = color2dist.color;
-              for (size_t k = 0; k < 3; ++k) {
-                const double d = color[k] - color2[k];
-                e2 += d * d;
-              }
-            }
-            e2 *= rSource;
+  parallelFor(threadPool, pointCountTarget, recolourTarget);
 
-            const double error = std::max(e1, e2);
-            if (error < minError) {
-              minError = error;
-              bestColor = color;
-            }
-          }
-        }
-      }
-      target.setColor(
-        index,
-        Vec3<attr_t>(
-          attr_t(bestColor[0]), attr_t(bestColor[1]), attr_t(bestColor[2])));
-    }
-  }
   return true;
 }
 
@@ -598,324 +780,236 @@ bool
 recolourReflectance(
   const AttributeDescription& attrDesc,
   const RecolourParams& cfg,
+  const RecolourContext& ctxt,
   const PCCPointSet3& source,
-  double sourceToTargetScaleFactor,
-  point_t targetToSourceOffset,
-  PCCPointSet3& target)
+  PCCPointSet3& target,
+  ThreadPool* threadPool)
 {
-  double targetToSourceScaleFactor = 1.0 / sourceToTargetScaleFactor;
-
   const size_t pointCountSource = source.getPointCount();
   const size_t pointCountTarget = target.getPointCount();
   if (!pointCountSource || !pointCountTarget || !source.hasReflectances()) {
     return false;
   }
-  KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeTarget(
-    3, target, 10);
-  KDTreeVectorOfVectorsAdaptor<PCCPointSet3, double> kdtreeSource(
-    3, source, 10);
+  assert(ctxt.sourcePointCount() == pointCountSource);
+  assert(ctxt.targetPointCount() == pointCountTarget);
+
   target.addReflectances();
   std::vector<attr_t> refinedReflectances1;
   refinedReflectances1.resize(pointCountTarget);
 
   double clipMax = (1 << attrDesc.bitdepth) - 1;
 
-  double maxGeometryDist2Fwd = (cfg.maxGeometryDist2Fwd < 512)
-    ? cfg.maxGeometryDist2Fwd
-    : std::numeric_limits<double>::max();
-  double maxGeometryDist2Bwd = (cfg.maxGeometryDist2Bwd < 512)
-    ? cfg.maxGeometryDist2Bwd
-    : std::numeric_limits<double>::max();
-  double maxAttributeDist2Fwd = (cfg.maxAttributeDist2Fwd < 512)
-    ? cfg.maxAttributeDist2Fwd
-    : std::numeric_limits<double>::max();
-  double maxAttributeDist2Bwd = (cfg.maxAttributeDist2Bwd < 512)
-    ? cfg.maxAttributeDist2Bwd
-    : std::numeric_limits<double>::max();
+  // NB: attribute distances are compared as integers
+  const int64_t maxAttributeDist2Fwd =
+    attributeDist2Limit(cfg.maxAttributeDist2Fwd < 512
+      ? cfg.maxAttributeDist2Fwd
+      : std::numeric_limits<double>::max());
+  const int64_t maxAttributeDist2Bwd =
+    attributeDist2Limit(cfg.maxAttributeDist2Bwd < 512
+      ? cfg.maxAttributeDist2Bwd
+      : std::numeric_limits<double>::max());
 
   // Forward direction
-  const int num_resultsFwd = cfg.numNeighboursFwd;
-  nanoflann::KNNResultSet<double> resultSetFwd(num_resultsFwd);
-  std::vector<size_t> indicesFwd(num_resultsFwd);
-  std::vector<double> sqrDistFwd(num_resultsFwd);
-  for (size_t index = 0; index < pointCountTarget; ++index) {
-    resultSetFwd.init(&indicesFwd[0], &sqrDistFwd[0]);
-
-    Vec3<double> posInSrc =
-      (target[index] + targetToSourceOffset) * targetToSourceScaleFactor;
-
-    kdtreeSource.index->findNeighbors(
-      resultSetFwd, &posInSrc[0], nanoflann::SearchParams(10));
-
-    while (1) {
-      if (indicesFwd.size() == 1)
-        break;
-
-      if (sqrDistFwd[int(resultSetFwd.size()) - 1] <= maxGeometryDist2Fwd)
-        break;
-
-      sqrDistFwd.pop_back();
-      indicesFwd.pop_back();
-    }
-
-    bool isDone = false;
-    if (cfg.skipAvgIfIdenticalSourcePointPresentFwd) {
-      if (sqrDistFwd[0] < 0.0001) {
-        refinedReflectances1[index] = source.getReflectance(indicesFwd[0]);
-        isDone = true;
+  auto recolourFwd = [&](size_t begin, size_t end) {
+    std::vector<attr_t> reflectances(ctxt.maxNeighboursFwd());
+
+    auto reflectanceDist2 = [&](int i, int j) {
+      return attributeDist2(reflectances[i], reflectances[j]);
+    };
+
+    for (size_t index = begin; index < end; ++index) {
+      const auto* neighboursFwd = ctxt.neighboursFwd(index);
+      const int numNeighbours = ctxt.numNeighboursFwd(index);
+
+      if (cfg.skipAvgIfIdenticalSourcePointPresentFwd) {
+        if (neighboursFwd[0].dist2 < 0.0001) {
+          refinedReflectances1[index] =
+            source.getReflectance(neighboursFwd[0].idx);
+          continue;
+        }
       }
-    }
 
-    if (isDone)
-      continue;
+      for (int i = 0; i < numNeighbours; ++i)
+        reflectances[i] = source.getReflectance(neighboursFwd[i].idx);
 
-    int nNN = indicesFwd.size();
-    while (nNN > 0 && !isDone) {
+      int nNN = numSimilarAttributes(
+        numNeighbours, maxAttributeDist2Fwd, reflectanceDist2);
       if (nNN == 1) {
-        refinedReflectances1[index] = source.getReflectance(indicesFwd[0]);
-        isDone = true;
+        refinedReflectances1[index] = reflectances[0];
         continue;
       }
 
-      std::vector<attr_t> reflectances;
-      reflectances.resize(0);
-      reflectances.resize(nNN);
-      for (int i = 0; i < nNN; ++i) {
-        reflectances[i] = double(source.getReflectance(indicesFwd[i]));
-      }
-      double maxAttributeDist2 = std::numeric_limits<double>::min();
-      for (int i = 0; i < nNN; ++i) {
-        for (int j = 0; j < nNN; ++j) {
-          const double dist2 = pow(reflectances[i] - reflectances[j], 2);
-          if (dist2 > maxAttributeDist2)
-            maxAttributeDist2 = dist2;
+      double refinedReflectance = 0.0;
+      if (cfg.useDistWeightedAvgFwd) {
+        double sumWeights{0.0};
+        for (int i = 0; i < nNN; ++i) {
+          const double weight =
+            1 / (neighboursFwd[i].dist2 + cfg.distOffsetFwd);
+          refinedReflectance += reflectances[i] * weight;
+          sumWeights += weight;
         }
-      }
-      if (maxAttributeDist2 > maxAttributeDist2Fwd) {
-        --nNN;
+        refinedReflectance /= sumWeights;
       } else {
-        double refinedReflectance = 0.0;
-        if (cfg.useDistWeightedAvgFwd) {
-          double sumWeights{0.0};
-          for (int i = 0; i < nNN; ++i) {
-            const double weight = 1 / (sqrDistFwd[i] + cfg.distOffsetFwd);
-            refinedReflectance +=
-              source.getReflectance(indicesFwd[i]) * weight;
-            sumWeights += weight;
-          }
-          refinedReflectance /= sumWeights;
-        } else {
-          for (int i = 0; i < nNN; ++i)
-            refinedReflectance += source.getReflectance(indicesFwd[i]);
-          refinedReflectance /= nNN;
-        }
-        refinedReflectances1[index] =
-          attr_t(PCCClip(round(refinedReflectance), 0.0, clipMax));
-        isDone = true;
+        for (int i = 0; i < nNN; ++i)
+          refinedReflectance += reflectances[i];
+        refinedReflectance /= nNN;
       }
+      refinedReflectances1[index] =
+        attr_t(PCCClip(round(refinedReflectance), 0.0, clipMax));
     }
-  }
+  };
 
-  // Backward direction
-  const size_t num_resultsBwd = cfg.numNeighboursBwd;
-  std::vector<size_t> indicesBwd(num_resultsBwd);
-  std::vector<double> sqrDistBwd(num_resultsBwd);
-  nanoflann::KNNResultSet<double> resultSetBwd(num_resultsBwd);
+  parallelFor(threadPool, pointCountTarget, recolourFwd);
 
+  // Backward direction
   struct DistReflectance {
     double dist;
     attr_t reflectance;
   };
-  std::vector<std::vector<DistReflectance>> refinedReflectancesDists2;
-  refinedReflectancesDists2.resize(pointCountTarget);
 
-  for (size_t index = 0; index < pointCountSource; ++index) {
-    const attr_t reflectance = source.getReflectance(index);
-    resultSetBwd.init(&indicesBwd[0], &sqrDistBwd[0]);
+  auto recolourTarget = [&](size_t begin, size_t end) {
+    std::vector<DistReflectance> reflectancesDists2;
 
-    Vec3<double> posInTgt =
-      source[index] * sourceToTargetScaleFactor - targetToSourceOffset;
+    auto reflectanceDist2 = [&](int i, int j) {
+      return attributeDist2(
+        reflectancesDists2[i].reflectance, reflectancesDists2[j].reflectance);
+    };
 
-    kdtreeTarget.index->findNeighbors(
-      resultSetBwd, &posInTgt[0], nanoflann::SearchParams(10));
+    for (size_t index = begin; index < end; ++index) {
+      reflectancesDists2.clear();
+      auto it = ctxt.neighboursBwdBegin(index);
+      for (; it != ctxt.neighboursBwdEnd(index); ++it)
+        reflectancesDists2.push_back(
+          DistReflectance{it->dist2, source.getReflectance(it->idx)});
 
-    for (int i = 0; i < num_resultsBwd; ++i) {
-      if (sqrDistBwd[i] <= maxGeometryDist2Bwd) {
-        refinedReflectancesDists2[indicesBwd[i]].push_back(
-          DistReflectance{sqrDistBwd[i], reflectance});
+      const attr_t reflectance1 = refinedReflectances1[index];
+      if (reflectancesDists2.empty()) {
+        target.setReflectance(index, reflectance1);
+        continue;
       }
-    }
-  }
 
-  for (size_t index = 0; index < pointCountTarget; ++index) {
-    std::sort(
-      refinedReflectancesDists2[index].begin(),
-      refinedReflectancesDists2[index].end(),
-      [](DistReflectance& dc1, DistReflectance& dc2) {
-        return dc1.dist < dc2.dist;
-      });
-  }
+      const double centroid1 = reflectance1;
+      double centroid2 = 0.0;
 
-  for (size_t index = 0; index < pointCountTarget; ++index) {
-    const attr_t reflectance1 = refinedReflectances1[index];
-    auto& reflectancesDists2 = refinedReflectancesDists2[index];
-    if (reflectancesDists2.empty()) {
-      target.setReflectance(index, reflectance1);
-      continue;
-    }
+      int nNN = reflectancesDists2.size();
+      if (cfg.skipAvgIfIdenticalSourcePointPresentBwd) {
+        if (reflectancesDists2[0].dist < 0.0001)
+          nNN = 1;
+      }
 
-    bool isDone = false;
-    const double centroid1 = reflectance1;
-    double centroid2 = 0.0;
-    if (cfg.skipAvgIfIdenticalSourcePointPresentBwd) {
-      if (reflectancesDists2[0].dist < 0.0001) {
-        auto temp = reflectancesDists2[0];
-        reflectancesDists2.clear();
-        reflectancesDists2.push_back(temp);
-        centroid2 = reflectancesDists2[0].reflectance;
-        isDone = true;
+      if (nNN > 1) {
+        nNN =
+          numSimilarAttributes(nNN, maxAttributeDist2Bwd, reflectanceDist2);
       }
-    }
-    if (!isDone) {
-      int nNN = reflectancesDists2.size();
-      while (nNN > 0 && !isDone) {
-        nNN = reflectancesDists2.size();
-        if (nNN == 1) {
-          auto temp = reflectancesDists2[0];
-          reflectancesDists2.clear();
-          reflectancesDists2.push_back(temp);
-          centroid2 = reflectancesDists2[0].reflectance;
-          isDone = true;
+      reflectancesDists2.resize(nNN);
+
+      if (nNN == 1) {
+        centroid2 = reflectancesDists2[0].reflectance;
+      } else if (cfg.useDistWeightedAvgBwd) {
+        double sumWeights{0.0};
+        for (int i = 0; i < reflectancesDists2.size(); ++i) {
+          const double weight =
+            1 / (sqrt(reflectancesDists2[i].dist) + cfg.distOffsetBwd);
+          centroid2 += (reflectancesDists2[i].reflectance * weight);
+          sumWeights += weight;
         }
-        if (!isDone) {
-          std::vector<double> reflectances;
-          reflectances.resize(0);
-          reflectances.resize(nNN);
-          for (int i = 0; i < nNN; ++i) {
-            reflectances[i] = double(reflectancesDists2[i].reflectance);
-          }
-          double maxAttributeDist2 = std::numeric_limits<double>::min();
-          for (int i = 0; i < nNN; ++i) {
-            for (int j = 0; j < nNN; ++j) {
-              const double dist2 = pow(reflectances[i] - reflectances[j], 2);
-              if (dist2 > maxAttributeDist2) {
-                maxAttributeDist2 = dist2;
-              }
-            }
-          }
-          if (maxAttributeDist2 <= maxAttributeDist2Bwd) {
-            centroid2 = 0;
-            if (cfg.useDistWeightedAvgBwd) {
-              double sumWeights{0.0};
-              for (int i = 0; i < reflectancesDists2.size(); ++i) {
-                const double weight =
-                  1 / (sqrt(reflectancesDists2[i].dist) + cfg.distOffsetBwd);
-                centroid2 += (reflectancesDists2[i].reflectance * weight);
-                sumWeights += weight;
-              }
-              centroid2 /= sumWeights;
-            } else {
-              for (auto& refdist : reflectancesDists2) {
-                centroid2 += refdist.reflectance;
-              }
-              centroid2 /= reflectancesDists2.size();
-            }
-            isDone = true;
-          } else {
-            reflectancesDists2.pop_back();
-          }
+        centroid2 /= sumWeights;
+      } else {
+        for (auto& refdist : reflectancesDists2) {
+          centroid2 += refdist.reflectance;
         }
+        centroid2 /= reflectancesDists2.size();
       }
-    }
-    double H = double(reflectancesDists2.size());
-    double D2 = 0.0;
-    for (const auto reflectance2dist : reflectancesDists2) {
-      auto reflectance2 = reflectance2dist.reflectance;
-      const double d2 = centroid2 - reflectance2;
-      D2 += d2 * d2;
-    }
-    const double r = double(pointCountTarget) / double(pointCountSource);
-    const double delta2 = pow(centroid2 - centroid1, 2);
-    const double eps = 0.000001;
-
-    const bool fixWeight = 1;  // m42538
-    if (!(fixWeight || delta2 > eps)) {
-      // centroid2 == centroid1
-      target.setReflectance(index, reflectance1);
-    } else {
-      // centroid2 != centroid1
-      double w = 0.0;
-
-      if (!fixWeight) {
-        const double alpha = D2 / delta2;
-        const double a = H * r - 1.0;
-        const double c = alpha * r - 1.0;
-        if (fabs(a) < eps) {
-          w = -0.5 * c;
-        } else {
-          const double delta = 1.0 - a * c;
-          if (delta >= 0.0) {
-            w = (-1.0 + sqrt(delta)) / a;
-          }
-        }
+
+      double H = double(reflectancesDists2.size());
+      double D2 = 0.0;
+      for (const auto reflectance2dist : reflectancesDists2) {
+        auto reflectance2 = reflectance2dist.reflectance;
+        const double d2 = centroid2 - reflectance2;
+        D2 += d2 * d2;
       }
-      const double oneMinusW = 1.0 - w;
-      double reflectance0;
-      reflectance0 =
-        PCCClip(round(w * centroid1 + oneMinusW * centroid2), 0.0, clipMax);
-      const double rSource = 1.0 / double(pointCountSource);
-      const double rTarget = 1.0 / double(pointCountTarget);
-      double minError = std::numeric_limits<double>::max();
-      double bestReflectance = reflectance0;
-      double reflectance;
-      for (int32_t s1 = -cfg.searchRange; s1 <= cfg.searchRange; ++s1) {
-        reflectance = PCCClip(reflectance0 + s1, 0.0, clipMax);
-        double e1 = 0.0;
-        const double d = reflectance - reflectance1;
-        e1 += d * d;
-        e1 *= rTarget;
-
-        double e2 = 0.0;
-        for (const auto reflectance2dist : reflectancesDists2) {
-          auto reflectance2 = reflectance2dist.reflectance;
-          const double d = reflectance - reflectance2;
-          e2 += d * d;
+      const double r = double(pointCountTarget) / double(pointCountSource);
+      const double delta2 = pow(centroid2 - centroid1, 2);
+      const double eps = 0.000001;
+
+      const bool fixWeight = 1;  // m42538
+      if (!(fixWeight || delta2 > eps)) {
+        // centroid2 == centroid1
+        target.setReflectance(index, reflectance1);
+      } else {
+        // centroid2 != centroid1
+        double w = 0.0;
+
+        if (!fixWeight) {
+          const double alpha = D2 / delta2;
+          const double a = H * r - 1.0;
+          const double c = alpha * r - 1.0;
+          if (fabs(a) < eps) {
+            w = -0.5 * c;
+          } else {
+            const double delta = 1.0 - a * c;
+            if (delta >= 0.0) {
+              w = (-1.0 + sqrt(delta)) / a;
+            }
+          }
         }
-        e2 *= rSource;
+        const double oneMinusW = 1.0 - w;
+        double reflectance0;
+        reflectance0 =
+          PCCClip(round(w * centroid1 + oneMinusW * centroid2), 0.0, clipMax);
+        const double rSource = 1.0 / double(pointCountSource);
+        const double rTarget = 1.0 / double(pointCountTarget);
+        double minError = std::numeric_limits<double>::max();
+        double bestReflectance = reflectance0;
+        double reflectance;
+        for (int32_t s1 = -cfg.searchRange; s1 <= cfg.searchRange; ++s1) {
+          reflectance = PCCClip(reflectance0 + s1, 0.0, clipMax);
+          double e1 = 0.0;
+          const double d = reflectance - reflectance1;
+          e1 += d * d;
+          e1 *= rTarget;
+
+          double e2 = 0.0;
+          for (const auto reflectance2dist : reflectancesDists2) {
+            auto reflectance2 = reflectance2dist.reflectance;
+            const double d = reflectance - reflectance2;
+            e2 += d * d;
+          }
+          e2 *= rSource;
 
-        const double error = std::max(e1, e2);
-        if (error < minError) {
-          minError = error;
-          bestReflectance = reflectance;
+          const double error = std::max(e1, e2);
+          if (error < minError) {
+            minError = error;
+            bestReflectance = reflectance;
+          }
         }
+        target.setReflectance(index, attr_t(bestReflectance));
       }
-      target.setReflectance(index, attr_t(bestReflectance));
     }
-  }
+  };
+
+  parallelFor(threadPool, pointCountTarget, recolourTarget);
+
   return true;
 }
 
 //============================================================================
 // Colour attributes of a target point cloud given a source.
-//
-// Differences in the scale and translation of the target and source point
-// clouds, is handled according to:
-//   posInTgt = posInSrc * sourceToTargetScaleFactor - tgtToSrcOffset
 
 int
 recolour(
   const AttributeDescription& desc,
   const RecolourParams& cfg,
+  const RecolourContext& ctxt,
   const PCCPointSet3& source,
-  float sourceToTargetScaleFactor,
-  point_t tgtToSrcOffset,
-  PCCPointSet3* target)
+  PCCPointSet3* target,
+  ThreadPool* threadPool)
 {
   // todo(df): fix the incorrect assumption here that 3-component
   // attributes are colour (and that single components are reflectance)
   if (desc.attributeLabel == KnownAttributeLabel::kColour) {
     bool ok = recolourColour(
-      desc, cfg, source, sourceToTargetScaleFactor, tgtToSrcOffset, *target);
+      desc, cfg, ctxt, source, *target, threadPool);
 
     if (!ok) {
       std::cout << "Error: can't transfer colors!" << std::endl;
@@ -925,7 +1019,7 @@ recolour(
 
   if (desc.attributeLabel == KnownAttributeLabel::kReflectance) {
     bool ok = recolourReflectance(
-      desc, cfg, source, sourceToTargetScaleFactor, tgtToSrcOffset, *target);
+      desc, cfg, ctxt, source, *target, threadPool);
 
     if (!ok) {
       std::cout << "Error: can't transfer reflectance!" << std::endl;
@@ -1047,16 +1141,8 @@ sortByAzimuth(
   double recipBinWidth,
   Vec3<int32_t> origin)
 {
-  auto pointCount = end - start;
   auto order = orderByAzimuth(cloud, start, end, recipBinWidth, origin);
-
-  // inefficiently reorder the point cloud
-  for (int i = 0; i < pointCount; i++) {
-    while (order[i] - start != i) {
-      cloud.swapPoints(order[i], order[order[i] - start]);
-      std::swap(order[i], order[order[i] - start]);
-    }
-  }
+  cloud.permute(start, order);
 }
 
 //============================================================================
@@ -1091,16 +1177,8 @@ orderByRadius(PCCPointSet3& cloud, int start, int end, Vec3<int32_t> origin)
 void
 sortByRadius(PCCPointSet3& cloud, int start, int end, Vec3<int32_t> origin)
 {
-  auto pointCount = end - start;
   auto order = orderByRadius(cloud, start, end, origin);
-
-  // inefficiently reorder the point cloud
-  for (int i = 0; i < pointCount; i++) {
-    while (order[i] - start != i) {
-      cloud.swapPoints(order[i], order[order[i] - start]);
-      std::swap(order[i], order[order[i] - start]);
-    }
-  }
+  cloud.permute(start, order);
 }
 
 //============================================================================
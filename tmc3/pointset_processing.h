@@ -36,12 +36,15 @@
 #pragma once
 
 #include <map>
+#include <vector>
 
 #include "PCCPointSet.h"
 #include "hls.h"
 
 namespace pcc {
 
+class ThreadPool;
+
 //============================================================================
 
 struct RecolourParams {
@@ -86,7 +89,10 @@ struct SrcMappedPointSet {
 // NB: attributes are not processed.
 
 SrcMappedPointSet samplePositionsUniq(
-  const float scaleFactor, const Vec3<int> offset, const PCCPointSet3& src);
+  const float scaleFactor,
+  const Vec3<int> offset,
+  const PCCPointSet3& src,
+  ThreadPool* threadPool = nullptr);
 
 //============================================================================
 // Quantise the geometry of a point cloud, retaining unique points only.
@@ -99,7 +105,8 @@ SrcMappedPointSet quantizePositionsUniq(
   const float scaleFactor,
   const Vec3<int> offset,
   const Box3<int> clamp,
-  const PCCPointSet3& src);
+  const PCCPointSet3& src,
+  ThreadPool* threadPool = nullptr);
 
 //============================================================================
 // Quantise the geometry of a point cloud, retaining duplicate points.
@@ -122,6 +129,70 @@ void quantizePositions(
 
 void clampVolume(Box3<int32_t> bbox, PCCPointSet3* cloud);
 
+//============================================================================
+// The neighbourhoods used to recolour a target point cloud from a source.
+// They depend only upon the point positions, and are shared between the
+// attributes of the target.
+//
+// Differences in the scale and translation of the target and source point
+// clouds, is handled according to:
+//    posInTgt = posInSrc * sourceToTargetScaleFactor - targetToSourceOffset
+
+class RecolourContext {
+public:
+  struct Neighbour {
+    double dist2;
+    size_t idx;
+  };
+
+  RecolourContext(
+    const RecolourParams& cfg,
+    const PCCPointSet3& source,
+    double sourceToTargetScaleFactor,
+    point_t targetToSourceOffset,
+    const PCCPointSet3& target,
+    ThreadPool* threadPool = nullptr);
+
+  size_t sourcePointCount() const { return _sourcePointCount; }
+  size_t targetPointCount() const { return _targetPointCount; }
+  int maxNeighboursFwd() const { return _maxNeighboursFwd; }
+
+  // The source points nearest to target point idx, in order of increasing
+  // distance.
+  const Neighbour* neighboursFwd(size_t idx) const
+  {
+    return _neighboursFwd.data() + idx * _maxNeighboursFwd;
+  }
+
+  int numNeighboursFwd(size_t idx) const { return _numNeighboursFwd[idx]; }
+
+  // The source points that have target point idx as a nearest neighbour,
+  // in order of increasing distance.
+  const Neighbour* neighboursBwdBegin(size_t idx) const
+  {
+    return _neighboursBwd.data() + _neighboursBwdOffset[idx];
+  }
+
+  const Neighbour* neighboursBwdEnd(size_t idx) const
+  {
+    return _neighboursBwd.data() + _neighboursBwdOffset[idx + 1];
+  }
+
+private:
+  size_t _sourcePointCount;
+  size_t _targetPointCount;
+
+  // Up to _maxNeighboursFwd neighbours of each target point
+  int _maxNeighboursFwd;
+  std::vector<Neighbour> _neighboursFwd;
+  std::vector<int> _numNeighboursFwd;
+
+  // The neighbours of target point i are in the range
+  // [_neighboursBwdOffset[i], _neighboursBwdOffset[i + 1]).
+  std::vector<Neighbour> _neighboursBwd;
+  std::vector<size_t> _neighboursBwdOffset;
+};
+
 //============================================================================
 // Determine colour attribute values from a reference/source point cloud.
 // For each point of the target p_t:
@@ -139,17 +210,15 @@ void clampVolume(Box3<int32_t> bbox, PCCPointSet3* cloud);
 // weighted average with the number of points of each set as the weights)
 // of \bar{Ψ}̅_1 and \bar{Ψ}̅_2 and transfer it to p_t.
 //
-// Differences in the scale and translation of the target and source point
-// clouds, is handled according to:
-//    posInTgt = posInSrc * sourceToTargetScaleFactor - targetToSourceOffset
+// The neighbourhoods of each point are determined by ctxt.
 
 bool recolourColour(
   const AttributeDescription& desc,
   const RecolourParams& params,
+  const RecolourContext& ctxt,
   const PCCPointSet3& source,
-  double sourceToTargetScaleFactor,
-  point_t targetToSourceOffset,
-  PCCPointSet3& target);
+  PCCPointSet3& target,
+  ThreadPool* threadPool = nullptr);
 
 //============================================================================
 // Determine reflectance attribute values from a reference/source point cloud.
@@ -168,32 +237,31 @@ bool recolourColour(
 // weighted average with the number of points of each set as the weights)
 // of \bar{Ψ}̅_1 and \bar{Ψ}̅_2 and transfer it to p_t.
 //
-// Differences in the scale and translation of the target and source point
-// clouds, is handled according to:
-//    posInTgt = posInSrc * sourceToTargetScaleFactor - targetToSourceOffset
+// The neighbourhoods of each point are determined by ctxt.
 
 bool recolourReflectance(
   const AttributeDescription& desc,
   const RecolourParams& cfg,
+  const RecolourContext& ctxt,
   const PCCPointSet3& source,
-  double sourceToTargetScaleFactor,
-  point_t targetToSourceOffset,
-  PCCPointSet3& target);
+  PCCPointSet3& target,
+  ThreadPool* threadPool = nullptr);
 
 //============================================================================
-// Recolour attributes based on a source/reference point cloud.
+// Recolour attributes based on a source/reference point cloud, using the
+// neighbourhoods of ctxt.  A single context may be used to recolour each
+// attribute of the target.
 //
-// Differences in the scale and translation of the target and source point
-// clouds, is handled according to:
-//   posInTgt = posInSrc * sourceToTargetScaleFactor - tgtToSrcOffset
+// If threadPool is not null, its workers process the points concurrently.
+// The result does not depend upon the number of workers.
 
 int recolour(
   const AttributeDescription& desc,
   const RecolourParams& cfg,
+  const RecolourContext& ctxt,
   const PCCPointSet3& source,
-  float sourceToTargetScaleFactor,
-  point_t tgtToSrcOffset,
-  PCCPointSet3* target);
+  PCCPointSet3* target,
+  ThreadPool* threadPool = nullptr);
 
 //============================================================================
 
@@ -0,0 +1,178 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2020, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PCCMath.h"
+#include "PCCPointSet.h"
+#include "constants.h"
+
+namespace pcc {
+
+//============================================================================
+// The attribute predictors of a set of LoDs in structure-of-arrays form.
+//
+// Each predictor occupies kStride consecutive neighbour entries, starting
+// at i * kStride.  Unused entries have zero weight and refer to
+// predictor 0.  The neighbour count of each predictor is held in the upper
+// bits of the index of its first neighbour.
+
+struct PredictorStore {
+  static const int kStride = kAttributePredictionMaxNeighbourCount;
+  static const int kCountShift = 30;
+  static const uint32_t kIndexMask = (1u << kCountShift) - 1;
+
+  static_assert(
+    kStride < (1 << (32 - kCountShift)),
+    "neighbour count must fit above kCountShift");
+
+  // Neighbour predictor indexes, with the packed neighbour count
+  std::vector<uint32_t> predictorIndex;
+
+  // Neighbour weights, in units of 2^-kFixedPointWeightShift
+  std::vector<uint32_t> weight;
+
+  // The prediction mode of each predictor, as last selected or decoded by
+  // an attribute coder.
+  std::vector<int8_t> predMode;
+
+  size_t size() const { return predMode.size(); }
+
+  void resize(size_t predictorCount)
+  {
+    predictorIndex.assign(predictorCount * kStride, 0);
+    weight.assign(predictorCount * kStride, 0);
+    predMode.assign(predictorCount, 0);
+  }
+
+  int neighborCount(size_t i) const
+  {
+    return predictorIndex[i * kStride] >> kCountShift;
+  }
+
+  uint32_t neighborIndex(size_t i, int k) const
+  {
+    return predictorIndex[i * kStride + k] & kIndexMask;
+  }
+
+  uint32_t neighborWeight(size_t i, int k) const
+  {
+    return weight[i * kStride + k];
+  }
+
+  void setNeighbors(
+    size_t i, int count, const uint32_t* indexes, const uint32_t* weights)
+  {
+    assert(count <= kStride);
+    for (int k = 0; k < count; ++k) {
+      assert(indexes[k] <= kIndexMask);
+      predictorIndex[i * kStride + k] = indexes[k];
+      weight[i * kStride + k] = weights[k];
+    }
+    predictorIndex[i * kStride] |= uint32_t(count) << kCountShift;
+  }
+
+  //--------------------------------------------------------------------------
+  // The attribute of predictor i predicted using its current prediction
+  // mode.  The attributes of the predictors are found via indexes.
+
+  Vec3<attr_t> predictColor(
+    size_t i,
+    const PCCPointSet3& pointCloud,
+    const std::vector<uint32_t>& indexes) const
+  {
+    const int mode = predMode[i];
+    const int count = neighborCount(i);
+
+    Vec3<int64_t> predicted(0);
+    if (mode > count) {
+      /* nop */
+    } else if (mode > 0) {
+      const Vec3<attr_t> color =
+        pointCloud.getColor(indexes[neighborIndex(i, mode - 1)]);
+      for (size_t k = 0; k < 3; ++k) {
+        predicted[k] += color[k];
+      }
+    } else {
+      for (int j = 0; j < count; ++j) {
+        const Vec3<attr_t> color =
+          pointCloud.getColor(indexes[neighborIndex(i, j)]);
+        const uint32_t w = neighborWeight(i, j);
+        for (size_t k = 0; k < 3; ++k) {
+          predicted[k] += w * color[k];
+        }
+      }
+      for (uint32_t k = 0; k < 3; ++k) {
+        predicted[k] =
+          divExp2RoundHalfInf(predicted[k], kFixedPointWeightShift);
+      }
+    }
+    return Vec3<attr_t>(predicted[0], predicted[1], predicted[2]);
+  }
+
+  int64_t predictReflectance(
+    size_t i,
+    const PCCPointSet3& pointCloud,
+    const std::vector<uint32_t>& indexes) const
+  {
+    const int mode = predMode[i];
+    const int count = neighborCount(i);
+
+    int64_t predicted(0);
+    if (mode > count) {
+      /* nop */
+    } else if (mode > 0) {
+      predicted =
+        pointCloud.getReflectance(indexes[neighborIndex(i, mode - 1)]);
+    } else {
+      for (int j = 0; j < count; ++j) {
+        predicted += neighborWeight(i, j)
+          * pointCloud.getReflectance(indexes[neighborIndex(i, j)]);
+      }
+      predicted = divExp2RoundHalfInf(predicted, kFixedPointWeightShift);
+    }
+    return predicted;
+  }
+};
+
+//============================================================================
+
+}  // namespace pcc
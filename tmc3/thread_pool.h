@@ -0,0 +1,286 @@
+/* The copyright in this software is being made available under the BSD
+ * Licence, included below.  This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such
+ * rights are granted under this licence.
+ *
+ * Copyright (c) 2020, ISO/IEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the ISO/IEC nor the names of its contributors
+ *   may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace pcc {
+
+//============================================================================
+// A fixed size pool of worker threads executing submitted tasks in
+// submission order.
+//
+// NB: a task must not block waiting for the result of another task
+//     submitted to the same pool.
+
+class ThreadPool {
+public:
+  explicit ThreadPool(int numThreads);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Waits for all queued tasks to complete
+  ~ThreadPool();
+
+  int numThreads() const { return int(_workers.size()); }
+
+  // Queue fn for execution by a worker.  Any exception raised by fn is
+  // rethrown by the returned future.
+  template<typename Fn>
+  std::future<typename std::result_of<Fn()>::type> submit(Fn&& fn);
+
+private:
+  void workerLoop();
+
+  std::vector<std::thread> _workers;
+  std::deque<std::function<void()>> _tasks;
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  bool _stopping;
+};
+
+//----------------------------------------------------------------------------
+
+inline ThreadPool::ThreadPool(int numThreads) : _stopping(false)
+{
+  for (int i = 0; i < numThreads; i++)
+    _workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+//----------------------------------------------------------------------------
+
+inline ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _cv.notify_all();
+
+  for (auto& worker : _workers)
+    worker.join();
+}
+
+//----------------------------------------------------------------------------
+
+template<typename Fn>
+std::future<typename std::result_of<Fn()>::type>
+ThreadPool::submit(Fn&& fn)
+{
+  typedef typename std::result_of<Fn()>::type Result;
+
+  // NB: std::function requires a copyable target
+  auto task =
+    std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+  auto result = task->get_future();
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tasks.emplace_back([task]() { (*task)(); });
+  }
+  _cv.notify_one();
+
+  return result;
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+ThreadPool::workerLoop()
+{
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _cv.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+
+      // drain any remaining work before stopping
+      if (_tasks.empty())
+        return;
+
+      task = std::move(_tasks.front());
+      _tasks.pop_front();
+    }
+    task();
+  }
+}
+
+//============================================================================
+// Apply fn(begin, end) to contiguous sub-ranges of [0, count) using the
+// workers of pool, or as a single range if pool is null.  Returns once all
+// sub-ranges are complete, rethrowing the first exception raised by fn.
+//
+// The calling thread also processes sub-ranges, including any that no
+// worker has started.  This permits use by a task of the same pool, even if
+// every other worker is occupied.
+
+template<typename Fn>
+void
+parallelFor(ThreadPool* pool, size_t count, Fn&& fn)
+{
+  size_t numRanges = pool ? std::min(count, size_t(pool->numThreads())) : 1;
+  if (numRanges < 2) {
+    fn(size_t(0), count);
+    return;
+  }
+
+  // NB: a worker may start after every sub-range is complete, and must not
+  //     then reference anything owned by the calling thread.
+  struct State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t numClaimed = 0;
+    size_t numDone = 0;
+    std::exception_ptr error;
+  };
+  auto state = std::make_shared<State>();
+  auto fnPtr = &fn;
+
+  auto processRanges = [state, fnPtr, count, numRanges]() {
+    while (true) {
+      size_t i;
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->numClaimed == numRanges)
+          return;
+        i = state->numClaimed++;
+      }
+
+      std::exception_ptr error;
+      try {
+        (*fnPtr)(count * i / numRanges, count * (i + 1) / numRanges);
+      }
+      catch (...) {
+        error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (error && !state->error)
+        state->error = error;
+      if (++state->numDone == numRanges)
+        state->cv.notify_all();
+    }
+  };
+
+  for (size_t i = 1; i < numRanges; i++)
+    pool->submit(processRanges);
+
+  processRanges();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait(lock, [&]() { return state->numDone == numRanges; });
+  if (state->error)
+    std::rethrow_exception(state->error);
+}
+
+//============================================================================
+// A single background worker executing tasks in submission order, with at
+// most maxPending tasks outstanding.  Submission blocks while the queue is
+// full.  A maxPending of zero executes each task synchronously.
+
+class BoundedTaskQueue {
+public:
+  explicit BoundedTaskQueue(int maxPending)
+    : _maxPending(std::max(0, maxPending)), _pool(maxPending > 0 ? 1 : 0)
+  {}
+
+  // Queue fn for execution.  Any exception raised by an earlier task is
+  // rethrown once the task is retired.
+  template<typename Fn>
+  void submit(Fn&& fn);
+
+  // Wait for all outstanding tasks to complete
+  void wait();
+
+private:
+  void retireOldest();
+
+  size_t _maxPending;
+  std::deque<std::future<void>> _pending;
+
+  // NB: declared last so that queued tasks complete before destruction
+  ThreadPool _pool;
+};
+
+//----------------------------------------------------------------------------
+
+template<typename Fn>
+void
+BoundedTaskQueue::submit(Fn&& fn)
+{
+  if (!_maxPending) {
+    fn();
+    return;
+  }
+
+  while (_pending.size() >= _maxPending)
+    retireOldest();
+
+  _pending.push_back(_pool.submit(std::forward<Fn>(fn)));
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+BoundedTaskQueue::wait()
+{
+  while (!_pending.empty())
+    retireOldest();
+}
+
+//----------------------------------------------------------------------------
+
+inline void
+BoundedTaskQueue::retireOldest()
+{
+  auto result = std::move(_pending.front());
+  _pending.pop_front();
+  result.get();
+}
+
+//============================================================================
+
+}  // namespace pcc